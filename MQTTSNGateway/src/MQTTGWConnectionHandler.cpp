@@ -92,7 +92,11 @@ void MQTTGWConnectionHandler::handleDisconnect(Client* client, MQTTGWPacket* pac
     MQTTSNPacket* snPacket = new MQTTSNPacket();
     snPacket->setDISCONNECT(0);
     client->disconnected();
-    client->getNetwork()->close();
+    Network* network = client->getExistingNetwork();
+    if (network)
+    {
+        network->close();
+    }
     Event* ev1 = new Event();
     ev1->setClientSendEvent(client, snPacket);
 }
@@ -16,8 +16,11 @@
  **************************************************************************************/
 
 #include "MQTTGWPacket.h"
+#include "MQTTSNGWBufferArena.h"
 #include <string>
 #include <string.h>
+#include <atomic>
+#include <new>
 
 using namespace MQTTSNGW;
 
@@ -25,6 +28,7 @@ int readInt(char** ptr);
 void writeInt(unsigned char** pptr, int msgId);
 
 #define MAX_NO_OF_REMAINING_LENGTH_BYTES    3
+#define MQTTGWPACKET_DATA_OFFSET            8    // bytes of the reference count before _data
 /**
  * List of the predefined MQTT v3 packet names.
  */
@@ -174,9 +178,45 @@ MQTTGWPacket::MQTTGWPacket()
 
 MQTTGWPacket::~MQTTGWPacket()
 {
-    if (_data)
+    releaseData(_data);
+}
+
+/*
+ *  The data is preceded by a reference count. Copies of the packet share the data,
+ *  so a PUBLISH fanned out to many clients is not copied. The data is not changed
+ *  while it is shared, setMsgId() copies it first.
+ */
+unsigned char* MQTTGWPacket::allocData(int len)
+{
+    unsigned char* mem = (unsigned char*) BufferArena::allocate(MQTTGWPACKET_DATA_OFFSET + len);
+    memset(mem + MQTTGWPACKET_DATA_OFFSET, 0, len);
+    new (mem) std::atomic<int>(1);
+    return mem + MQTTGWPACKET_DATA_OFFSET;
+}
+
+void MQTTGWPacket::releaseData(unsigned char* data)
+{
+    if (data)
     {
-        free(_data);
+        std::atomic<int>* refCnt = (std::atomic<int>*) (data - MQTTGWPACKET_DATA_OFFSET);
+        if (refCnt->fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            BufferArena::release(data - MQTTGWPACKET_DATA_OFFSET);
+        }
+    }
+}
+
+void MQTTGWPacket::unshareData(void)
+{
+    if (_data && ((std::atomic<int>*) (_data - MQTTGWPACKET_DATA_OFFSET))->load(std::memory_order_acquire) > 1)
+    {
+        unsigned char* data = allocData(_remainingLength);
+        if (data)
+        {
+            memcpy(data, _data, _remainingLength);
+        }
+        releaseData(_data);
+        _data = data;
     }
 }
 
@@ -211,7 +251,7 @@ int MQTTGWPacket::recv(Network* network)
     if (_remainingLength > 0)
     {
         /* allocate buffer */
-        _data = (unsigned char*) calloc(_remainingLength, 1);
+        _data = allocData(_remainingLength);
         if (!_data)
         {
             return -3;
@@ -323,7 +363,7 @@ int MQTTGWPacket::setCONNECT(Connect* connect, unsigned char* username, unsigned
         _remainingLength += (int) strlen((char*) password) + 2;
     }
 
-    _data = (unsigned char*) calloc(_remainingLength, 1);
+    _data = allocData(_remainingLength);
     unsigned char* ptr = _data;
 
     if (connect->version == 3)
@@ -368,7 +408,7 @@ int MQTTGWPacket::setSUBSCRIBE(const char* topic, unsigned char qos, unsigned sh
     _header.bits.type = SUBSCRIBE;
     _header.bits.qos = 1;          // Reserved
     _remainingLength = (int) strlen(topic) + 5;
-    _data = (unsigned char*) calloc(_remainingLength, 1);
+    _data = allocData(_remainingLength);
     if (_data)
     {
         unsigned char* ptr = _data;
@@ -388,7 +428,7 @@ int MQTTGWPacket::setUNSUBSCRIBE(const char* topic, unsigned short msgid)
     _header.bits.type = UNSUBSCRIBE;
     _header.bits.qos = 1;
     _remainingLength = (int) strlen(topic) + 4;
-    _data = (unsigned char*) calloc(_remainingLength, 1);
+    _data = allocData(_remainingLength);
     if (_data)
     {
         unsigned char* ptr = _data;
@@ -407,7 +447,7 @@ int MQTTGWPacket::setPUBLISH(Publish* pub)
     _header.byte = pub->header.byte;
     _header.bits.type = PUBLISH;
     _remainingLength = 4 + pub->topiclen + pub->payloadlen;
-    _data = (unsigned char*) calloc(_remainingLength, 1);
+    _data = allocData(_remainingLength);
     if (_data)
     {
         unsigned char* ptr = _data;
@@ -439,7 +479,7 @@ int MQTTGWPacket::setAck(unsigned char msgType, unsigned short msgid)
     _header.bits.type = msgType;
     _header.bits.qos = (msgType == PUBREL) ? 1 : 0;
 
-    _data = (unsigned char*) calloc(_remainingLength, 1);
+    _data = allocData(_remainingLength);
     if (_data)
     {
         unsigned char* data = _data;
@@ -465,6 +505,11 @@ int MQTTGWPacket::getType(void)
     return _header.bits.type;
 }
 
+int MQTTGWPacket::getQoS(void)
+{
+    return _header.bits.qos;
+}
+
 const char* MQTTGWPacket::getName(void)
 {
     return getType() > DISCONNECT ? "UNKNOWN" : mqtt_packet_names[getType()];
@@ -486,12 +531,54 @@ int MQTTGWPacket::getPacketLength(void)
     return 1 + MQTTPacket_encode(buf, _remainingLength) + _remainingLength;
 }
 
-void MQTTGWPacket::clearData(void)
+/*
+ *  Rebuilds the packet from the data written by getPacketData().
+ */
+int MQTTGWPacket::setPacketData(const unsigned char* buf, int len)
 {
-    if (_data)
+    int multiplier = 1;
+    int pos = 1;
+
+    if (len < 2)
+    {
+        return -2;
+    }
+    clearData();
+    _data = nullptr;
+    _header.byte = buf[0];
+    do
     {
-        free(_data);
+        if (pos > MAX_NO_OF_REMAINING_LENGTH_BYTES || pos >= len)
+        {
+            return -2;
+        }
+        _remainingLength += (buf[pos] & 127) * multiplier;
+        multiplier *= 128;
     }
+    while ((buf[pos++] & 128) != 0);
+
+    if (pos + _remainingLength != len)
+    {
+        _remainingLength = 0;
+        return -2;
+    }
+    if (_remainingLength > 0)
+    {
+        _data = allocData(_remainingLength);
+        if (!_data)
+        {
+            _remainingLength = 0;
+            return -3;
+        }
+        memcpy(_data, buf + pos, _remainingLength);
+    }
+    return len;
+}
+
+void MQTTGWPacket::clearData(void)
+{
+    releaseData(_data);
+    _data = nullptr;
     _header.byte = 0;
     _remainingLength = 0;
 }
@@ -570,6 +657,12 @@ void MQTTGWPacket::setMsgId(int msgId)
     int type = getType();
     unsigned char* ptr = 0;
 
+    unshareData();
+    if (_data == nullptr)
+    {
+        return;
+    }
+
     switch (type)
     {
     case PUBLISH:
@@ -616,19 +709,22 @@ char* MQTTGWPacket::print(char* pbuf)
     return ptr;
 }
 
+/*
+ *  The copy shares the data of the packet.
+ */
 MQTTGWPacket& MQTTGWPacket::operator =(MQTTGWPacket& packet)
 {
+    if (&packet == this)
+    {
+        return *this;
+    }
     clearData();
     this->_header.byte = packet._header.byte;
     this->_remainingLength = packet._remainingLength;
-    _data = (unsigned char*) calloc(_remainingLength, 1);
+    _data = packet._data;
     if (_data)
     {
-        memcpy(this->_data, packet._data, _remainingLength);
-    }
-    else
-    {
-        clearData();
+        ((std::atomic<int>*) (_data - MQTTGWPACKET_DATA_OFFSET))->fetch_add(1, std::memory_order_relaxed);
     }
     return *this;
 }
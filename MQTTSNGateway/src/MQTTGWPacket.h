@@ -213,8 +213,10 @@ public:
     int recv(Network* network);
     int send(Network* network);
     int getType(void);
+    int getQoS(void);
     int getPacketData(unsigned char* buf);
     int getPacketLength(void);
+    int setPacketData(const unsigned char* buf, int len);
     const char* getName(void);
 
     int getAck(Ack* ack);
@@ -240,9 +242,12 @@ public:
 
 private:
     void clearData(void);
+    void unshareData(void);
+    static unsigned char* allocData(int len);
+    static void releaseData(unsigned char* data);
     Header _header;
     int _remainingLength;
-    unsigned char* _data;
+    unsigned char* _data;    // shared by the copies of the packet, see allocData()
 };
 
 }
@@ -32,7 +32,10 @@ MQTTGWPublishHandler::MQTTGWPublishHandler(Gateway* gateway)
 
 MQTTGWPublishHandler::~MQTTGWPublishHandler()
 {
-
+    if (_clients)
+    {
+        delete[] _clients;
+    }
 }
 
 void MQTTGWPublishHandler::handlePublish(Client* client, MQTTGWPacket* packet)
@@ -290,31 +293,23 @@ void MQTTGWPublishHandler::handleAggregatePublish(Client* client, MQTTGWPacket*
     Publish pub;
     packet->getPUBLISH(&pub);
 
-    string* topicName = new string(pub.topic, pub.topiclen); // topic deletes topicName when the topic is deleted
-    Topic topic = Topic(topicName, MQTTSN_TOPIC_TYPE_NORMAL);
-
-    // ToDo: need to refactor
-    ClientTopicElement* elm = _gateway->getAdapterManager()->getAggregater()->getClientElement(&topic);
+    if (_clients == nullptr)
+    {
+        _clientsSize = _gateway->getGWParams()->maxClients;
+        _clients = new Client*[_clientsSize];
+    }
+    int cnt = _gateway->getAdapterManager()->getAggregater()->getClients(pub.topic, pub.topiclen, _clients,
+            _clientsSize);
 
-    while (elm != nullptr)
+    for (int i = 0; i < cnt; i++)
     {
-        Client* devClient = elm->getClient();
+        /* the copies share the data of the packet */
         MQTTGWPacket* msg = new MQTTGWPacket();
         *msg = *packet;
 
-        if (msg->getType() == 0)
-        {
-            WRITELOG("%s MQTTGWPublishHandler::handleAggregatePublish can't allocate memories for Packet.%s\n",
-            ERRMSG_HEADER, ERRMSG_FOOTER);
-            delete msg;
-            break;
-        }
-
         Event* ev = new Event();
-        ev->setBrokerRecvEvent(devClient, msg);
+        ev->setBrokerRecvEvent(_clients[i], msg);
         _gateway->getPacketEventQue()->post(ev);
-
-        elm = elm->getNextClientElement();
     }
 }
 
@@ -41,6 +41,8 @@ private:
     void replyACK(Client* client, Publish* pub, int type);
 
     Gateway* _gateway;
+    Client** _clients { nullptr };    // subscribers of an aggregated PUBLISH
+    int _clientsSize { 0 };
 };
 
 }
@@ -15,6 +15,7 @@
  **************************************************************************************/
 #include "MQTTSNGWAggregateTopicTable.h"
 #include "MQTTSNGWClient.h"
+#include <algorithm>
 
 /*=====================================
  Class ClientTopicElement
@@ -55,6 +56,8 @@ AggregateTopicElement::AggregateTopicElement(Topic* topic, Client* client)
     {
         _head = elm;
         _tail = elm;
+        _clientIndex.add(hashPointer(client), elm);
+        _clientCnt = 1;
     }
 }
 
@@ -66,13 +69,14 @@ AggregateTopicElement::~AggregateTopicElement(void)
         ClientTopicElement* p = _tail;
         while (p)
         {
-            ClientTopicElement* pPrev = p;
+            ClientTopicElement* pPrev = p->_prev;
             delete p;
-            p = pPrev->_prev;
+            p = pPrev;
         }
         _head = _tail = nullptr;
     }
     _mutex.unlock();
+    delete _topic;
 }
 
 ClientTopicElement* AggregateTopicElement::add(Client* client)
@@ -103,25 +107,22 @@ ClientTopicElement* AggregateTopicElement::add(Client* client)
         else
         {
             delete elm;
-            elm = p;
+            _mutex.unlock();
+            return p;
         }
     }
+    _clientIndex.add(hashPointer(client), elm);
+    _clientCnt++;
     _mutex.unlock();
     return elm;
 }
 
 ClientTopicElement* AggregateTopicElement::find(Client* client)
 {
-    ClientTopicElement* p = _head;
-    while (p != nullptr)
+    return _clientIndex.find(hashPointer(client), [client](ClientTopicElement* elm)
     {
-        if (p->_client == client)
-        {
-            break;
-        }
-        p = p->_next;
-    }
-    return p;
+        return elm->_client == client;
+    });
 }
 
 ClientTopicElement* AggregateTopicElement::getFirstClientTopicElement(void)
@@ -156,12 +157,15 @@ void AggregateTopicElement::eraseClient(Client* client)
         else if (p->_next != nullptr)  // middle
         {
             p->_prev->_next = p->_next;
+            p->_next->_prev = p->_prev;
         }
         else    // tail
         {
             p->_prev->_next = nullptr;
             _tail = p->_prev;
         }
+        _clientIndex.remove(hashPointer(client), p);
+        _clientCnt--;
         delete p;
     }
     _mutex.unlock();
@@ -178,14 +182,15 @@ AggregateTopicTable::AggregateTopicTable()
 
 AggregateTopicTable::~AggregateTopicTable()
 {
-
+    clear();
+    delete[] _matches;
 }
 
 AggregateTopicElement* AggregateTopicTable::add(Topic* topic, Client* client)
 {
     AggregateTopicElement* elm = nullptr;
     _mutex.lock();
-    elm = getAggregateTopicElement(topic);
+    elm = find(topic);
     if (elm != nullptr)
     {
         if (elm->find(client) == nullptr)
@@ -208,6 +213,11 @@ AggregateTopicElement* AggregateTopicTable::add(Topic* topic, Client* client)
             _tail->_next = elm;
             _tail = elm;
         }
+        string* name = newTopic->getTopicName();
+        _nameIndex.add(hashBytes(name->data(), name->size()), elm);
+        _topicIndex.add(hashPointer(newTopic), elm);
+        _trie.add(newTopic);
+        _cnt++;
     }
     _mutex.unlock();
     return elm;
@@ -218,15 +228,15 @@ void AggregateTopicTable::erase(Topic* topic, Client* client)
     AggregateTopicElement* elm = nullptr;
 
     _mutex.lock();
-    elm = getAggregateTopicElement(topic);
+    elm = find(topic);
 
     if (elm != nullptr)
     {
         elm->eraseClient(client);
-    }
-    if (elm->_head == nullptr)
-    {
-        erase(elm);
+        if (elm->_head == nullptr)
+        {
+            erase(elm);
+        }
     }
     _mutex.unlock();
     return;
@@ -251,31 +261,57 @@ void AggregateTopicTable::erase(AggregateTopicElement* elmTopic)
         else if (elmTopic->_next != nullptr)  // middle
         {
             elmTopic->_prev->_next = elmTopic->_next;
+            elmTopic->_next->_prev = elmTopic->_prev;
         }
         else    // tail
         {
             elmTopic->_prev->_next = nullptr;
             _tail = elmTopic->_prev;
         }
+        string* name = elmTopic->_topic->getTopicName();
+        _nameIndex.remove(hashBytes(name->data(), name->size()), elmTopic);
+        _topicIndex.remove(hashPointer(elmTopic->_topic), elmTopic);
+        _trie.remove(elmTopic->_topic);
+        _cnt--;
         delete elmTopic;
     }
 }
 
-AggregateTopicElement* AggregateTopicTable::getAggregateTopicElement(Topic* topic)
+void AggregateTopicTable::clear(void)
 {
-    AggregateTopicElement* elm = _head;
-
-    while (elm != nullptr)
+    _mutex.lock();
+    while (_head != nullptr)
     {
-        if (elm->_topic->isMatch(topic->_topicName))
-        {
-            break;
-        }
-        elm = elm->_next;
+        erase(_head);
     }
+    _mutex.unlock();
+}
+
+int AggregateTopicTable::getCount(void)
+{
+    return _cnt;
+}
+
+AggregateTopicElement* AggregateTopicTable::getAggregateTopicElement(Topic* topic)
+{
+    _mutex.lock();
+    AggregateTopicElement* elm = find(topic);
+    _mutex.unlock();
     return elm;
 }
 
+/*
+ *  Returns the element of the same filter.
+ */
+AggregateTopicElement* AggregateTopicTable::find(Topic* topic)
+{
+    string* name = topic->_topicName;
+    return _nameIndex.find(hashBytes(name->data(), name->size()), [name](AggregateTopicElement* elm)
+    {
+        return *elm->_topic->_topicName == *name;
+    });
+}
+
 ClientTopicElement* AggregateTopicTable::getClientElement(Topic* topic)
 {
     AggregateTopicElement* elm = getAggregateTopicElement(topic);
@@ -289,6 +325,59 @@ ClientTopicElement* AggregateTopicTable::getClientElement(Topic* topic)
     }
 }
 
+/*
+ *  Copies the subscribers of all filters which match the topic name under the lock,
+ *  so that they can be used while other threads subscribe or unsubscribe.
+ *  A client subscribed by several matching filters is copied once.
+ */
+int AggregateTopicTable::getClients(const char* topicName, int len, Client** clients, int size)
+{
+    int cnt = 0;
+    _mutex.lock();
+    if (_matchesSize < _cnt)
+    {
+        delete[] _matches;
+        _matchesSize = _cnt * 2;
+        _matches = new Topic*[_matchesSize];
+    }
+    int matchCnt = _trie.matchAll(topicName, len, _matches, _matchesSize);
+
+    for (int i = 0; i < matchCnt; i++)
+    {
+        Topic* topic = _matches[i];
+        AggregateTopicElement* elm = _topicIndex.find(hashPointer(topic), [topic](AggregateTopicElement* e)
+        {
+            return e->_topic == topic;
+        });
+
+        elm->_mutex.lock();
+        for (ClientTopicElement* p = elm->_head; p != nullptr; p = p->_next)
+        {
+            if (cnt == size)
+            {
+                cnt = unique(clients, cnt);
+                if (cnt == size)
+                {
+                    break;
+                }
+            }
+            clients[cnt++] = p->_client;
+        }
+        elm->_mutex.unlock();
+    }
+    _mutex.unlock();
+    return matchCnt > 1 ? unique(clients, cnt) : cnt;
+}
+
+/*
+ *  Removes the duplicated clients, the order is not kept.
+ */
+int AggregateTopicTable::unique(Client** clients, int cnt)
+{
+    std::sort(clients, clients + cnt);
+    return std::unique(clients, clients + cnt) - clients;
+}
+
 void AggregateTopicTable::print(void)
 {
     AggregateTopicElement* elm = _head;
@@ -19,18 +19,22 @@
 
 #include "MQTTSNGWDefines.h"
 #include "MQTTSNGWProcess.h"
+#include "MQTTSNGWTopic.h"
 #include <stdint.h>
 namespace MQTTSNGW
 {
 
 class Client;
-class Topic;
 class AggregateTopicElement;
 class ClientTopicElement;
 class Mutex;
 
 /*=====================================
  Class AggregateTopicTable
+
+ Topic filters subscribed by the clients of the aggregating gateway.
+ The filters are indexed by name for SUBSCRIBE and UNSUBSCRIBE, and by a TopicTrie
+ which finds all filters matching the name of a PUBLISH in one walk.
  ======================================*/
 class AggregateTopicTable
 {
@@ -41,18 +45,26 @@ public:
     AggregateTopicElement* add(Topic* topic, Client* client);
     AggregateTopicElement* getAggregateTopicElement(Topic* topic);
     ClientTopicElement* getClientElement(Topic* topic);
+    int getClients(const char* topicName, int len, Client** clients, int size);
     void erase(Topic* topic, Client* client);
     void clear(void);
+    int getCount(void);
 
     void print(void);
 
 private:
+    AggregateTopicElement* find(Topic* topic);
     void erase(AggregateTopicElement* elmTopic);
+    static int unique(Client** clients, int cnt);
     Mutex _mutex;
     AggregateTopicElement* _head { nullptr };
     AggregateTopicElement* _tail { nullptr };
+    HashIndex<AggregateTopicElement> _nameIndex;     // elements by filter
+    HashIndex<AggregateTopicElement> _topicIndex;    // elements by the Topic of the filter
+    TopicTrie _trie;
+    Topic** _matches { nullptr };                    // filters matched by getClients()
+    int _matchesSize { 0 };
     int _cnt { 0 };
-    int _maxSize { MAX_MESSAGEID_TABLE_SIZE };
 };
 
 /*=====================================
@@ -80,6 +92,8 @@ private:
     AggregateTopicElement* _prev { nullptr };
     ClientTopicElement* _head { nullptr };
     ClientTopicElement* _tail { nullptr };
+    HashIndex<ClientTopicElement> _clientIndex;    // elements by Client
+    int _clientCnt { 0 };
 };
 
 /*=====================================
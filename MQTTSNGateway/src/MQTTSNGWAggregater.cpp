@@ -64,6 +64,11 @@ Client* Aggregater::convertClient(uint16_t msgId, uint16_t* clientMsgId)
     return _msgIdTable.getClientMsgId(msgId, clientMsgId);
 }
 
+Client* Aggregater::findClient(uint16_t msgId)
+{
+    return _msgIdTable.getClient(msgId);
+}
+
 uint16_t Aggregater::addMessageIdTable(Client* client, uint16_t msgId)
 {
     /* set Non secure client`s nextMsgId. otherwise Id is duplicated.*/
@@ -112,6 +117,11 @@ ClientTopicElement* Aggregater::getClientElement(Topic* topic)
     }
 }
 
+int Aggregater::getClients(const char* topicName, int len, Client** clients, int size)
+{
+    return _topicTable.getClients(topicName, len, clients, size);
+}
+
 void Aggregater::printAggregateTopicTable(void)
 {
     _topicTable.print();
@@ -46,10 +46,12 @@ public:
     const char* getClientId(SensorNetAddress* addr);
     Client* getClient(SensorNetAddress* addr);
     Client* convertClient(uint16_t msgId, uint16_t* clientMsgId);
+    Client* findClient(uint16_t msgId);
     uint16_t addMessageIdTable(Client* client, uint16_t msgId);
     uint16_t getMsgId(Client* client, uint16_t clientMsgId);
 
     ClientTopicElement* getClientElement(Topic* topic);
+    int getClients(const char* topicName, int len, Client** clients, int size);
     ClientTopicElement* getNextClientElement(ClientTopicElement* clientElement);
     Client* getClient(ClientTopicElement* clientElement);
 
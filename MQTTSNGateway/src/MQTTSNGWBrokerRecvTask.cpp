@@ -54,9 +54,6 @@ void BrokerRecvTask::initialize(int argc, char** argv)
 void BrokerRecvTask::run(void)
 {
     struct timeval timeout;
-    MQTTGWPacket* packet = nullptr;
-    int rc;
-    Event* ev = nullptr;
     fd_set rset;
     fd_set wset;
 
@@ -75,14 +72,16 @@ void BrokerRecvTask::run(void)
         int maxSock = 0;
         int sockfd = 0;
 
-        /* Prepare sockets list to read */
-        Client* client = _gateway->getClientList()->getClient(0);
+        /* Prepare sockets list to read from the hot fields, Clients are not reused while reading them */
+        ClientList* clientList = _gateway->getClientList();
+        ClientHotFields* hot = clientList->getHotFields();
+        clientList->beginRead();
 
-        while (client)
+        for (int i = 0; i < hot->size; i++)
         {
-            if (client->getNetwork()->isValid())
+            sockfd = hot->sock[i];
+            if (sockfd > 0 && hot->status[i] != Cstat_Free)
             {
-                sockfd = client->getNetwork()->getSock();
                 FD_SET(sockfd, &rset);
                 FD_SET(sockfd, &wset);
                 if (sockfd > maxSock)
@@ -90,8 +89,8 @@ void BrokerRecvTask::run(void)
                     maxSock = sockfd;
                 }
             }
-            client = client->getNextClient();
         }
+        clientList->endRead();
 
         if (maxSock == 0)
         {
@@ -104,81 +103,90 @@ void BrokerRecvTask::run(void)
 
             if (activity > 0)
             {
-                client = _gateway->getClientList()->getClient(0);
+                clientList->beginRead();
 
-                while (client)
+                for (int i = 0; i < hot->size; i++)
                 {
                     _light->blueLight(false);
-                    if (client->getNetwork()->isValid())
+                    sockfd = hot->sock[i];
+                    if (sockfd > 0 && hot->status[i] != Cstat_Free && FD_ISSET(sockfd, &rset))
                     {
-                        int sockfd = client->getNetwork()->getSock();
-                        if (FD_ISSET(sockfd, &rset))
-                        {
-                            packet = new MQTTGWPacket();
-                            rc = 0;
-                            /* read sockets */
-                            _light->blueLight(true);
-                            rc = packet->recv(client->getNetwork());
-                            if (rc > 0)
-                            {
-                                if (log(client, packet) == -1)
-                                {
-                                    delete packet;
-                                    goto nextClient;
-                                }
-
-                                /* post a BrokerRecvEvent */
-                                ev = new Event();
-                                ev->setBrokerRecvEvent(client, packet);
-                                _gateway->getPacketEventQue()->post(ev);
-                            }
-                            else
-                            {
-                                if (rc == 0)  // Disconnected
-                                {
-                                    WRITELOG("%s BrokerRecvTask %s is disconnected by the broker.%s\n",
-                                    ERRMSG_HEADER, client->getClientId(),
-                                    ERRMSG_FOOTER);
-                                    client->getNetwork()->close();
-                                    client->disconnected();
-                                }
-                                else if (rc == -1)
-                                {
-                                    WRITELOG("%s BrokerRecvTask can't receive a packet from the broker errno=%d %s%s\n",
-                                    ERRMSG_HEADER, errno, client->getClientId(),
-                                    ERRMSG_FOOTER);
-                                }
-                                else if (rc == -2)
-                                {
-                                    WRITELOG(
-                                            "%s BrokerRecvTask receive invalid length of packet from the broker.  DISCONNECT  %s %s\n",
-                                            ERRMSG_HEADER, client->getClientId(),
-                                            ERRMSG_FOOTER);
-                                }
-                                else if (rc == -3)
-                                {
-                                    WRITELOG("%s BrokerRecvTask can't allocate memories for the packet %s%s\n",
-                                    ERRMSG_HEADER, client->getClientId(),
-                                    ERRMSG_FOOTER);
-                                }
-
-                                delete packet;
-
-                                if ((rc == -1 || rc == -2) && (client->isActive() || client->isSleep() || client->isAwake()))
-                                {
-                                    client->getNetwork()->close();
-                                    client->disconnected();
-                                }
-                            }
-                        }
+                        recvPacket(clientList->getSlotClient(i));
                     }
-                    nextClient: client = client->getNextClient();
                 }
+                clientList->endRead();
             }
         }
     }
 }
 
+/**
+ *  Receives a packet from the broker connection of the client and posts an Event.
+ */
+void BrokerRecvTask::recvPacket(Client* client)
+{
+    MQTTGWPacket* packet = nullptr;
+    int rc = 0;
+    Event* ev = nullptr;
+
+    packet = new MQTTGWPacket();
+    rc = 0;
+    /* read sockets */
+    _light->blueLight(true);
+    rc = packet->recv(client->getNetwork());
+    if (rc > 0)
+    {
+        if (log(client, packet) == -1)
+        {
+            delete packet;
+            return;
+        }
+
+        /* post a BrokerRecvEvent */
+        ev = new Event();
+        ev->setBrokerRecvEvent(client, packet);
+        _gateway->getPacketEventQue()->post(ev);
+    }
+    else
+    {
+        if (rc == 0)  // Disconnected
+        {
+            WRITELOG("%s BrokerRecvTask %s is disconnected by the broker.%s\n",
+            ERRMSG_HEADER, client->getClientId(),
+            ERRMSG_FOOTER);
+            client->getNetwork()->close();
+            client->disconnected();
+        }
+        else if (rc == -1)
+        {
+            WRITELOG("%s BrokerRecvTask can't receive a packet from the broker errno=%d %s%s\n",
+            ERRMSG_HEADER, errno, client->getClientId(),
+            ERRMSG_FOOTER);
+        }
+        else if (rc == -2)
+        {
+            WRITELOG(
+                    "%s BrokerRecvTask receive invalid length of packet from the broker.  DISCONNECT  %s %s\n",
+                    ERRMSG_HEADER, client->getClientId(),
+                    ERRMSG_FOOTER);
+        }
+        else if (rc == -3)
+        {
+            WRITELOG("%s BrokerRecvTask can't allocate memories for the packet %s%s\n",
+            ERRMSG_HEADER, client->getClientId(),
+            ERRMSG_FOOTER);
+        }
+
+        delete packet;
+
+        if ((rc == -1 || rc == -2) && (client->isActive() || client->isSleep() || client->isAwake()))
+        {
+            client->getNetwork()->close();
+            client->disconnected();
+        }
+    }
+}
+
 /**
  *  write message content into stdout or Ringbuffer
  */
@@ -34,6 +34,7 @@ public:
     ~BrokerRecvTask();
     void initialize(int argc, char** argv);
     void run(void);
+    void recvPacket(Client* client);
 
 private:
     int log(Client*, MQTTGWPacket*);
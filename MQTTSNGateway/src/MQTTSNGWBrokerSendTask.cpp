@@ -59,10 +59,7 @@ void BrokerSendTask::initialize(int argc, char** argv)
 void BrokerSendTask::run()
 {
     Event* ev = nullptr;
-    MQTTGWPacket* packet = nullptr;
-    Client* client = nullptr;
-    AdapterManager* adpMgr = _gateway->getAdapterManager();
-    int rc = 0;
+    ClientList* clientList = _gateway->getClientList();
 
     while (true)
     {
@@ -75,81 +72,100 @@ void BrokerSendTask::run()
             return;
         }
 
-        if (ev->getEventType() == EtBrokerSend)
+        /* a Network released by another task is not deleted while it is used */
+        clientList->beginRead();
+        handleEvent(ev);
+        clientList->endRead();
+        delete ev;
+    }
+}
+
+/**
+ *  Sends the packet of the Event to the broker. The Event is deleted by the caller.
+ */
+void BrokerSendTask::handleEvent(Event* ev)
+{
+    MQTTGWPacket* packet = nullptr;
+    Client* client = nullptr;
+    AdapterManager* adpMgr = _gateway->getAdapterManager();
+    int rc = 0;
+
+    if (ev->getEventType() != EtBrokerSend)
+    {
+        return;
+    }
+
+    client = ev->getClient();
+    packet = ev->getMQTTGWPacket();
+
+    /* Check Client is managed by Adapters */
+    client = adpMgr->getClient(client);
+
+    if (packet->getType() == CONNECT && client->getNetwork()->isValid())
+    {
+        client->getNetwork()->close();
+    }
+
+    if (!client->getNetwork()->isValid())
+    {
+        /* connect to the broker and send a packet */
+
+        if (client->isSecureNetwork())
+        {
+            rc = client->getNetwork()->connect((const char*) _gwparams->brokerName, (const char*) _gwparams->portSecure,
+                    (const char*) _gwparams->rootCApath, (const char*) _gwparams->rootCAfile,
+                    (const char*) _gwparams->certKey, (const char*) _gwparams->privateKey);
+        }
+        else
+        {
+            rc = client->getNetwork()->connect((const char*) _gwparams->brokerName, (const char*) _gwparams->port);
+        }
+
+        if (!rc)
+        {
+            /* disconnect the broker and the client */
+            WRITELOG("%s BrokerSendTask: %s can't connect to the broker. errno=%d %s %s\n",
+            ERRMSG_HEADER, client->getClientId(), errno, strerror(errno), ERRMSG_FOOTER);
+            client->getNetwork()->close();
+            client->releaseNetwork();
+            return;
+        }
+    }
+
+    /* send a packet */
+    _light->blueLight(true);
+    if ((rc = packet->send(client->getNetwork())) > 0)
+    {
+        if (packet->getType() == CONNECT)
         {
-            client = ev->getClient();
-            packet = ev->getMQTTGWPacket();
-
-            /* Check Client is managed by Adapters */
-            client = adpMgr->getClient(client);
-
-            if (packet->getType() == CONNECT && client->getNetwork()->isValid())
-            {
-                client->getNetwork()->close();
-            }
-
-            if (!client->getNetwork()->isValid())
-            {
-                /* connect to the broker and send a packet */
-
-                if (client->isSecureNetwork())
-                {
-                    rc = client->getNetwork()->connect((const char*) _gwparams->brokerName, (const char*) _gwparams->portSecure,
-                            (const char*) _gwparams->rootCApath, (const char*) _gwparams->rootCAfile,
-                            (const char*) _gwparams->certKey, (const char*) _gwparams->privateKey);
-                }
-                else
-                {
-                    rc = client->getNetwork()->connect((const char*) _gwparams->brokerName, (const char*) _gwparams->port);
-                }
-
-                if (!rc)
-                {
-                    /* disconnect the broker and the client */
-                    WRITELOG("%s BrokerSendTask: %s can't connect to the broker. errno=%d %s %s\n",
-                    ERRMSG_HEADER, client->getClientId(), errno, strerror(errno), ERRMSG_FOOTER);
-                    delete ev;
-                    client->getNetwork()->close();
-                    continue;
-                }
-            }
-
-            /* send a packet */
-            _light->blueLight(true);
-            if ((rc = packet->send(client->getNetwork())) > 0)
-            {
-                if (packet->getType() == CONNECT)
-                {
-                    client->connectSended();
-                }
-                else if (packet->getType() == DISCONNECT)
-                {
-                    client->getNetwork()->close();
-                    client->disconnected();
-                }
-                log(client, packet);
-            }
-            else
-            {
-                WRITELOG("%s BrokerSendTask: %s can't send a packet to the broker. errno=%d %s %s\n",
-                ERRMSG_HEADER, client->getClientId(), rc == -1 ? errno : 0, strerror(errno), ERRMSG_FOOTER);
-                if ( errno != EBADF)
-                {
-                    client->getNetwork()->close();
-                }
-
-                /* Disconnect the client */
-                packet = new MQTTGWPacket();
-                packet->setHeader(DISCONNECT);
-                Event* ev1 = new Event();
-                ev1->setBrokerRecvEvent(client, packet);
-                _gateway->getPacketEventQue()->post(ev1);
-            }
-
-            _light->blueLight(false);
+            client->connectSended();
         }
-        delete ev;
+        else if (packet->getType() == DISCONNECT)
+        {
+            client->getNetwork()->close();
+            client->disconnected();
+            client->releaseNetwork();
+        }
+        log(client, packet);
     }
+    else
+    {
+        WRITELOG("%s BrokerSendTask: %s can't send a packet to the broker. errno=%d %s %s\n",
+        ERRMSG_HEADER, client->getClientId(), rc == -1 ? errno : 0, strerror(errno), ERRMSG_FOOTER);
+        if ( errno != EBADF)
+        {
+            client->getNetwork()->close();
+        }
+
+        /* Disconnect the client */
+        packet = new MQTTGWPacket();
+        packet->setHeader(DISCONNECT);
+        Event* ev1 = new Event();
+        ev1->setBrokerRecvEvent(client, packet);
+        _gateway->getPacketEventQue()->post(ev1);
+    }
+
+    _light->blueLight(false);
 }
 
 /**
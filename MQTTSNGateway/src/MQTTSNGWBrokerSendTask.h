@@ -36,6 +36,7 @@ public:
     ~BrokerSendTask();
     void initialize(int argc, char** argv);
     void run();
+    void handleEvent(Event* ev);
 private:
     void log(Client*, MQTTGWPacket*);
     Gateway* _gateway;
@@ -0,0 +1,367 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+
+#include "MQTTSNGWBufferArena.h"
+#include "Threading.h"
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+using namespace MQTTSNGW;
+
+#define ARENA_HEAP     ARENA_CLASSES     // class of the buffers allocated from the heap
+#define ARENA_SLAB_ALIGN  64
+
+/*
+ *  Free buffers are linked through their first word.
+ */
+struct ArenaFree
+{
+    ArenaFree* next;
+};
+
+struct ArenaClass
+{
+    Mutex mutex;
+    ArenaFree* freeList { nullptr };
+    int freeCnt { 0 };
+    char* slab { nullptr };             // the slab being carved
+    int slabUsed { ARENA_SLAB_SIZE };
+};
+
+/*
+ *  Free buffers and counters of a thread. It is zero initialized, so that the thread
+ *  reaches it without a guard. The counters are written by the thread only.
+ */
+struct ArenaCache
+{
+    ArenaFree* freeList[ARENA_CLASSES];
+    int freeCnt[ARENA_CLASSES];
+    std::atomic<uint64_t> allocCnt[ARENA_CLASSES + 1];
+    std::atomic<uint64_t> releaseCnt[ARENA_CLASSES + 1];
+    ArenaCache* next;       // caches of the running threads
+    bool registered;
+    bool dead;              // the thread is exiting and its cache is flushed
+};
+
+/*
+ *  Returns the free buffers of the thread to the shared lists when the thread exits.
+ */
+struct ArenaCacheOwner
+{
+    ~ArenaCacheOwner();
+};
+
+static ArenaClass theArenaClasses[ARENA_CLASSES];
+static std::atomic<uint32_t> theArenaSlabCnt { 0 };
+static Mutex theArenaMutex;
+static ArenaCache* theArenaCaches = nullptr;
+static uint64_t theArenaAllocs[ARENA_CLASSES + 1];      // of the threads which have exited
+static uint64_t theArenaReleases[ARENA_CLASSES + 1];
+static thread_local ArenaCache theArenaCache;
+static thread_local ArenaCacheOwner theArenaCacheOwner;
+
+static inline void count(std::atomic<uint64_t>* cnt)
+{
+    cnt->store(cnt->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+static void flush(ArenaCache* cache, int cls, int cnt)
+{
+    ArenaClass* c = &theArenaClasses[cls];
+    c->mutex.lock();
+    for (int i = 0; i < cnt && cache->freeList[cls]; i++)
+    {
+        ArenaFree* buf = cache->freeList[cls];
+        cache->freeList[cls] = buf->next;
+        cache->freeCnt[cls]--;
+        buf->next = c->freeList;
+        c->freeList = buf;
+        c->freeCnt++;
+    }
+    c->mutex.unlock();
+}
+
+/*
+ *  Moves a batch of free buffers from the shared list to the thread, carving a slab if the list is empty.
+ *  Returns false when all slabs are used.
+ */
+static bool refill(ArenaCache* cache, int cls)
+{
+    ArenaClass* c = &theArenaClasses[cls];
+    int bufSize = 1 << (cls + ARENA_MIN_SHIFT);
+
+    c->mutex.lock();
+    for (int i = 0; i < ARENA_BATCH_SIZE; i++)
+    {
+        ArenaFree* buf = c->freeList;
+        if (buf == nullptr)
+        {
+            if (c->slabUsed + bufSize > ARENA_SLAB_SIZE)
+            {
+                if (i > 0 || theArenaSlabCnt.load() >= ARENA_MAX_SLABS)
+                {
+                    break;
+                }
+                /* the blocks of 64 bytes and larger start on a cache line */
+                if (posix_memalign((void**) &c->slab, ARENA_SLAB_ALIGN, ARENA_SLAB_SIZE) != 0)
+                {
+                    c->slab = nullptr;
+                    break;
+                }
+                c->slabUsed = 0;
+                theArenaSlabCnt++;
+            }
+            buf = (ArenaFree*) (c->slab + c->slabUsed + ARENA_HEADER_SIZE);
+            *(uint64_t*) (c->slab + c->slabUsed) = cls;
+            c->slabUsed += bufSize;
+        }
+        else
+        {
+            c->freeList = buf->next;
+            c->freeCnt--;
+        }
+        buf->next = cache->freeList[cls];
+        cache->freeList[cls] = buf;
+        cache->freeCnt[cls]++;
+    }
+    c->mutex.unlock();
+    return cache->freeList[cls] != nullptr;
+}
+
+/*
+ *  Links the cache of the thread for getStats() at its first allocation or release.
+ */
+static void registerCache(ArenaCache* cache)
+{
+    (void) &theArenaCacheOwner;     // constructed on the first use, destructed when the thread exits
+    theArenaMutex.lock();
+    cache->next = theArenaCaches;
+    theArenaCaches = cache;
+    cache->registered = true;
+    theArenaMutex.unlock();
+}
+
+/*
+ *  Returns nullptr after the cache is flushed, when destructors of other thread_locals still allocate or release.
+ */
+static inline ArenaCache* getCache(void)
+{
+    ArenaCache* cache = &theArenaCache;
+    if (!cache->registered)
+    {
+        if (cache->dead)
+        {
+            return nullptr;
+        }
+        registerCache(cache);
+    }
+    return cache;
+}
+
+static void* allocateHeap(size_t size)
+{
+    char* mem = (char*) malloc(ARENA_HEADER_SIZE + size);
+    if (mem == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    *(uint64_t*) mem = ARENA_HEAP;
+    return mem + ARENA_HEADER_SIZE;
+}
+
+/*
+ *  Allocation of an exiting thread. It takes a buffer from the shared list and counts it with the exited threads.
+ */
+static void* allocateShared(int cls, size_t size)
+{
+    ArenaFree* buf = nullptr;
+    if (cls < ARENA_CLASSES)
+    {
+        ArenaClass* c = &theArenaClasses[cls];
+        c->mutex.lock();
+        buf = c->freeList;
+        if (buf)
+        {
+            c->freeList = buf->next;
+            c->freeCnt--;
+        }
+        c->mutex.unlock();
+    }
+    if (buf == nullptr)
+    {
+        cls = ARENA_HEAP;
+        buf = (ArenaFree*) allocateHeap(size);
+    }
+
+    theArenaMutex.lock();
+    theArenaAllocs[cls]++;
+    theArenaMutex.unlock();
+    return buf;
+}
+
+/*
+ *  Release of an exiting thread. The buffer goes back to the shared list.
+ */
+static void releaseShared(char* mem, int cls)
+{
+    theArenaMutex.lock();
+    theArenaReleases[cls]++;
+    theArenaMutex.unlock();
+
+    if (cls == ARENA_HEAP)
+    {
+        free(mem);
+        return;
+    }
+    ArenaClass* c = &theArenaClasses[cls];
+    ArenaFree* buf = (ArenaFree*) (mem + ARENA_HEADER_SIZE);
+    c->mutex.lock();
+    buf->next = c->freeList;
+    c->freeList = buf;
+    c->freeCnt++;
+    c->mutex.unlock();
+}
+
+ArenaCacheOwner::~ArenaCacheOwner()
+{
+    ArenaCache* cache = &theArenaCache;
+    for (int i = 0; i < ARENA_CLASSES; i++)
+    {
+        flush(cache, i, cache->freeCnt[i]);
+    }
+
+    theArenaMutex.lock();
+    for (int i = 0; i <= ARENA_CLASSES; i++)
+    {
+        theArenaAllocs[i] += cache->allocCnt[i].load();
+        theArenaReleases[i] += cache->releaseCnt[i].load();
+    }
+    for (ArenaCache** p = &theArenaCaches; *p; p = &(*p)->next)
+    {
+        if (*p == cache)
+        {
+            *p = cache->next;
+            break;
+        }
+    }
+    cache->registered = false;
+    cache->dead = true;
+    theArenaMutex.unlock();
+}
+
+/*=====================================
+ Class BufferArena
+ ====================================*/
+void* BufferArena::allocate(size_t size)
+{
+    /* smallest power of two holding the header and the data */
+    int cls = 0;
+    size_t bufSize = size + ARENA_HEADER_SIZE - 1;
+    if (bufSize >= ((size_t) 1 << ARENA_MIN_SHIFT))
+    {
+        cls = (bufSize >> (ARENA_MIN_SHIFT + ARENA_CLASSES)) ? ARENA_CLASSES : 32 - __builtin_clz((unsigned int) bufSize) - ARENA_MIN_SHIFT;
+    }
+
+    ArenaCache* cache = getCache();
+    if (cache == nullptr)
+    {
+        return allocateShared(cls, size);
+    }
+    if (cls < ARENA_CLASSES && (cache->freeList[cls] || refill(cache, cls)))
+    {
+        ArenaFree* buf = cache->freeList[cls];
+        cache->freeList[cls] = buf->next;
+        cache->freeCnt[cls]--;
+        count(&cache->allocCnt[cls]);
+        return buf;
+    }
+
+    /* too large or all slabs are used */
+    void* buf = allocateHeap(size);
+    count(&cache->allocCnt[ARENA_HEAP]);
+    return buf;
+}
+
+void BufferArena::release(void* ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    char* mem = (char*) ptr - ARENA_HEADER_SIZE;
+    int cls = (int) *(uint64_t*) mem;
+    ArenaCache* cache = getCache();
+    if (cache == nullptr)
+    {
+        releaseShared(mem, cls);
+        return;
+    }
+    count(&cache->releaseCnt[cls]);
+
+    if (cls == ARENA_HEAP)
+    {
+        free(mem);
+        return;
+    }
+
+    ArenaFree* buf = (ArenaFree*) ptr;
+    buf->next = cache->freeList[cls];
+    cache->freeList[cls] = buf;
+    if (++cache->freeCnt[cls] > ARENA_CACHE_SIZE)
+    {
+        flush(cache, cls, ARENA_BATCH_SIZE);
+    }
+}
+
+/*
+ *  Bytes of a buffer of the class usable by the caller.
+ */
+size_t BufferArena::getClassSize(int cls)
+{
+    return ((size_t) 1 << (cls + ARENA_MIN_SHIFT)) - ARENA_HEADER_SIZE;
+}
+
+/*
+ *  Sums the counters of the exited threads and of the running ones.
+ */
+void BufferArena::getStats(BufferArenaStats* stats)
+{
+    uint64_t releases[ARENA_CLASSES + 1];
+
+    theArenaMutex.lock();
+    for (int i = 0; i <= ARENA_CLASSES; i++)
+    {
+        releases[i] = theArenaReleases[i];
+        stats->allocCnt[i] = theArenaAllocs[i];
+        for (ArenaCache* cache = theArenaCaches; cache; cache = cache->next)
+        {
+            releases[i] += cache->releaseCnt[i].load(std::memory_order_relaxed);
+            stats->allocCnt[i] += cache->allocCnt[i].load(std::memory_order_relaxed);
+        }
+        stats->inUseCnt[i] = stats->allocCnt[i] - releases[i];
+    }
+    theArenaMutex.unlock();
+    stats->slabCnt = theArenaSlabCnt.load();
+}
+
+/*
+ *  Bytes of the slabs, the buffers from the heap are not counted.
+ */
+size_t BufferArena::getMemorySize(void)
+{
+    return (size_t) theArenaSlabCnt.load() * ARENA_SLAB_SIZE;
+}
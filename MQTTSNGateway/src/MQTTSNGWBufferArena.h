@@ -0,0 +1,65 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+#ifndef MQTTSNGWBUFFERARENA_H_
+#define MQTTSNGWBUFFERARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace MQTTSNGW
+{
+
+#define ARENA_MIN_SHIFT      4              // 16 bytes, the smallest class
+#define ARENA_CLASSES        8              // 16 .. 2048 bytes, holds MQTTSNGW_MAX_PACKET_SIZE with the headers
+#define ARENA_HEADER_SIZE    8              // class of the buffer, keeps the data 8 bytes aligned
+#define ARENA_SLAB_SIZE      (64 * 1024)
+#define ARENA_MAX_SLABS      256            // 16 MB, the buffers are allocated from the heap beyond
+#define ARENA_CACHE_SIZE     64             // free buffers of a class cached by a thread
+#define ARENA_BATCH_SIZE     32             // buffers moved at once between a thread and the shared lists
+
+/*=====================================
+ Class BufferArenaStats
+ ====================================*/
+class BufferArenaStats
+{
+public:
+    uint64_t allocCnt[ARENA_CLASSES + 1];   // by class, the last one counts the buffers from the heap
+    uint64_t inUseCnt[ARENA_CLASSES + 1];
+    uint32_t slabCnt;
+};
+
+/*=====================================
+ Class BufferArena
+
+ Buffers of the packets in power-of-two size classes, carved out of slabs.
+ Each thread caches free buffers per class and exchanges them in batches with
+ the shared free lists, so most allocations and releases take no lock.
+ Buffers larger than the largest class are allocated from the heap.
+ Slabs are never released.
+ ====================================*/
+class BufferArena
+{
+public:
+    static void* allocate(size_t size);
+    static void release(void* ptr);
+    static void getStats(BufferArenaStats* stats);
+    static size_t getMemorySize(void);
+    static size_t getClassSize(int cls);
+};
+
+}
+
+#endif /* MQTTSNGWBUFFERARENA_H_ */
@@ -28,32 +28,81 @@
 using namespace MQTTSNGW;
 char* currentDateTime(void);
 
+/*=====================================
+ Class ClientHotFields
+ =====================================*/
+ClientHotFields::ClientHotFields(int size)
+{
+    this->size = size;
+    status = new ClientStatus[size];
+    keepAliveExpire = new uint32_t[size];
+    sock = new int[size];
+    sensorNetAddr = new SensorNetAddress[size];
+
+    for (int i = 0; i < size; i++)
+    {
+        clear(i);
+    }
+}
+
+ClientHotFields::~ClientHotFields()
+{
+    delete[] status;
+    delete[] keepAliveExpire;
+    delete[] sock;
+    delete[] sensorNetAddr;
+}
+
+void ClientHotFields::clear(int slot)
+{
+    SensorNetAddress none;
+    status[slot] = Cstat_Free;
+    keepAliveExpire[slot] = 0;
+    sock[slot] = 0;
+    sensorNetAddr[slot] = none;
+}
+
 /*=====================================
  Class Client
  =====================================*/
 static const char* theClientStatus[] = { "InPool", "Disconnected", "TryConnecting", "Connecting", "Active", "Asleep", "Awake",
         "Lost" };
 
-Client::Client()
+/*
+ *  A Client of the ClientsPool keeps its hot fields in the slot of the pool,
+ *  any other Client allocates them for itself.
+ */
+Client::Client(ClientHotFields* hot, int slot) :
+        _hot(hot ? hot : new ClientHotFields(1)), _slot(hot ? slot : 0), _ownHot(hot == nullptr), _pool(nullptr),
+        _keepAliveExpire(_hot->keepAliveExpire[_slot]), _status(_hot->status[_slot]),
+        _sensorNetAddr(_hot->sensorNetAddr[_slot])
 {
+    _hot->clear(_slot);
     _packetId = 0;
     _snMsgId = 0;
-    _status = Cstat_Free;
     _keepAliveMsec = 0;
-    _topics = new Topics();
+    _keepAliveSlot = nullptr;
+    _keepAliveNext = nullptr;
+    _keepAlivePrev = nullptr;
+    _topics = nullptr;
     _clientId = nullptr;
     _willTopic = nullptr;
     _willMsg = nullptr;
     _connectData = MQTTPacket_Connect_Initializer;
-    _network = new Network();
+    _network = nullptr;
+    _secureNetwork = false;
     _sensorNetype = true;
     _connAck = nullptr;
     _waitWillMsgFlg = false;
     _sessionStatus = false;
     _prevClient = nullptr;
     _nextClient = nullptr;
-    _clientSleepPacketQue.setMaxSize(MAX_SAVED_PUBLISH);
-    _proxyPacketQue.setMaxSize(MAX_SAVED_PUBLISH);
+    _addrIndexed = false;
+    _clientSleepPacketQue = nullptr;
+    _proxyPacketQue = nullptr;
+    _waitedPubTopicIdMap = nullptr;
+    _waitedSubTopicIdMap = nullptr;
+    _maxInflight = MAX_INFLIGHTMESSAGES;
     _hasPredefTopic = false;
     _holdPingRequest = false;
     _forwarder = nullptr;
@@ -91,31 +140,64 @@ Client::~Client()
     {
         delete _network;
     }
+
+    if (_clientSleepPacketQue)
+    {
+        delete _clientSleepPacketQue;
+    }
+
+    if (_proxyPacketQue)
+    {
+        delete _proxyPacketQue;
+    }
+
+    if (_waitedPubTopicIdMap)
+    {
+        delete _waitedPubTopicIdMap;
+    }
+
+    if (_waitedSubTopicIdMap)
+    {
+        delete _waitedSubTopicIdMap;
+    }
+
+    if (_ownHot)
+    {
+        delete _hot;
+    }
 }
 
 TopicIdMapElement* Client::getWaitedPubTopicId(uint16_t msgId)
 {
-    return _waitedPubTopicIdMap.getElement(msgId);
+    return _waitedPubTopicIdMap ? _waitedPubTopicIdMap->getElement(msgId) : nullptr;
 }
 
 TopicIdMapElement* Client::getWaitedSubTopicId(uint16_t msgId)
 {
-    return _waitedSubTopicIdMap.getElement(msgId);
+    return _waitedSubTopicIdMap ? _waitedSubTopicIdMap->getElement(msgId) : nullptr;
 }
 
 MQTTGWPacket* Client::getClientSleepPacket()
 {
-    return _clientSleepPacketQue.getPacket();
+    return _clientSleepPacketQue ? _clientSleepPacketQue->getPacket() : nullptr;
 }
 
 void Client::deleteFirstClientSleepPacket()
 {
-    _clientSleepPacketQue.pop();
+    if (_clientSleepPacketQue)
+    {
+        _clientSleepPacketQue->pop();
+    }
 }
 
 int Client::setClientSleepPacket(MQTTGWPacket* packet)
 {
-    int rc = _clientSleepPacketQue.post(packet);
+    if (_clientSleepPacketQue == nullptr)
+    {
+        _clientSleepPacketQue = new PacketQue<MQTTGWPacket>();
+        _clientSleepPacketQue->setMaxSize(MAX_SAVED_PUBLISH);
+    }
+    int rc = _clientSleepPacketQue->post(packet);
     if (rc)
     {
         WRITELOG("%s    %s is sleeping. the packet was saved.\n", currentDateTime(), _clientId);
@@ -129,17 +211,25 @@ int Client::setClientSleepPacket(MQTTGWPacket* packet)
 
 MQTTSNPacket* Client::getProxyPacket(void)
 {
-    return _proxyPacketQue.getPacket();
+    return _proxyPacketQue ? _proxyPacketQue->getPacket() : nullptr;
 }
 
 void Client::deleteFirstProxyPacket()
 {
-    _proxyPacketQue.pop();
+    if (_proxyPacketQue)
+    {
+        _proxyPacketQue->pop();
+    }
 }
 
 int Client::setProxyPacket(MQTTSNPacket* packet)
 {
-    int rc = _proxyPacketQue.post(packet);
+    if (_proxyPacketQue == nullptr)
+    {
+        _proxyPacketQue = new PacketQue<MQTTSNPacket>();
+        _proxyPacketQue->setMaxSize(MAX_SAVED_PUBLISH);
+    }
+    int rc = _proxyPacketQue->post(packet);
     if (rc)
     {
         WRITELOG("%s    %s is Disconnected. the packet was saved.\n", currentDateTime(), _clientId);
@@ -158,46 +248,81 @@ Connect* Client::getConnectData(void)
 
 void Client::eraseWaitedPubTopicId(uint16_t msgId)
 {
-    _waitedPubTopicIdMap.erase(msgId);
+    if (_waitedPubTopicIdMap)
+    {
+        _waitedPubTopicIdMap->erase(msgId);
+    }
 }
 
 void Client::eraseWaitedSubTopicId(uint16_t msgId)
 {
-    _waitedSubTopicIdMap.erase(msgId);
+    if (_waitedSubTopicIdMap)
+    {
+        _waitedSubTopicIdMap->erase(msgId);
+    }
 }
 
 void Client::clearWaitedPubTopicId(void)
 {
-    _waitedPubTopicIdMap.clear();
+    if (_waitedPubTopicIdMap)
+    {
+        _waitedPubTopicIdMap->clear();
+    }
 }
 
 void Client::clearWaitedSubTopicId(void)
 {
-    _waitedSubTopicIdMap.clear();
+    if (_waitedSubTopicIdMap)
+    {
+        _waitedSubTopicIdMap->clear();
+    }
 }
 
 void Client::setWaitedPubTopicId(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic)
 {
-    _waitedPubTopicIdMap.add(msgId, topicId, topic);
+    if (_waitedPubTopicIdMap == nullptr)
+    {
+        _waitedPubTopicIdMap = new TopicIdMap(_maxInflight);
+    }
+    _waitedPubTopicIdMap->add(msgId, topicId, topic);
 }
 
 void Client::setWaitedSubTopicId(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic)
 {
-    _waitedSubTopicIdMap.add(msgId, topicId, topic);
-}
-
-bool Client::checkTimeover(void)
-{
-    return (_status == Cstat_Active && _keepAliveTimer.isTimeup());
+    if (_waitedSubTopicIdMap == nullptr)
+    {
+        _waitedSubTopicIdMap = new TopicIdMap(_maxInflight);
+    }
+    _waitedSubTopicIdMap->add(msgId, topicId, topic);
 }
 
-void Client::setKeepAlive(MQTTSNPacket* packet)
+void Client::setKeepAlive(MQTTSNPacket* packet, KeepAliveWheel* keepAlive)
 {
     MQTTSNPacket_connectData param;
     if (packet->getCONNECT(&param))
     {
         _keepAliveMsec = param.duration * 1000UL;
-        _keepAliveTimer.start(_keepAliveMsec * 1.5);
+        startKeepAlive(keepAlive);
+    }
+}
+
+/*
+ *  Restarts the keep alive timer. The client is lost when nothing is received for 1.5 times of the duration.
+ */
+void Client::startKeepAlive(KeepAliveWheel* keepAlive)
+{
+    if (keepAlive == nullptr)
+    {
+        return;
+    }
+
+    if (_keepAliveMsec == 0 || _clientType == Ctype_Proxy)
+    {
+        keepAlive->cancel(this);
+    }
+    else
+    {
+        keepAlive->schedule(this, _keepAliveMsec + _keepAliveMsec / 2);
     }
 }
 
@@ -217,16 +342,19 @@ void Client::setSessionStatus(bool status)
     _sessionStatus = status;
 }
 
+/*
+ *  A client on a KeepAliveWheel is not erasable, the PacketHandleTask which owns the wheel cancels its timer first.
+ */
 bool Client::erasable(void)
 {
-    return _sessionStatus && !_hasPredefTopic && _forwarder == nullptr;
+    return _sessionStatus && !_hasPredefTopic && _forwarder == nullptr && _keepAliveSlot == nullptr;
 }
 
-void Client::updateStatus(MQTTSNPacket* packet)
+void Client::updateStatus(MQTTSNPacket* packet, KeepAliveWheel* keepAlive)
 {
     if (((_status == Cstat_Disconnected) || (_status == Cstat_Lost)) && packet->getType() == MQTTSN_CONNECT)
     {
-        setKeepAlive(packet);
+        setKeepAlive(packet, keepAlive);
     }
     else if (_status == Cstat_Active)
     {
@@ -240,10 +368,7 @@ void Client::updateStatus(MQTTSNPacket* packet)
         case MQTTSN_PUBCOMP:
         case MQTTSN_PUBREL:
         case MQTTSN_PUBREC:
-            if (_clientType != Ctype_Proxy)
-            {
-                _keepAliveTimer.start(_keepAliveMsec * 1.5);
-            }
+            startKeepAlive(keepAlive);
             break;
         case MQTTSN_DISCONNECT:
             uint16_t duration;
@@ -267,6 +392,7 @@ void Client::updateStatus(MQTTSNPacket* packet)
         {
         case MQTTSN_CONNECT:
             _status = Cstat_Active;
+            setKeepAlive(packet, keepAlive);
             break;
         case MQTTSN_DISCONNECT:
             disconnected();
@@ -355,12 +481,150 @@ uint8_t Client::getNextSnMsgId(void)
 
 Topics* Client::getTopics(void)
 {
+    if (_topics == nullptr)
+    {
+        _topics = new Topics();
+    }
     return _topics;
 }
 
+/*
+ *  The Network is created by the first user. BrokerSendTask and the PacketHandleTask may race for it.
+ */
 Network* Client::getNetwork(void)
 {
-    return _network;
+    Network* network = _network.load(std::memory_order_acquire);
+
+    if (network == nullptr)
+    {
+        Network* created = new Network();
+        created->setSecure(_secureNetwork);
+        created->setSockMirror(&_hot->sock[_slot]);
+        if (_network.compare_exchange_strong(network, created))
+        {
+            network = created;
+        }
+        else
+        {
+            created->setSockMirror(nullptr);
+            delete created;
+        }
+    }
+    return network;
+}
+
+/*
+ *  Returns the Network without allocating it, nullptr if the client never had a broker connection.
+ */
+Network* Client::getExistingNetwork(void)
+{
+    return _network.load(std::memory_order_acquire);
+}
+
+/*
+ *  Drops the Network while the broker connection is closed. The readers of the ClientList
+ *  may still hold it, it is deleted after they left.
+ *  Called by BrokerSendTask only, which connects and closes the Network. Elsewhere a closed
+ *  Network may be the one BrokerSendTask is about to connect.
+ */
+void Client::releaseNetwork(void)
+{
+    Network* network = _network.load(std::memory_order_acquire);
+
+    if (network && !network->isValid() && _network.compare_exchange_strong(network, nullptr))
+    {
+        network->setSockMirror(nullptr);
+        if (_pool)
+        {
+            _pool->retire(network);
+        }
+        else
+        {
+            delete network;
+        }
+    }
+}
+
+/*
+ *  Releases the state which is empty while the client sleeps or is disconnected.
+ *  Called by the PacketHandleTask of the client, the only task which uses this state.
+ *  Topics are kept, they carry the next TopicId over the sessions.
+ *  The Network is left to BrokerSendTask, see releaseNetwork().
+ */
+void Client::shrink(void)
+{
+    if (_clientSleepPacketQue && _clientSleepPacketQue->size() == 0)
+    {
+        delete _clientSleepPacketQue;
+        _clientSleepPacketQue = nullptr;
+    }
+    if (_proxyPacketQue && _proxyPacketQue->size() == 0)
+    {
+        delete _proxyPacketQue;
+        _proxyPacketQue = nullptr;
+    }
+    if (_waitedPubTopicIdMap && _waitedPubTopicIdMap->getCount() == 0)
+    {
+        delete _waitedPubTopicIdMap;
+        _waitedPubTopicIdMap = nullptr;
+    }
+    if (_waitedSubTopicIdMap && _waitedSubTopicIdMap->getCount() == 0)
+    {
+        delete _waitedSubTopicIdMap;
+        _waitedSubTopicIdMap = nullptr;
+    }
+    _waitREGACKList.shrink();
+}
+
+/*
+ *  Bytes held by the client, the Client itself and the state allocated for it.
+ */
+size_t Client::getMemorySize(void)
+{
+    size_t size = sizeof(Client);
+
+    if (_ownHot)
+    {
+        size += sizeof(ClientHotFields) + sizeof(ClientStatus) + sizeof(uint32_t) + sizeof(int) + sizeof(SensorNetAddress);
+    }
+    if (_network.load(std::memory_order_acquire))
+    {
+        size += sizeof(Network);
+    }
+    if (_topics)
+    {
+        size += _topics->getMemorySize();
+    }
+    if (_clientSleepPacketQue)
+    {
+        size += sizeof(PacketQue<MQTTGWPacket> ) + _clientSleepPacketQue->size() * (sizeof(QueElement<MQTTGWPacket> ) + sizeof(MQTTGWPacket));
+    }
+    if (_proxyPacketQue)
+    {
+        size += sizeof(PacketQue<MQTTSNPacket> ) + _proxyPacketQue->size() * (sizeof(QueElement<MQTTSNPacket> ) + sizeof(MQTTSNPacket));
+    }
+    if (_waitedPubTopicIdMap)
+    {
+        size += _waitedPubTopicIdMap->getMemorySize();
+    }
+    if (_waitedSubTopicIdMap)
+    {
+        size += _waitedSubTopicIdMap->getMemorySize();
+    }
+    size += _waitREGACKList.getMemorySize();
+    if (_clientId)
+    {
+        size += strlen(_clientId) + 1;
+    }
+    if (_willTopic)
+    {
+        size += strlen(_willTopic) + 1;
+    }
+    if (_willMsg)
+    {
+        size += strlen(_willMsg) + 1;
+    }
+    return size;
 }
 
 void Client::setClientAddress(SensorNetAddress* sensorNetAddr)
@@ -378,6 +642,15 @@ void Client::setSensorNetType(bool stable)
     _sensorNetype = stable;
 }
 
+/*
+ *  Takes effect for the TopicIdMaps allocated after shrink().
+ */
+void Client::setMaxInflight(int maxInflight)
+{
+    _maxInflight = maxInflight;
+    _waitREGACKList.setMaxInflight(maxInflight);
+}
+
 void Client::setTopics(Topics* topics)
 {
     _topics = topics;
@@ -423,9 +696,19 @@ bool Client::isConnecting(void)
     return (_status == Cstat_Connecting);
 }
 
+void Client::setSecureNetwork(bool secure)
+{
+    _secureNetwork = secure;
+    Network* network = _network.load(std::memory_order_acquire);
+    if (network)
+    {
+        network->setSecure(secure);
+    }
+}
+
 bool Client::isSecureNetwork(void)
 {
-    return _network->isSecure();
+    return _secureNetwork;
 }
 
 bool Client::isSensorNetStable(void)
@@ -440,7 +723,7 @@ WaitREGACKPacketList* Client::getWaitREGACKPacketList()
 
 Client* Client::getNextClient(void)
 {
-    return _nextClient;
+    return _nextClient.load(std::memory_order_acquire);
 }
 
 void Client::setClientId(MQTTSNString id)
@@ -581,115 +864,87 @@ bool Client::isHoldPingReqest(void)
     return _holdPingRequest;
 }
 
-/*=====================================
- Class WaitREGACKPacket
- =====================================*/
-waitREGACKPacket::waitREGACKPacket(MQTTSNPacket* packet, uint16_t REGACKMsgId)
-{
-    _packet = packet;
-    _msgId = REGACKMsgId;
-    _next = nullptr;
-    _prev = nullptr;
-}
-
-waitREGACKPacket::~waitREGACKPacket()
-{
-    delete _packet;
-}
-
 /*=====================================
  Class WaitREGACKPacketList
  =====================================*/
-
 WaitREGACKPacketList::WaitREGACKPacketList()
 {
-    _first = nullptr;
-    _end = nullptr;
-    _cnt = 0;
+    _maxInflight = MAX_INFLIGHTMESSAGES;
 }
 
 WaitREGACKPacketList::~WaitREGACKPacketList()
 {
-    waitREGACKPacket* p = _first;
-    while (p)
+    _index.forEach([](uint16_t, MQTTSNPacket** packet)
     {
-        waitREGACKPacket* q = p->_next;
-        delete p;
-        p = q;
-    }
+        delete *packet;
+    });
+}
+
+void WaitREGACKPacketList::setMaxInflight(int maxInflight)
+{
+    _maxInflight = maxInflight;
 }
 
+/*
+ *  The packet is deleted with the list unless it is erased.
+ *  The slots are allocated for the inflight window and doubled when they get half full.
+ */
 int WaitREGACKPacketList::setPacket(MQTTSNPacket* packet, uint16_t REGACKMsgId)
 {
-    waitREGACKPacket* elm = new waitREGACKPacket(packet, REGACKMsgId);
-    if (elm == nullptr)
+    MQTTSNPacket** elm = _index.find(REGACKMsgId);
+    if (elm)
     {
-        return 0;
+        delete *elm;
+        *elm = packet;
+        return 1;
     }
 
-    if (_first == nullptr)
+    int cnt = _index.getCount();
+    if ((cnt + 1) * 2 > _index.getSize())
     {
-        _first = elm;
-        _end = elm;
-    }
-    else
-    {
-        _end->_next = elm;
-        elm->_prev = _end;
-        _end = elm;
+        int size = 4;
+        while (size < (cnt + 1) * 2 || size < _maxInflight * 2)
+        {
+            size <<= 1;
+        }
+        _index.allocate(size);
     }
-    _cnt++;
+    *_index.add(REGACKMsgId) = packet;
     return 1;
 }
 
 MQTTSNPacket* WaitREGACKPacketList::getPacket(uint16_t REGACKMsgId)
 {
-    waitREGACKPacket* p = _first;
-    while (p)
-    {
-        if (p->_msgId == REGACKMsgId)
-        {
-            return p->_packet;
-        }
-        p = p->_next;
-    }
-    return nullptr;
+    MQTTSNPacket** elm = _index.find(REGACKMsgId);
+    return elm ? *elm : nullptr;
 }
 
+/*
+ *  The packet is not deleted. It is deleted after sending to the Client.
+ */
 void WaitREGACKPacketList::erase(uint16_t REGACKMsgId)
 {
-    waitREGACKPacket* p = _first;
-    while (p)
-    {
-        if (p->_msgId == REGACKMsgId)
-        {
-            if (p->_prev == nullptr)
-            {
-                _first = p->_next;
+    _index.erase(REGACKMsgId);
+}
 
-            }
-            else
-            {
-                p->_prev->_next = p->_next;
-            }
-            if (p->_next == nullptr)
-            {
-                _end = p->_prev;
-            }
-            else
-            {
-                p->_next->_prev = p->_prev;
-            }
-            _cnt--;
-            break;
-            // Do not delete element. Element is deleted after sending to Client.
-        }
-        p = p->_next;
+int WaitREGACKPacketList::getCount(void)
+{
+    return _index.getCount();
+}
+
+/*
+ *  Releases the slots while no packet is waiting.
+ */
+void WaitREGACKPacketList::shrink(void)
+{
+    if (_index.getCount() == 0)
+    {
+        _index.allocate(0);
     }
 }
 
-uint8_t WaitREGACKPacketList::getCount(void)
+size_t WaitREGACKPacketList::getMemorySize(void)
 {
-    return _cnt;
+    return _index.getMemorySize() + _index.getCount() * sizeof(MQTTSNPacket);
 }
 
@@ -31,6 +31,7 @@
 #include "MQTTSNGWTopic.h"
 #include "MQTTSNGWClientList.h"
 #include "MQTTSNGWAdapter.h"
+#include "MQTTSNGWKeepAliveWheel.h"
 
 namespace MQTTSNGW
 {
@@ -106,45 +107,40 @@ public:
         _que->setMaxSize(size);
     }
 
+    int size()
+    {
+        return _que->size();
+    }
+
 private:
     Que<T>* _que;
     Mutex _mutex;
 };
 
-/*=====================================
- Class WaitREGACKPacket
- =====================================*/
-class waitREGACKPacket
-{
-    friend class WaitREGACKPacketList;
-public:
-    waitREGACKPacket(MQTTSNPacket* packet, uint16_t REGACKMsgId);
-    ~waitREGACKPacket();
-
-private:
-    uint16_t _msgId;
-    MQTTSNPacket* _packet;
-    waitREGACKPacket* _next;
-    waitREGACKPacket* _prev;
-};
-
 /*=====================================
  Class WaitREGACKPacketList
+
+ PUBLISH messages waiting for the REGACK of their topic, by the msgId of the REGISTER.
+ The slots are allocated by the first setPacket() for the inflight window
+ and doubled when they get half full.
  =====================================*/
 class WaitREGACKPacketList
 {
+    friend class Handoff;
 public:
     WaitREGACKPacketList();
     ~WaitREGACKPacketList();
+    void setMaxInflight(int maxInflight);
     int setPacket(MQTTSNPacket* packet, uint16_t REGACKMsgId);
     MQTTSNPacket* getPacket(uint16_t REGACKMsgId);
     void erase(uint16_t REGACKMsgId);
-    uint8_t getCount(void);
+    int getCount(void);
+    void shrink(void);
+    size_t getMemorySize(void);
 
 private:
-    uint8_t _cnt;
-    waitREGACKPacket* _first;
-    waitREGACKPacket* _end;
+    MsgIdIndex<MQTTSNPacket*> _index;
+    int _maxInflight;
 };
 
 /*=====================================
@@ -172,14 +168,38 @@ typedef enum
     Ctype_Aggregater
 } ClientType;
 
+/*=====================================
+ Class ClientHotFields
+
+ Fields of the Clients which are read by the sweeps over all clients.
+ Each field is an array indexed by the slot of the Client in the ClientsPool,
+ a sweep reads these arrays instead of every Client.
+ =====================================*/
+class ClientHotFields
+{
+public:
+    ClientHotFields(int size);
+    ~ClientHotFields();
+    void clear(int slot);
+
+    int size;
+    ClientStatus* status;
+    uint32_t* keepAliveExpire;          // tick of the KeepAliveWheel
+    int* sock;                          // socket of the broker connection, 0 while it is closed
+    SensorNetAddress* sensorNetAddr;
+};
+
 class Forwarder;
+class ClientsPool;
 
 class Client
 {
     friend class ClientList;
     friend class ClientsPool;
+    friend class KeepAliveWheel;
+    friend class Handoff;
 public:
-    Client();
+    Client(ClientHotFields* hot = nullptr, int slot = 0);
     ~Client();
 
     Connect* getConnectData(void);
@@ -202,8 +222,7 @@ public:
     void setWaitedPubTopicId(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic);
     void setWaitedSubTopicId(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic);
 
-    bool checkTimeover(void);
-    void updateStatus(MQTTSNPacket*);
+    void updateStatus(MQTTSNPacket*, KeepAliveWheel* keepAlive = nullptr);
     void updateStatus(ClientStatus);
     void connectSended(void);
     void connackSended(int rc);
@@ -216,12 +235,17 @@ public:
     uint8_t getNextSnMsgId(void);
     Topics* getTopics(void);
     void setTopics(Topics* topics);
-    void setKeepAlive(MQTTSNPacket* packet);
+    void setKeepAlive(MQTTSNPacket* packet, KeepAliveWheel* keepAlive);
+    void startKeepAlive(KeepAliveWheel* keepAlive);
 
     SensorNetAddress* getSensorNetAddress(void);
     Network* getNetwork(void);
+    Network* getExistingNetwork(void);
+    void releaseNetwork(void);
+    void setSecureNetwork(bool secure);
     void setClientAddress(SensorNetAddress* sensorNetAddr);
     void setSensorNetType(bool stable);
+    void setMaxInflight(int maxInflight);
 
     Forwarder* getForwarder(void);
     void setForwarder(Forwarder* forwader);
@@ -262,16 +286,24 @@ public:
     bool isHoldPingReqest(void);
 
     Client* getNextClient(void);
+    void shrink(void);
+    size_t getMemorySize(void);
 
 private:
-    PacketQue<MQTTGWPacket> _clientSleepPacketQue;
-    PacketQue<MQTTSNPacket> _proxyPacketQue;
+    ClientHotFields* _hot;      // the hot fields of the ClientsPool or of this client only
+    int _slot;
+    bool _ownHot;
+    ClientsPool* _pool;
+
+    /* allocated on first use, released by shrink() while they are empty */
+    PacketQue<MQTTGWPacket>* _clientSleepPacketQue;
+    PacketQue<MQTTSNPacket>* _proxyPacketQue;
 
     WaitREGACKPacketList _waitREGACKList;
+    TopicIdMap* _waitedPubTopicIdMap;
+    TopicIdMap* _waitedSubTopicIdMap;
 
-    Topics* _topics;
-    TopicIdMap _waitedPubTopicIdMap;
-    TopicIdMap _waitedSubTopicIdMap;
+    Topics* _topics;        // allocated on first use, kept
 
     Connect _connectData;
     MQTTSNPacket* _connAck;
@@ -282,19 +314,23 @@ private:
 
     bool _holdPingRequest;
 
-    Timer _keepAliveTimer;
     uint32_t _keepAliveMsec;
+    uint32_t& _keepAliveExpire;     // tick of the KeepAliveWheel, in _hot
+    Client** _keepAliveSlot;        // slot of the KeepAliveWheel linking this client
+    Client* _keepAliveNext;
+    Client* _keepAlivePrev;
 
-    ClientStatus _status;
+    ClientStatus& _status;          // in _hot
     bool _waitWillMsgFlg;
 
     uint16_t _packetId;
     uint8_t _snMsgId;
+    uint16_t _maxInflight;          // inflight window, sizes the TopicIdMaps and the WaitREGACKPacketList
 
-    Network* _network;      // Broker
+    std::atomic<Network*> _network;     // Broker, allocated on first use
     bool _secureNetwork;    // SSL
     bool _sensorNetype;     // false: unstable network like a G3
-    SensorNetAddress _sensorNetAddr;
+    SensorNetAddress& _sensorNetAddr;    // in _hot
 
     Forwarder* _forwarder;
     ClientType _clientType;
@@ -302,8 +338,9 @@ private:
     bool _sessionStatus;
     bool _hasPredefTopic;
 
-    Client* _nextClient;
+    std::atomic<Client*> _nextClient;    // published with release, readers of ClientList walk it without a lock
     Client* _prevClient;
+    bool _addrIndexed;      // in the address index of the ClientList, set once the client has a SensorNetAddress
 };
 
 }
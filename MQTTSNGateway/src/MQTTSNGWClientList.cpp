@@ -18,6 +18,8 @@
 #include "MQTTSNGateway.h"
 #include <string.h>
 #include <string>
+#include <new>
+#include <cassert>
 
 using namespace MQTTSNGW;
 char* currentDateTime(void);
@@ -34,20 +36,16 @@ ClientList::ClientList(Gateway* gw)
     _endClient = nullptr;
     _clientsPool = new ClientsPool();
     _gateway = gw;
+    _addrIndex.setEpoch(&_epoch);
+    _idIndex.setEpoch(&_epoch);
+    _clientsPool->setEpoch(&_epoch);
 }
 
 ClientList::~ClientList()
 {
     _mutex.lock();
-    Client* cl = _firstClient;
-    Client* ncl;
-
-    while (cl != nullptr)
-    {
-        ncl = cl->_nextClient;
-        delete cl;
-        cl = ncl;
-    };
+    /* the erased Clients go back to the pool before it is deleted with all Clients */
+    _epoch.reclaim();
 
     if (_clientsPool)
     {
@@ -58,8 +56,7 @@ ClientList::~ClientList()
 
 void ClientList::initialize(bool aggregate)
 {
-    _maxClients = _gateway->getGWParams()->maxClients;
-    _clientsPool->allocate(_gateway->getGWParams()->maxClients);
+    allocate(_gateway->getGWParams()->maxClients);
 
     if (_gateway->getGWParams()->clientAuthentication)
     {
@@ -78,6 +75,17 @@ void ClientList::initialize(bool aggregate)
     }
 }
 
+/*
+ *  Allocates the Clients and the slots of the index for maxClients.
+ */
+void ClientList::allocate(int maxClients)
+{
+    _maxClients = maxClients;
+    _clientsPool->allocate(maxClients);
+    _addrIndex.allocate(maxClients);
+    _idIndex.allocate(maxClients);
+}
+
 void ClientList::setClientList(int type)
 {
     if (!createList(_gateway->getGWParams()->clientListName, type))
@@ -160,7 +168,7 @@ bool ClientList::createList(const char* fileName, int type)
                 stable = !(data.find("unstableLine") != string::npos);
                 if ((qos_1 && type == QOSM1PROXY_TYPE) || (!qos_1 && type == AGGREGATER_TYPE))
                 {
-                    createClient(&netAddr, &clientId, stable, secure, type);
+                    createOrUpdateClient(&netAddr, &clientId, stable, secure, type);
                 }
                 else if (forwarder && type == FORWARDER_TYPE)
                 {
@@ -168,7 +176,7 @@ bool ClientList::createList(const char* fileName, int type)
                 }
                 else if (type == TRANSPEARENT_TYPE)
                 {
-                    createClient(&netAddr, &clientId, stable, secure, type);
+                    createOrUpdateClient(&netAddr, &clientId, stable, secure, type);
                 }
             }
             else
@@ -184,6 +192,41 @@ bool ClientList::createList(const char* fileName, int type)
     return rc;
 }
 
+/*
+ *  A ClientId which is already in the list keeps its Client and only its address is changed,
+ *  so that a reloaded list does not create a second Client with the same ClientId.
+ *  Clients removed from the file are not removed from the list.
+ *  A client in session keeps its address until the next reload, ClientSendTask and ClientRecvTask
+ *  read it without a lock.
+ */
+Client* ClientList::createOrUpdateClient(SensorNetAddress* addr, MQTTSNString* clientId, bool unstableLine, bool secure,
+        int type)
+{
+    Client* client = getClient(clientId);
+    if (client == nullptr)
+    {
+        return createClient(addr, clientId, unstableLine, secure, type);
+    }
+
+    if (!client->getSensorNetAddress()->isMatch(addr))
+    {
+        ClientStatus status = client->getClientStatus();
+        Client* other = getClient(addr);
+        if (status != Cstat_Disconnected && status != Cstat_Lost)
+        {
+            return client;
+        }
+        if (other && other != client)
+        {
+            WRITELOG("%s ClientList: %s can't take the address of %s.%s\n", ERRMSG_HEADER, client->getClientId(),
+                    other->getClientId(), ERRMSG_FOOTER);
+            return nullptr;
+        }
+        setClientAddress(client, addr);
+    }
+    return client;
+}
+
 bool ClientList::readPredefinedList(const char* fileName, bool aggregate)
 {
     FILE* fp;
@@ -231,22 +274,35 @@ bool ClientList::readPredefinedList(const char* fileName, bool aggregate)
     return rc;
 }
 
+/*
+ *  Reclaimer of the erased Clients.
+ */
+void ClientList::releaseClient(void* client)
+{
+    Client* cl = (Client*) client;
+    cl->_pool->setClient(cl);
+}
+
+/*
+ *  Unlinks the client and retires it. Readers which are walking the list can step over it
+ *  because its _nextClient is kept, it goes back to the pool after they left.
+ *  A client linked in a KeepAliveWheel is not erased, see Client::erasable().
+ */
 void ClientList::erase(Client*& client)
 {
     if (!_authorize && client->erasable())
     {
         _mutex.lock();
         Client* prev = client->_prevClient;
-        Client* next = client->_nextClient;
+        Client* next = client->_nextClient.load(std::memory_order_relaxed);
 
         if (prev)
         {
-            prev->_nextClient = next;
+            prev->_nextClient.store(next, std::memory_order_release);
         }
         else
         {
-            _firstClient = next;
-
+            _firstClient.store(next, std::memory_order_release);
         }
         if (next)
         {
@@ -257,14 +313,21 @@ void ClientList::erase(Client*& client)
             _endClient = prev;
         }
         _clientCnt--;
+        if (client->_addrIndexed)
+        {
+            _addrIndex.remove(client->getSensorNetAddress()->hash(), client);
+        }
+        _idIndex.remove(hashBytes(client->getClientId(), strlen(client->getClientId())), client);
+        client->_status = Cstat_Free;
         Forwarder* fwd = client->getForwarder();
         if (fwd)
         {
             fwd->eraseClient(client);
         }
-        delete client;
-        client = nullptr;
         _mutex.unlock();
+
+        _epoch.retire(client, releaseClient);
+        client = nullptr;
     }
 }
 
@@ -272,64 +335,65 @@ Client* ClientList::getClient(SensorNetAddress* addr)
 {
     if (addr)
     {
-        _mutex.lock();
-        Client* client = _firstClient;
-
-        while (client != nullptr)
+        _epoch.enter();
+        Client* client = _addrIndex.find(addr->hash(), [addr](Client* cl)
         {
-            if (client->getSensorNetAddress()->isMatch(addr))
-            {
-                _mutex.unlock();
-                return client;
-            }
-            client = client->_nextClient;
-        }
-        _mutex.unlock();
+            return cl->getSensorNetAddress()->isMatch(addr);
+        });
+        _epoch.leave();
+        return client;
     }
     return 0;
 }
 
+/*
+ *  Changes the address of the client and moves it in the index.
+ *  A client created without an address enters the index here.
+ */
+void ClientList::setClientAddress(Client* client, SensorNetAddress* addr)
+{
+    _mutex.lock();
+    if (client->_addrIndexed)
+    {
+        _addrIndex.remove(client->getSensorNetAddress()->hash(), client);
+    }
+    client->setClientAddress(addr);
+    _addrIndex.add(client->getSensorNetAddress()->hash(), client);
+    client->_addrIndexed = true;
+    _mutex.unlock();
+}
+
 Client* ClientList::getClient(int index)
 {
-    Client* client = _firstClient;
+    _epoch.enter();
+    Client* client = _firstClient.load(std::memory_order_acquire);
     int p = 0;
-    while (client != nullptr)
+    while (client != nullptr && p < index)
     {
-        if (p == index)
-        {
-            return client;
-        }
-        else
-        {
-            client = client->_nextClient;
-            p++;
-        }
+        client = client->getNextClient();
+        p++;
     }
-    return nullptr;
+    _epoch.leave();
+    return client;
 }
 
 Client* ClientList::getClient(MQTTSNString* clientId)
 {
-    _mutex.lock();
-    Client* client = _firstClient;
     const char* clID = clientId->cstring;
+    size_t len = MQTTSNstrlen(*clientId);
 
     if (clID == nullptr)
     {
         clID = clientId->lenstring.data;
     }
 
-    while (client != nullptr)
+    _epoch.enter();
+    Client* client = _idIndex.find(hashBytes(clID, len), [clID, len](Client* cl)
     {
-        if (strncmp((const char*) client->getClientId(), clID, MQTTSNstrlen(*clientId)) == 0)
-        {
-            _mutex.unlock();
-            return client;
-        }
-        client = client->_nextClient;
-    }
-    _mutex.unlock();
-    return 0;
+        return strlen(cl->getClientId()) == len && memcmp(cl->getClientId(), clID, len) == 0;
+    });
+    _epoch.leave();
+    return client;
 }
 
 Client* ClientList::createClient(SensorNetAddress* addr, MQTTSNString* clientId, int type)
@@ -339,9 +403,11 @@ Client* ClientList::createClient(SensorNetAddress* addr, MQTTSNString* clientId,
 
 Client* ClientList::createClient(SensorNetAddress* addr, MQTTSNString* clientId, bool unstableLine, bool secure, int type)
 {
+    _mutex.lock();
     Client* client = getClient(addr);
     if (client)
     {
+        _mutex.unlock();
         return client;
     }
 
@@ -350,6 +416,7 @@ Client* ClientList::createClient(SensorNetAddress* addr, MQTTSNString* clientId,
 
     if (!client)
     {
+        _mutex.unlock();
         WRITELOG("%s%sMax number of Clients%s\n", currentDateTime(),
         ERRMSG_HEADER, ERRMSG_FOOTER);
         return nullptr;
@@ -361,6 +428,10 @@ Client* ClientList::createClient(SensorNetAddress* addr, MQTTSNString* clientId,
         client->setClientAddress(addr);
     }
     client->setSensorNetType(unstableLine);
+    if (_gateway)
+    {
+        client->setMaxInflight(_gateway->getGWParams()->maxInflightMsgs);
+    }
     if (MQTTSNstrlen(*clientId))
     {
         client->setClientId(*clientId);
@@ -381,23 +452,29 @@ Client* ClientList::createClient(SensorNetAddress* addr, MQTTSNString* clientId,
     {
         client->setQoSm1();
     }
-    client->getNetwork()->setSecure(secure);
-
-    _mutex.lock();
+    client->setSecureNetwork(secure);
 
-    /* add the list */
-    if (_firstClient == nullptr)
+    /* add the list, readers see the client only after it has been set up */
+    if (_firstClient.load(std::memory_order_relaxed) == nullptr)
     {
-        _firstClient = client;
+        _firstClient.store(client, std::memory_order_release);
         _endClient = client;
     }
     else
     {
-        _endClient->_nextClient = client;
         client->_prevClient = _endClient;
+        _endClient->_nextClient.store(client, std::memory_order_release);
         _endClient = client;
     }
     _clientCnt++;
+
+    /* forwarded clients and the clients of predefined topics have no address, they would pile up in one cluster */
+    if (addr)
+    {
+        _addrIndex.add(client->getSensorNetAddress()->hash(), client);
+        client->_addrIndexed = true;
+    }
+    _idIndex.add(hashBytes(client->getClientId(), strlen(client->getClientId())), client);
     _mutex.unlock();
     return client;
 }
@@ -424,7 +501,10 @@ Client* ClientList::createPredefinedTopic(MQTTSNString* clientId, string topicNa
             return nullptr;
         }
 
-        client = createClient(NULL, clientId, aggregate);
+        if (client == nullptr)
+        {
+            client = createClient(NULL, clientId, aggregate ? AGGREGATER_TYPE : TRANSPEARENT_TYPE);
+        }
 
         if (client == nullptr)
         {
@@ -438,7 +518,7 @@ Client* ClientList::createPredefinedTopic(MQTTSNString* clientId, string topicNa
     }
 }
 
-uint16_t ClientList::getClientCount()
+int ClientList::getClientCount()
 {
     return _clientCnt;
 }
@@ -448,70 +528,179 @@ bool ClientList::isAuthorized()
     return _authorize;
 }
 
+/*
+ *  The hot fields of all slots of the pool. A slot is in use while its status is not Cstat_Free.
+ */
+ClientHotFields* ClientList::getHotFields(void)
+{
+    return _clientsPool->getHotFields();
+}
+
+Client* ClientList::getSlotClient(int slot)
+{
+    return _clientsPool->getSlotClient(slot);
+}
+
+/*
+ *  Bytes held by the pool and by the clients in the list.
+ *  The state of a client is walked without a lock, call it while the PacketHandleTasks are not running.
+ */
+size_t ClientList::getMemorySize(void)
+{
+    size_t size = sizeof(ClientList) + _clientsPool->getMemorySize();
+
+    _epoch.enter();
+    for (Client* client = _firstClient.load(std::memory_order_acquire); client; client = client->getNextClient())
+    {
+        size += client->getMemorySize() - sizeof(Client);
+    }
+    _epoch.leave();
+    return size;
+}
+
+/*
+ *  Clients found between beginRead() and endRead() are not deleted by erase() until endRead().
+ */
+void ClientList::beginRead(void)
+{
+    _epoch.enter();
+}
+
+void ClientList::endRead(void)
+{
+    _epoch.leave();
+}
+
 /******************************
  * Class ClientsPool
  ******************************/
 
 ClientsPool::ClientsPool()
 {
-    _clientCnt = 0;
+    _slab = nullptr;
+    _hot = nullptr;
     _firstClient = nullptr;
-    _endClient = nullptr;
+    _clientCnt = 0;
+    _epoch = nullptr;
 }
 
 ClientsPool::~ClientsPool()
 {
-    Client* cl = _firstClient;
-    Client* ncl;
-
-    while (cl != nullptr)
+    if (_slab)
     {
-        ncl = cl->_nextClient;
-        delete cl;
-        cl = ncl;
-    };
+        for (int i = 0; i < _hot->size; i++)
+        {
+            _slab[i].~Client();
+        }
+        ::operator delete(_slab);
+    }
+    if (_hot)
+    {
+        delete _hot;
+    }
 }
 
 void ClientsPool::allocate(int maxClients)
 {
-    Client* cl = nullptr;
+    if (_slab)
+    {
+        throw Exception("ClientsPool::Clients are already allocated\n", 0);
+    }
 
-    _firstClient = new Client();
+    int size = maxClients + 1;
+    _hot = new ClientHotFields(size);
+    _slab = (Client*) ::operator new(sizeof(Client) * size);
 
-    for (int i = 0; i < maxClients; i++)
+    for (int i = size - 1; i >= 0; i--)
     {
-        if ((cl = new Client()) == nullptr)
-        {
-            throw Exception("ClientsPool::Can't allocate max number of clients\n", 0);
-        }
+        Client* cl = new (&_slab[i]) Client(_hot, i);
+        cl->_pool = this;
         cl->_nextClient = _firstClient;
         _firstClient = cl;
         _clientCnt++;
     }
-
 }
 
 Client* ClientsPool::getClient(void)
 {
-    Client *cl = nullptr;
+    _mutex.lock();
+    Client* cl = _firstClient;
 
-    while (_firstClient != nullptr)
+    if (cl != nullptr)
     {
-        cl = _firstClient;
         _firstClient = cl->_nextClient;
         cl->_nextClient = nullptr;
         _clientCnt--;
-        break;
     }
+    _mutex.unlock();
     return cl;
 }
 
+/*
+ *  Returns the client to the pool. It is rebuilt in its slot, clean as a new one.
+ */
 void ClientsPool::setClient(Client* client)
 {
     if (client)
     {
+        int slot = client->_slot;
+        assert(client->_keepAliveSlot == nullptr);    // rebuilding it would break the links of the wheel
+        client->~Client();
+        client = new (&_slab[slot]) Client(_hot, slot);
+        client->_pool = this;
+
+        _mutex.lock();
         client->_nextClient = _firstClient;
         _firstClient = client;
         _clientCnt++;
+        _mutex.unlock();
+    }
+}
+
+Client* ClientsPool::getSlotClient(int slot)
+{
+    return &_slab[slot];
+}
+
+ClientHotFields* ClientsPool::getHotFields(void)
+{
+    return _hot;
+}
+
+/*
+ *  Networks released by the Clients are deleted after the readers of the ClientList left.
+ */
+void ClientsPool::setEpoch(Epoch* epoch)
+{
+    _epoch = epoch;
+}
+
+static void deleteNetwork(void* network)
+{
+    delete (Network*) network;
+}
+
+void ClientsPool::retire(Network* network)
+{
+    if (_epoch)
+    {
+        _epoch->retire(network, deleteNetwork);
+    }
+    else
+    {
+        delete network;
+    }
+}
+
+/*
+ *  Bytes of the slab and of the hot fields, the clients are allocated in advance.
+ */
+size_t ClientsPool::getMemorySize(void)
+{
+    if (_hot == nullptr)
+    {
+        return sizeof(ClientsPool);
     }
+    return sizeof(ClientsPool) + sizeof(ClientHotFields)
+            + _hot->size * (sizeof(Client) + sizeof(ClientStatus) + sizeof(uint32_t) + sizeof(int) + sizeof(SensorNetAddress));
 }
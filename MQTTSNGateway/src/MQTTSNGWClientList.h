@@ -29,9 +29,13 @@ namespace MQTTSNGW
 #define FORWARDER_TYPE  3
 
 class Client;
+class ClientHotFields;
 
 /*=====================================
  Class ClientsPool
+
+ Allocates all Clients in one array, the slot of a Client is its index.
+ The fields read by the sweeps over all clients are kept apart in a ClientHotFields.
  =====================================*/
 class ClientsPool
 {
@@ -41,11 +45,19 @@ public:
 	void allocate(int maxClients);
 	Client* getClient(void);
 	void setClient(Client* client);
+	Client* getSlotClient(int slot);
+	ClientHotFields* getHotFields(void);
+	void setEpoch(Epoch* epoch);
+	void retire(Network* network);
+	size_t getMemorySize(void);
 
 private:
-	Client* _firstClient;
-	Client* _endClient;
+	Client* _slab;             // Clients of all slots in one block
+	ClientHotFields* _hot;
+	Client* _firstClient;      // free Clients
 	int _clientCnt;
+	Mutex _mutex;
+	Epoch* _epoch;
 };
 
 /*=====================================
@@ -58,6 +70,7 @@ public:
     ~ClientList();
 
     void initialize(bool aggregate);
+    void allocate(int maxClients);
     void setClientList(int type);
     void setPredefinedTopics(bool aggregate);
     void erase(Client*&);
@@ -66,24 +79,36 @@ public:
     Client* createClient(SensorNetAddress* addr, MQTTSNString* clientId,
             bool unstableLine, bool secure, int type);
     bool createList(const char* fileName, int type);
+    void setClientAddress(Client* client, SensorNetAddress* addr);
     Client* getClient(SensorNetAddress* addr);
     Client* getClient(MQTTSNString* clientId);
     Client* getClient(int index);
-    uint16_t getClientCount(void);
+    int getClientCount(void);
     Client* getClient(void);
     bool isAuthorized();
+    ClientHotFields* getHotFields(void);
+    Client* getSlotClient(int slot);
+    size_t getMemorySize(void);
+    void beginRead(void);
+    void endRead(void);
 
 private:
     bool readPredefinedList(const char* fileName, bool _aggregate);
+    Client* createOrUpdateClient(SensorNetAddress* addr, MQTTSNString* clientId,
+            bool unstableLine, bool secure, int type);
 	ClientsPool* _clientsPool;
 	Gateway* _gateway;
     Client* createPredefinedTopic(MQTTSNString* clientId, string topicName,
             uint16_t toipcId, bool _aggregate);
-    Client* _firstClient;
+    static void releaseClient(void* client);
+    std::atomic<Client*> _firstClient;
     Client* _endClient;
-    Mutex _mutex;
-    uint16_t _clientCnt;
-    uint16_t _maxClients;
+    Mutex _mutex;             // serializes writers, readers take no lock
+    Epoch _epoch;             // reclaims erased Clients after the readers left
+    HashIndex<Client> _addrIndex;    // Clients by SensorNetAddress
+    HashIndex<Client> _idIndex;      // Clients by ClientId
+    int _clientCnt;
+    int _maxClients;
     bool _authorize { false };
 };
 
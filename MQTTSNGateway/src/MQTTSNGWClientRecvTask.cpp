@@ -48,208 +48,228 @@ void ClientRecvTask::initialize(int argc, char** argv)
  */
 void ClientRecvTask::run()
 {
-    Event* ev = nullptr;
-    AdapterManager* adpMgr = _gateway->getAdapterManager();
-    QoSm1Proxy* qosm1Proxy = adpMgr->getQoSm1Proxy();
-    int clientType = adpMgr->isAggregaterActive() ? AGGREGATER_TYPE : TRANSPEARENT_TYPE;
+    PacketEventQue* packetEventQue = _gateway->getPacketEventQue();
     ClientList* clientList = _gateway->getClientList();
-    EventQue* packetEventQue = _gateway->getPacketEventQue();
-    EventQue* clientsendQue = _gateway->getClientSendQue();
-
-    char buf[128];
 
     while (true)
     {
-        Client* client = nullptr;
-        Forwarder* fwd = nullptr;
-        WirelessNodeId nodeId;
-
-        MQTTSNPacket* packet = new MQTTSNPacket();
-        int packetLen = packet->recv(_sensorNetwork);
-
         if (CHK_SIGINT)
         {
             WRITELOG("%s %s stopped.\n", currentDateTime(), getTaskName());
-            delete packet;
             return;
         }
 
-        if (packetLen < 2)
+        /* slow down the intake while the PacketEventQue is dropping PUBLISH */
+        for (int i = 0; i < EVENTQUE_BACKOFF_CNT && packetEventQue->isCongested(); i++)
         {
-            delete packet;
-            continue;
+            usleep(EVENTQUE_BACKOFF_USEC);
         }
 
-        if (packet->getType() <= MQTTSN_ADVERTISE || packet->getType() == MQTTSN_GWINFO)
-        {
-            delete packet;
-            continue;
-        }
+        MQTTSNPacket* packet = new MQTTSNPacket();
+        int packetLen = packet->recv(_sensorNetwork);
 
-        if (packet->getType() == MQTTSN_SEARCHGW)
-        {
-            /* write log and post Event */
-            log(0, packet, 0);
-            ev = new Event();
-            ev->setBrodcastEvent(packet);
-            packetEventQue->post(ev);
-            continue;
-        }
+        /* the Client found for the packet is not deleted until the Event has been posted,
+         * a packet received while stopping is still posted and drained by Gateway::stopTasks() */
+        clientList->beginRead();
+        handlePacket(packet, packetLen);
+        clientList->endRead();
+    }
+}
 
-        SensorNetAddress senderAddr = *_gateway->getSensorNetwork()->getSenderAddress();
+/*
+ * Handles a packet received from the sensor network.
+ * The packet is deleted or handed over to the PacketHandleTask with an Event.
+ */
+void ClientRecvTask::handlePacket(MQTTSNPacket* packet, int packetLen)
+{
+    Event* ev = nullptr;
+    AdapterManager* adpMgr = _gateway->getAdapterManager();
+    QoSm1Proxy* qosm1Proxy = adpMgr->getQoSm1Proxy();
+    int clientType = adpMgr->isAggregaterActive() ? AGGREGATER_TYPE : TRANSPEARENT_TYPE;
+    ClientList* clientList = _gateway->getClientList();
+    PacketEventQue* packetEventQue = _gateway->getPacketEventQue();
+    EventQue* clientsendQue = _gateway->getClientSendQue();
+    Client* client = nullptr;
+    Forwarder* fwd = nullptr;
+    WirelessNodeId nodeId;
 
-        if (packet->getType() == MQTTSN_ENCAPSULATED)
-        {
-            fwd = _gateway->getAdapterManager()->getForwarderList()->getForwarder(&senderAddr);
+    char buf[128];
 
-            if (fwd != nullptr)
-            {
-                MQTTSNString fwdName = MQTTSNString_initializer;
-                fwdName.cstring = const_cast<char *>(fwd->getName());
-                log(0, packet, &fwdName);
-
-                /* get the packet from the encapsulation message */
-                MQTTSNGWEncapsulatedPacket encap;
-                encap.desirialize(packet->getPacketData(), packet->getPacketLength());
-                nodeId.setId(encap.getWirelessNodeId());
-                client = fwd->getClient(&nodeId);
-                packet = encap.getMQTTSNPacket();
-            }
+    if (packetLen < 2)
+    {
+        delete packet;
+        return;
+    }
+
+    if (packet->getType() <= MQTTSN_ADVERTISE || packet->getType() == MQTTSN_GWINFO)
+    {
+        delete packet;
+        return;
+    }
+
+    if (packet->getType() == MQTTSN_SEARCHGW)
+    {
+        /* write log and post Event */
+        log(0, packet, 0);
+        ev = new Event();
+        ev->setBrodcastEvent(packet);
+        packetEventQue->post(ev);
+        return;
+    }
+
+    SensorNetAddress senderAddr = *_gateway->getSensorNetwork()->getSenderAddress();
+
+    if (packet->getType() == MQTTSN_ENCAPSULATED)
+    {
+        fwd = _gateway->getAdapterManager()->getForwarderList()->getForwarder(&senderAddr);
+
+        if (fwd != nullptr)
+        {
+            MQTTSNString fwdName = MQTTSNString_initializer;
+            fwdName.cstring = const_cast<char *>(fwd->getName());
+            log(0, packet, &fwdName);
+
+            /* get the packet from the encapsulation message */
+            MQTTSNGWEncapsulatedPacket encap;
+            encap.desirialize(packet->getPacketData(), packet->getPacketLength());
+            nodeId.setId(encap.getWirelessNodeId());
+            client = fwd->getClient(&nodeId);
+            packet = encap.getMQTTSNPacket();
         }
-        else
+    }
+    else
+    {
+        /*   Check the client belonging to QoS-1Proxy  ?    */
+
+        if (qosm1Proxy->isActive())
         {
-            /*   Check the client belonging to QoS-1Proxy  ?    */
+            const char *clientName = qosm1Proxy->getClientId(&senderAddr);
 
-            if (qosm1Proxy->isActive())
+            if (clientName != nullptr)
             {
-                const char *clientName = qosm1Proxy->getClientId(&senderAddr);
+                client = qosm1Proxy->getClient();
 
-                if (clientName != nullptr)
+                if (!packet->isQoSMinusPUBLISH())
                 {
-                    client = qosm1Proxy->getClient();
-
-                    if (!packet->isQoSMinusPUBLISH())
-                    {
-                        log(clientName, packet);
-                        WRITELOG("%s %s  %s can send only PUBLISH with QoS-1.%s\n",
-                        ERRMSG_HEADER, clientName, senderAddr.sprint(buf), ERRMSG_FOOTER);
-                        delete packet;
-                        continue;
-                    }
+                    log(clientName, packet);
+                    WRITELOG("%s %s  %s can send only PUBLISH with QoS-1.%s\n",
+                    ERRMSG_HEADER, clientName, senderAddr.sprint(buf), ERRMSG_FOOTER);
+                    delete packet;
+                    return;
                 }
             }
+        }
 
-            if (client == nullptr)
-            {
-                client = _gateway->getClientList()->getClient(&senderAddr);
-            }
+        if (client == nullptr)
+        {
+            client = _gateway->getClientList()->getClient(&senderAddr);
         }
+    }
+
+    if (client != nullptr)
+    {
+        log(client, packet, 0);
 
-        if (client != nullptr)
+        if (client->isDisconnect() && packet->getType() != MQTTSN_CONNECT)
         {
-            log(client, packet, 0);
+            WRITELOG("%s MQTTSNGWClientRecvTask %s is not connecting.%s\n",
+            ERRMSG_HEADER, client->getClientId(), ERRMSG_FOOTER);
 
-            if (client->isDisconnect() && packet->getType() != MQTTSN_CONNECT)
-            {
-                WRITELOG("%s MQTTSNGWClientRecvTask %s is not connecting.%s\n",
-                ERRMSG_HEADER, client->getClientId(), ERRMSG_FOOTER);
-
-                /* send DISCONNECT to the client, if it is not connected */
-                MQTTSNPacket* snPacket = new MQTTSNPacket();
-                snPacket->setDISCONNECT(0);
-                ev = new Event();
-                ev->setClientSendEvent(client, snPacket);
-                clientsendQue->post(ev);
-                delete packet;
-                continue;
-            }
-            else
-            {
-                ev = new Event();
-                ev->setClientRecvEvent(client, packet);
-                packetEventQue->post(ev);
-            }
+            /* send DISCONNECT to the client, if it is not connected */
+            MQTTSNPacket* snPacket = new MQTTSNPacket();
+            snPacket->setDISCONNECT(0);
+            ev = new Event();
+            ev->setClientSendEvent(client, snPacket);
+            clientsendQue->post(ev);
+            delete packet;
+            return;
         }
         else
         {
-            /* new client */
-            if (packet->getType() == MQTTSN_CONNECT)
+            ev = new Event();
+            ev->setClientRecvEvent(client, packet);
+            packetEventQue->post(ev);
+        }
+    }
+    else
+    {
+        /* new client */
+        if (packet->getType() == MQTTSN_CONNECT)
+        {
+            MQTTSNPacket_connectData data;
+            memset(&data, 0, sizeof(MQTTSNPacket_connectData));
+            if (!packet->getCONNECT(&data))
             {
-                MQTTSNPacket_connectData data;
-                memset(&data, 0, sizeof(MQTTSNPacket_connectData));
-                if (!packet->getCONNECT(&data))
-                {
-                    log(0, packet, &data.clientID);
-                    WRITELOG("%s CONNECT message form %s is incorrect.%s\n",
-                    ERRMSG_HEADER, senderAddr.sprint(buf),
-                    ERRMSG_FOOTER);
-                    delete packet;
-                    continue;
-                }
+                log(0, packet, &data.clientID);
+                WRITELOG("%s CONNECT message form %s is incorrect.%s\n",
+                ERRMSG_HEADER, senderAddr.sprint(buf),
+                ERRMSG_FOOTER);
+                delete packet;
+                return;
+            }
 
-                client = clientList->getClient(&data.clientID);
+            client = clientList->getClient(&data.clientID);
 
-                if (fwd != nullptr)
+            if (fwd != nullptr)
+            {
+                if (client == nullptr)
+                {
+                    /* create a new client */
+                    client = clientList->createClient(0, &data.clientID, clientType);
+                }
+                /* Add to a forwarded client list of forwarder. */
+                fwd->addClient(client, &nodeId);
+            }
+            else
+            {
+                if (client)
                 {
-                    if (client == nullptr)
+                    /* Authentication is not required */
+                    if (_gateway->getGWParams()->clientAuthentication == false)
                     {
-                        /* create a new client */
-                        client = clientList->createClient(0, &data.clientID, clientType);
+                        clientList->setClientAddress(client, &senderAddr);
                     }
-                    /* Add to a forwarded client list of forwarder. */
-                    fwd->addClient(client, &nodeId);
                 }
                 else
                 {
-                    if (client)
-                    {
-                        /* Authentication is not required */
-                        if (_gateway->getGWParams()->clientAuthentication == false)
-                        {
-                            client->setClientAddress(&senderAddr);
-                        }
-                    }
-                    else
-                    {
-                        /* create a new client */
-                        client = clientList->createClient(&senderAddr, &data.clientID, clientType);
-                    }
+                    /* create a new client */
+                    client = clientList->createClient(&senderAddr, &data.clientID, clientType);
                 }
+            }
 
-                log(client, packet, &data.clientID);
+            log(client, packet, &data.clientID);
 
-                if (client == nullptr)
-                {
-                    WRITELOG("%s Client(%s) was rejected. CONNECT message has been discarded.%s\n",
-                    ERRMSG_HEADER, senderAddr.sprint(buf),
-                    ERRMSG_FOOTER);
-                    delete packet;
-                    continue;
-                }
+            if (client == nullptr)
+            {
+                WRITELOG("%s Client(%s) was rejected. CONNECT message has been discarded.%s\n",
+                ERRMSG_HEADER, senderAddr.sprint(buf),
+                ERRMSG_FOOTER);
+                delete packet;
+                return;
+            }
 
-                /* post Client RecvEvent */
-                ev = new Event();
-                ev->setClientRecvEvent(client, packet);
-                packetEventQue->post(ev);
+            /* post Client RecvEvent */
+            ev = new Event();
+            ev->setClientRecvEvent(client, packet);
+            packetEventQue->post(ev);
+        }
+        else
+        {
+            log(client, packet, 0);
+            if (packet->getType() == MQTTSN_ENCAPSULATED)
+            {
+                WRITELOG(
+                        "%s MQTTSNGWClientRecvTask  Forwarder(%s) is not declared by ClientList file. message has been discarded.%s\n",
+                        ERRMSG_HEADER, _sensorNetwork->getSenderAddress()->sprint(buf),
+                        ERRMSG_FOOTER);
             }
             else
             {
-                log(client, packet, 0);
-                if (packet->getType() == MQTTSN_ENCAPSULATED)
-                {
-                    WRITELOG(
-                            "%s MQTTSNGWClientRecvTask  Forwarder(%s) is not declared by ClientList file. message has been discarded.%s\n",
-                            ERRMSG_HEADER, _sensorNetwork->getSenderAddress()->sprint(buf),
-                            ERRMSG_FOOTER);
-                }
-                else
-                {
-                    WRITELOG("%s MQTTSNGWClientRecvTask  Client(%s) is not connecting. message has been discarded.%s\n",
-                    ERRMSG_HEADER, senderAddr.sprint(buf),
-                    ERRMSG_FOOTER);
-                }
-                delete packet;
+                WRITELOG("%s MQTTSNGWClientRecvTask  Client(%s) is not connecting. message has been discarded.%s\n",
+                ERRMSG_HEADER, senderAddr.sprint(buf),
+                ERRMSG_FOOTER);
             }
+            delete packet;
         }
     }
 }
@@ -35,6 +35,7 @@ public:
     ~ClientRecvTask(void);
     virtual void initialize(int argc, char** argv);
     void run(void);
+    void handlePacket(MQTTSNPacket* packet, int packetLen);
 
 private:
     void log(Client*, MQTTSNPacket*, MQTTSNString* id);
@@ -40,56 +40,64 @@ ClientSendTask::~ClientSendTask()
 
 void ClientSendTask::run()
 {
-    Client* client = nullptr;
-    MQTTSNPacket* packet = nullptr;
-    AdapterManager* adpMgr = _gateway->getAdapterManager();
-    int rc = 0;
-
     while (true)
     {
         Event* ev = _gateway->getClientSendQue()->wait();
 
-        if (ev->getEventType() == EtStop || _gateway->IsStopping())
+        if (ev->getEventType() == EtStop)
         {
             WRITELOG("%s %s stopped.\n", currentDateTime(), getTaskName());
             delete ev;
             break;
         }
 
-        if (ev->getEventType() == EtBroadcast)
+        handleEvent(ev);
+        delete ev;
+    }
+}
+
+/*
+ * Sends the packet of the Event to clients. The Event is deleted by the caller.
+ */
+void ClientSendTask::handleEvent(Event* ev)
+{
+    Client* client = nullptr;
+    MQTTSNPacket* packet = nullptr;
+    AdapterManager* adpMgr = _gateway->getAdapterManager();
+    int rc = 0;
+
+    if (ev->getEventType() == EtBroadcast)
+    {
+        packet = ev->getMQTTSNPacket();
+        log(client, packet);
+
+        if (packet->broadcast(_sensorNetwork) < 0)
+        {
+            WRITELOG("%s ClientSendTask can't multicast a packet Error=%d%s\n",
+            ERRMSG_HEADER, errno, ERRMSG_FOOTER);
+        }
+    }
+    else
+    {
+        if (ev->getEventType() == EtClientSend)
         {
+            client = ev->getClient();
             packet = ev->getMQTTSNPacket();
-            log(client, packet);
-
-            if (packet->broadcast(_sensorNetwork) < 0)
-            {
-                WRITELOG("%s ClientSendTask can't multicast a packet Error=%d%s\n",
-                ERRMSG_HEADER, errno, ERRMSG_FOOTER);
-            }
+            rc = adpMgr->unicastToClient(client, packet, this);
         }
-        else
+        else if (ev->getEventType() == EtSensornetSend)
         {
-            if (ev->getEventType() == EtClientSend)
-            {
-                client = ev->getClient();
-                packet = ev->getMQTTSNPacket();
-                rc = adpMgr->unicastToClient(client, packet, this);
-            }
-            else if (ev->getEventType() == EtSensornetSend)
-            {
-                packet = ev->getMQTTSNPacket();
-                log(client, packet);
-                rc = packet->unicast(_sensorNetwork, ev->getSensorNetAddress());
-            }
+            packet = ev->getMQTTSNPacket();
+            log(client, packet);
+            rc = packet->unicast(_sensorNetwork, ev->getSensorNetAddress());
+        }
 
-            if (rc < 0)
-            {
-                WRITELOG("%s ClientSendTask can't send a packet to the client %s. Error=%d%s\n",
-                ERRMSG_HEADER, (client ? (const char*) client->getClientId() : UNKNOWNCL),
-                errno, ERRMSG_FOOTER);
-            }
+        if (rc < 0)
+        {
+            WRITELOG("%s ClientSendTask can't send a packet to the client %s. Error=%d%s\n",
+            ERRMSG_HEADER, (client ? (const char*) client->getClientId() : UNKNOWNCL),
+            errno, ERRMSG_FOOTER);
         }
-        delete ev;
     }
 }
 
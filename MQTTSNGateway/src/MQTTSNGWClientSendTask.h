@@ -34,6 +34,7 @@ public:
     ClientSendTask(Gateway* gateway);
     ~ClientSendTask(void);
     void run(void);
+    void handleEvent(Event* ev);
 
 private:
     void log(Client* client, MQTTSNPacket* packet);
@@ -22,6 +22,7 @@
 
 using namespace std;
 using namespace MQTTSNGW;
+char* currentDateTime(void);
 
 /*=====================================
  Class MQTTSNConnectionHandler
@@ -42,7 +43,7 @@ MQTTSNConnectionHandler::~MQTTSNConnectionHandler()
 void MQTTSNConnectionHandler::sendADVERTISE()
 {
     MQTTSNPacket* adv = new MQTTSNPacket();
-    adv->setADVERTISE(_gateway->getGWParams()->gatewayId, _gateway->getGWParams()->keepAlive);
+    adv->setADVERTISE(_gateway->getGWParams()->gatewayId, _gateway->getGWParams()->keepAlive.load(std::memory_order_relaxed));
     Event* ev1 = new Event();
     ev1->setBrodcastEvent(adv);  //broadcast
     _gateway->getClientSendQue()->post(ev1);
@@ -296,6 +297,28 @@ void MQTTSNConnectionHandler::handlePingreq(Client* client, MQTTSNPacket* packet
     }
 }
 
+/*
+ *  Keep Alive timeout
+ */
+void MQTTSNConnectionHandler::handleKeepAliveTimeout(Client* client)
+{
+    if (!client->isActive())
+    {
+        return;
+    }
+
+    WRITELOG("%s %s is lost. Keep alive timer expired.\n", currentDateTime(), client->getClientId());
+    client->updateStatus(Cstat_Lost);
+
+    /* close the connection without DISCONNECT, then the broker publishes the will. */
+    Network* network = client->getExistingNetwork();
+    if (network && !client->isAggregated() && !client->isAdapter())
+    {
+        network->close();
+    }
+    client->shrink();
+}
+
 void MQTTSNConnectionHandler::sendStoredPublish(Client* client)
 {
     MQTTGWPacket* msg = nullptr;
@@ -36,6 +36,7 @@ public:
     void handleWilltopicupd(Client* client, MQTTSNPacket* packet);
     void handleWillmsgupd(Client* client, MQTTSNPacket* packet);
     void handlePingreq(Client* client, MQTTSNPacket* packet);
+    void handleKeepAliveTimeout(Client* client);
 private:
     void sendStoredPublish(Client* client);
 
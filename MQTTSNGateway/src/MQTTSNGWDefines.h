@@ -40,11 +40,18 @@ namespace MQTTSNGW
 #define MAX_CLIENTS                 (100)  // Default number of Clients can be handled.
 #define MAX_CLIENTID_LENGTH          (64)  // Max length of clientID
 #define MAX_INFLIGHTMESSAGES         (10)  // Number of inflight messages
-#define MAX_MESSAGEID_TABLE_SIZE    (500)  // Number of MessageIdTable size
 #define MAX_SAVED_PUBLISH            (20)  // Max number of PUBLISH message for Asleep state
-#define MAX_TOPIC_PAR_CLIENT         (50)  // Max Topic count for a client. it should be less than 256
+#define MAX_TOPIC_PAR_CLIENT       (4096)  // Max Topic count for a client. it should be less than 0xfffe
 #define MQTTSNGW_MAX_PACKET_SIZE   (1024)  // Max Packet size  (5+2+TopicLen+PayloadLen + Foward Encapsulation)
 #define SIZE_OF_LOG_PACKET          (500)  // Length of the packet log in bytes
+#define DEFAULT_EVENTQUE_SIZE      (4096)  // Capacity of an EventQue which has no max size
+#define EVENTQUE_QOS12_LIMIT         (90)  // % of an EventQue which QoS1/2 PUBLISH can use
+#define EVENTQUE_QOS0_LIMIT          (75)  // % of an EventQue which QoS0/-1 PUBLISH can use
+#define EVENTQUE_BACKOFF_USEC      (1000)  // ClientRecvTask waits while PacketEventQue is congested
+#define EVENTQUE_BACKOFF_CNT        (100)  //  up to EVENTQUE_BACKOFF_USEC * EVENTQUE_BACKOFF_CNT
+#define MAX_PACKET_HANDLE_TASKS       (8)  // Max number of PacketHandleTasks
+#define EVENT_POOL_SLAB_SIZE        (256)  // Number of Events allocated at once by the EventPool
+#define EVENT_POOL_MAX_SLABS       (1024)  // Events beyond the slabs are allocated from the heap
 
 #define PROXY_KEEPALIVE_DURATION   (900)   // Seconds
 #define PROXY_RESPONSE_DURATION     (10)   // Seconds
@@ -16,6 +16,7 @@
 #include "MQTTSNGWPacket.h"
 #include "MQTTSNGWEncapsulatedPacket.h"
 #include "MQTTSNPacket.h"
+#include "MQTTSNGWProcess.h"
 #include <string.h>
 
 using namespace MQTTSNGW;
@@ -72,6 +73,11 @@ bool WirelessNodeId::operator ==(WirelessNodeId& id)
     }
 }
 
+uint32_t WirelessNodeId::hash(void)
+{
+    return hashBytes(_nodeId, _len);
+}
+
 /*
  *    Class MQTTSNGWEncapsulatedPacket
  */
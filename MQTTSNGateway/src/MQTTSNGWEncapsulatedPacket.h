@@ -29,6 +29,7 @@ public:
     void setId(uint8_t* id, uint8_t len);
     void setId(WirelessNodeId* id);
     bool operator ==(WirelessNodeId& id);
+    uint32_t hash(void);
 private:
     uint8_t _len;
     uint8_t* _nodeId;
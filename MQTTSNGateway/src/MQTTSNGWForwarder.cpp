@@ -50,18 +50,15 @@ void ForwarderList::initialize(Gateway* gw)
     gw->getClientList()->setClientList(FORWARDER_TYPE);
 }
 
+/*
+ *  Forwarders are added while the ClientList is read, they are never erased.
+ */
 Forwarder* ForwarderList::getForwarder(SensorNetAddress* addr)
 {
-    Forwarder* p = _head;
-    while (p)
+    return _addrIndex.find(addr->hash(), [addr](Forwarder* fwd)
     {
-        if (p->_sensorNetAddr.isMatch(addr))
-        {
-            break;
-        }
-        p = p->_next;
-    }
-    return p;
+        return fwd->_sensorNetAddr.isMatch(addr);
+    });
 }
 
 Forwarder* ForwarderList::addForwarder(SensorNetAddress* addr, MQTTSNString* forwarderId)
@@ -87,6 +84,7 @@ Forwarder* ForwarderList::addForwarder(SensorNetAddress* addr, MQTTSNString* for
             }
         }
     }
+    _addrIndex.add(fdr->_sensorNetAddr.hash(), fdr);
     return fdr;
 }
 
@@ -127,60 +125,54 @@ const char* Forwarder::getId(void)
     return _forwarderName.c_str();
 }
 
-void Forwarder::addClient(Client* client, WirelessNodeId* id)
+ForwarderElement* Forwarder::findClient(Client* client)
 {
-    ForwarderElement* p = _headClient;
-    ForwarderElement* prev = nullptr;
+    return _clientIndex.find(hashPointer(client), [client](ForwarderElement* elm)
+    {
+        return elm->_client == client;
+    });
+}
 
+void Forwarder::addClient(Client* client, WirelessNodeId* id)
+{
     client->setForwarder(this);
 
-    if (p != nullptr)
+    _mutex.lock();
+    ForwarderElement* fclient = findClient(client);
+
+    if (fclient != nullptr)
     {
-        while (p)
-        {
-            if (p->_client == client)
-            {
-                client->setForwarder(this);
-                p->setWirelessNodeId(id);
-                return;
-            }
-            prev = p;
-            p = p->_next;
-        }
+        _nodeIndex.remove(fclient->_wirelessNodeId->hash(), fclient);
+        fclient->setWirelessNodeId(id);
+        _nodeIndex.add(fclient->_wirelessNodeId->hash(), fclient);
+        _mutex.unlock();
+        return;
     }
 
-    ForwarderElement* fclient = new ForwarderElement();
-
+    fclient = new ForwarderElement();
     fclient->setClient(client);
     fclient->setWirelessNodeId(id);
 
-    if (prev)
-    {
-        prev->_next = fclient;
-    }
-    else
+    fclient->_next = _headClient;
+    if (_headClient)
     {
-        _headClient = fclient;
+        _headClient->_prev = fclient;
     }
+    _headClient = fclient;
+    _nodeIndex.add(fclient->_wirelessNodeId->hash(), fclient);
+    _clientIndex.add(hashPointer(client), fclient);
+    _clientCnt++;
+    _mutex.unlock();
 }
 
 Client* Forwarder::getClient(WirelessNodeId* id)
 {
-    Client* cl = nullptr;
     _mutex.lock();
-    ForwarderElement* p = _headClient;
-    while (p)
+    ForwarderElement* elm = _nodeIndex.find(id->hash(), [id](ForwarderElement* p)
     {
-        if (*(p->_wirelessNodeId) == *id)
-        {
-            cl = p->_client;
-            break;
-        }
-        else
-        {
-            p = p->_next;
-        }
-    }
+        return *(p->_wirelessNodeId) == *id;
+    });
+    Client* cl = elm ? elm->_client : nullptr;
     _mutex.unlock();
     return cl;
 }
@@ -192,54 +184,45 @@ const char* Forwarder::getName(void)
 
 WirelessNodeId* Forwarder::getWirelessNodeId(Client* client)
 {
-    WirelessNodeId* nodeId = nullptr;
     _mutex.lock();
-    ForwarderElement* p = _headClient;
-    while (p)
-    {
-        if (p->_client == client)
-        {
-            nodeId = p->_wirelessNodeId;
-            break;
-        }
-        else
-        {
-            p = p->_next;
-        }
-    }
+    ForwarderElement* elm = findClient(client);
+    WirelessNodeId* nodeId = elm ? elm->_wirelessNodeId : nullptr;
     _mutex.unlock();
     return nodeId;
 }
 
 void Forwarder::eraseClient(Client* client)
 {
-    ForwarderElement* prev = nullptr;
     _mutex.lock();
-    ForwarderElement* p = _headClient;
+    ForwarderElement* p = findClient(client);
 
-    while (p)
+    if (p)
     {
-        if (p->_client == client)
+        if (p->_prev)
         {
-            if (prev)
-            {
-                prev->_next = p->_next;
-            }
-            else
-            {
-                _headClient = p->_next;
-            }
-            delete p;
-            break;
+            p->_prev->_next = p->_next;
         }
         else
         {
-            p = p->_next;
+            _headClient = p->_next;
         }
+        if (p->_next)
+        {
+            p->_next->_prev = p->_prev;
+        }
+        _nodeIndex.remove(p->_wirelessNodeId->hash(), p);
+        _clientIndex.remove(hashPointer(client), p);
+        _clientCnt--;
+        delete p;
     }
     _mutex.unlock();
 }
 
+int Forwarder::getClientCount(void)
+{
+    return _clientCnt;
+}
+
 SensorNetAddress* Forwarder::getSensorNetAddr(void)
 {
     return &_sensorNetAddr;
@@ -250,7 +233,7 @@ SensorNetAddress* Forwarder::getSensorNetAddr(void)
  */
 
 ForwarderElement::ForwarderElement() :
-        _client { 0 }, _wirelessNodeId { 0 }, _next { 0 }
+        _client { 0 }, _wirelessNodeId { 0 }, _next { 0 }, _prev { 0 }
 {
 }
 
@@ -44,6 +44,7 @@ private:
     Client* _client;
     WirelessNodeId* _wirelessNodeId;
     ForwarderElement* _next;
+    ForwarderElement* _prev;
 };
 
 /*=====================================
@@ -65,12 +66,18 @@ public:
     void eraseClient(Client* client);
     SensorNetAddress* getSensorNetAddr(void);
     const char* getName(void);
+    int getClientCount(void);
 
 private:
+    ForwarderElement* findClient(Client* client);
+
     string _forwarderName;
     SensorNetAddress _sensorNetAddr;
     ForwarderElement* _headClient { nullptr };
     Forwarder* _next { nullptr };
+    HashIndex<ForwarderElement> _nodeIndex;      // elements by WirelessNodeId
+    HashIndex<ForwarderElement> _clientIndex;    // elements by Client
+    int _clientCnt { 0 };
     Mutex _mutex;
 };
 
@@ -89,6 +96,7 @@ public:
 
 private:
     Forwarder* _head;
+    HashIndex<Forwarder> _addrIndex;    // Forwarders by SensorNetAddress
 };
 
 }
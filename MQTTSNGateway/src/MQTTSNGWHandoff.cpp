@@ -0,0 +1,738 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+
+#include "MQTTSNGWHandoff.h"
+#include "MQTTSNGateway.h"
+#include "MQTTSNGWProcess.h"
+#include "MQTTSNGWClient.h"
+#include "MQTTSNGWClientList.h"
+#include "MQTTSNGWTopic.h"
+#include "SensorNetwork.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+
+#ifdef __APPLE__
+/* Handoff::initialize() refuses the HandoffSocket, these let the file build */
+#define SOCK_CLOEXEC      0
+#define MSG_CMSG_CLOEXEC  0
+#define MSG_NOSIGNAL      0
+#endif
+
+using namespace MQTTSNGW;
+
+char* currentDateTime(void);
+
+/*
+ *  Encoders of the items. Items are read by the same binary on the same host,
+ *  so integers are copied in the host byte order.
+ */
+static void putInt(uint8_t** pptr, uint32_t val, int size)
+{
+    memcpy(*pptr, &val, size);
+    *pptr += size;
+}
+
+static uint32_t getInt(uint8_t** pptr, int size)
+{
+    uint32_t val = 0;
+    memcpy(&val, *pptr, size);
+    *pptr += size;
+    return val;
+}
+
+static void putString(uint8_t** pptr, const char* str)
+{
+    uint16_t len = str ? strlen(str) : 0;
+    putInt(pptr, len, 2);
+    if (len)
+    {
+        memcpy(*pptr, str, len);
+        *pptr += len;
+    }
+}
+
+static bool getString(uint8_t** pptr, uint8_t* end, MQTTSNString* str)
+{
+    uint16_t len = getInt(pptr, 2);
+    if (*pptr + len > end)
+    {
+        return false;
+    }
+    str->cstring = nullptr;
+    str->lenstring.len = len;
+    str->lenstring.data = (char*) *pptr;
+    *pptr += len;
+    return true;
+}
+
+/*
+ *  Sessions and broker connections are handed over only between processes of the same user.
+ */
+static bool isSameUser(int fd)
+{
+#ifdef __APPLE__
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(fd, &uid, &gid) == 0 && uid == geteuid();
+#else
+    ucred cred;
+    socklen_t len = sizeof(cred);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == geteuid();
+#endif
+}
+
+/*=====================================
+ Class Handoff
+ =====================================*/
+Handoff::Handoff(Gateway* gateway)
+{
+    _gateway = gateway;
+    for (int i = 0; i < HANDOFF_MAX_FDS; i++)
+    {
+        _sensorFds[i] = -1;
+    }
+}
+
+Handoff::~Handoff()
+{
+    if (_connFd >= 0)
+    {
+        close(_connFd);
+    }
+    if (_listenFd >= 0)
+    {
+        /* the path belongs to the next process after a handoff */
+        close(_listenFd);
+    }
+    if (_path)
+    {
+        free(_path);
+    }
+}
+
+void Handoff::initialize(const char* path)
+{
+#ifdef __APPLE__
+    /* SOCK_SEQPACKET of AF_UNIX is not available */
+    throw Exception("Handoff::initialize: HandoffSocket is not supported on this platform.", 0);
+#else
+    if (strlen(path) >= sizeof(((sockaddr_un*) 0)->sun_path))
+    {
+        throw Exception("Handoff::initialize: HandoffSocket is too long.", 0);
+    }
+    _path = strdup(path);
+#endif
+}
+
+/*
+ *  Connects to the running gateway and takes over its sockets and sessions.
+ *  Returns false if no gateway is running.
+ */
+bool Handoff::receive(void)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, _path);
+
+    _connFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (_connFd < 0)
+    {
+        throw Exception("Handoff::receive: can't create a socket.", errno);
+    }
+    if (connect(_connFd, (sockaddr*) &addr, sizeof(addr)) < 0)
+    {
+        close(_connFd);
+        _connFd = -1;
+        return false;
+    }
+    if (!isSameUser(_connFd))
+    {
+        close(_connFd);
+        _connFd = -1;
+        throw Exception("Handoff::receive: HandoffSocket is owned by another user.", 0);
+    }
+
+    timeval timeout = { HANDOFF_TIMEOUT, 0 };
+    setsockopt(_connFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    WRITELOG("%s Taking over the running gateway via %s\n", currentDateTime(), _path);
+
+    uint8_t* buf = (uint8_t*) malloc(HANDOFF_ITEM_SIZE);
+    int fds[HANDOFF_MAX_FDS];
+    int fdCnt = 0;
+    int len = recvItem(buf, HANDOFF_ITEM_SIZE, fds, &fdCnt);
+    uint8_t* ptr = buf + 1;
+
+    if (len < 6 || buf[0] != HANDOFF_HELLO || getInt(&ptr, 4) != HANDOFF_MAGIC || *ptr != HANDOFF_VERSION)
+    {
+        free(buf);
+        for (int i = 0; i < fdCnt; i++)
+        {
+            close(fds[i]);
+        }
+        throw Exception("Handoff::receive: the running gateway refused the handoff.", 0);
+    }
+    _sensorFdCnt = fdCnt;
+    memcpy(_sensorFds, fds, sizeof(int) * fdCnt);
+
+    Client* client = nullptr;
+    int clientCnt = 0;
+    int topicCnt = 0;
+    int packetCnt = 0;
+
+    while ((len = recvItem(buf, HANDOFF_ITEM_SIZE, fds, &fdCnt)) > 0 && buf[0] != HANDOFF_END)
+    {
+        if (buf[0] == HANDOFF_CLIENT)
+        {
+            client = restoreClient(buf + 1, len - 1, fdCnt ? fds[0] : -1);
+            clientCnt += client ? 1 : 0;
+        }
+        else if (buf[0] == HANDOFF_TOPIC && client && len > 4)
+        {
+            ptr = buf + 1;
+            MQTTSN_topicTypes type = (MQTTSN_topicTypes) getInt(&ptr, 1);
+            uint16_t id = getInt(&ptr, 2);
+            string name((char*) ptr, len - 4);
+            client->getTopics()->insert(name.c_str(), type, id);
+            topicCnt++;
+        }
+        else if (buf[0] == HANDOFF_WAITED_TOPIC && client && len == 8)
+        {
+            ptr = buf + 1;
+            bool subscribe = getInt(&ptr, 1);
+            uint16_t msgId = getInt(&ptr, 2);
+            MQTTSN_topicid topic;
+            topic.type = MQTTSN_TOPIC_TYPE_SHORT;
+            uint16_t topicId = getInt(&ptr, 2);
+
+            /* the type and the wildcard are carried as they were */
+            TopicIdMapElement* elm;
+            if (subscribe)
+            {
+                client->setWaitedSubTopicId(msgId, topicId, &topic);
+                elm = client->getWaitedSubTopicId(msgId);
+            }
+            else
+            {
+                client->setWaitedPubTopicId(msgId, topicId, &topic);
+                elm = client->getWaitedPubTopicId(msgId);
+            }
+            if (elm)
+            {
+                elm->_type = getInt(&ptr, 1);
+                elm->_wildcard = getInt(&ptr, 1);
+                packetCnt++;
+            }
+        }
+        else if (buf[0] == HANDOFF_WAIT_REGACK && client && len > 3)
+        {
+            ptr = buf + 1;
+            uint16_t msgId = getInt(&ptr, 2);
+            MQTTSNPacket* packet = new MQTTSNPacket();
+            packet->desirialize(ptr, len - 3);
+            client->getWaitREGACKPacketList()->setPacket(packet, msgId);
+            packetCnt++;
+        }
+        else if (buf[0] == HANDOFF_SLEEP_PACKET && client)
+        {
+            MQTTGWPacket* packet = new MQTTGWPacket();
+            if (packet->setPacketData(buf + 1, len - 1) > 0)
+            {
+                client->setClientSleepPacket(packet);
+                packetCnt++;
+            }
+            else
+            {
+                delete packet;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < fdCnt; i++)
+            {
+                close(fds[i]);
+            }
+        }
+    }
+    free(buf);
+
+    if (len <= 0)
+    {
+        throw Exception("Handoff::receive: the snapshot is truncated.", errno);
+    }
+
+    close(_connFd);
+    _connFd = -1;
+    WRITELOG("%s Took over %d clients, %d topics and %d sleeping or inflight messages.\n", currentDateTime(), clientCnt, topicCnt,
+            packetCnt);
+    return true;
+}
+
+int Handoff::getSensorFds(int* fds, int maxFds)
+{
+    int cnt = _sensorFdCnt < maxFds ? _sensorFdCnt : maxFds;
+    memcpy(fds, _sensorFds, sizeof(int) * cnt);
+    return cnt;
+}
+
+/*
+ *  Starts to wait for the next process. A stale socket of the same user left by the previous process is replaced.
+ *  The socket is accessible by the user only.
+ */
+bool Handoff::listen(void)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, _path);
+
+    struct stat st;
+    if (lstat(_path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode) || st.st_uid != geteuid())
+        {
+            WRITELOG("%s Handoff can't listen on %s, it is not a socket of this user.%s\n", ERRMSG_HEADER, _path,
+                    ERRMSG_FOOTER);
+            return false;
+        }
+        unlink(_path);
+    }
+
+    _listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (_listenFd < 0)
+    {
+        return false;
+    }
+    mode_t mask = umask(0077);
+    int rc = bind(_listenFd, (sockaddr*) &addr, sizeof(addr));
+    umask(mask);
+    if (rc < 0 || chmod(_path, 0600) < 0 || ::listen(_listenFd, 1) < 0)
+    {
+        WRITELOG("%s Handoff can't listen on %s errno=%d %s\n", ERRMSG_HEADER, _path, errno, ERRMSG_FOOTER);
+        close(_listenFd);
+        _listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+/*
+ *  Waits for the next process up to msecs.
+ *  Returns true when it is connected and the sockets of the SensorNetwork can be handed over.
+ */
+bool Handoff::accept(int msecs)
+{
+    pollfd pfd = { _listenFd, POLLIN, 0 };
+
+    if (_listenFd < 0)
+    {
+        usleep(msecs * 1000);
+        return false;
+    }
+    if (poll(&pfd, 1, msecs) <= 0)
+    {
+        return false;
+    }
+
+#ifdef __APPLE__
+    int fd = ::accept(_listenFd, nullptr, nullptr);
+    if (fd >= 0)
+    {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#else
+    int fd = ::accept4(_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+#endif
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (!isSameUser(fd))
+    {
+        WRITELOG("%s Handoff is refused. The process belongs to another user.%s\n", ERRMSG_HEADER, ERRMSG_FOOTER);
+        close(fd);
+        return false;
+    }
+
+    int fds[HANDOFF_MAX_FDS];
+    if (_gateway->getSensorNetwork()->getPollFds(fds, HANDOFF_MAX_FDS) == 0)
+    {
+        WRITELOG("%s Handoff is refused. The SensorNetwork can't be handed over.%s\n", ERRMSG_HEADER, ERRMSG_FOOTER);
+        close(fd);
+        return false;
+    }
+    _connFd = fd;
+    WRITELOG("%s The next process is taking over.\n", currentDateTime());
+    return true;
+}
+
+/*
+ *  Sends the snapshot. All tasks must be stopped.
+ */
+bool Handoff::send(void)
+{
+    uint8_t buf[8];
+    uint8_t* ptr = buf;
+    int fds[HANDOFF_MAX_FDS];
+    int fdCnt = _gateway->getSensorNetwork()->getPollFds(fds, HANDOFF_MAX_FDS);
+    int clientCnt = 0;
+
+    *ptr++ = HANDOFF_HELLO;
+    putInt(&ptr, HANDOFF_MAGIC, 4);
+    *ptr++ = HANDOFF_VERSION;
+    if (!sendItem(buf, ptr - buf, fds, fdCnt))
+    {
+        return false;
+    }
+
+    for (Client* client = _gateway->getClientList()->getClient(0); client; client = client->getNextClient())
+    {
+        if (isHandedOver(client))
+        {
+            if (!sendClient(client))
+            {
+                return false;
+            }
+            clientCnt++;
+        }
+    }
+
+    buf[0] = HANDOFF_END;
+    if (!sendItem(buf, 1, nullptr, 0))
+    {
+        return false;
+    }
+    WRITELOG("%s Handed over %d clients to the next process.\n", currentDateTime(), clientCnt);
+    return true;
+}
+
+/*
+ *  Clients of adapters and forwarders are set up again by the next process.
+ *  A client whose ClientId, will and address don't fit an item has to connect again.
+ */
+bool Handoff::isHandedOver(Client* client)
+{
+    if (client->isAdapter() || client->isForwarded() || client->isAggregated() || client->isQoSm1())
+    {
+        return false;
+    }
+    if (!(client->isActive() || client->isSleep() || client->isAwake()))
+    {
+        return false;
+    }
+
+    char addr[128];
+    client->getSensorNetAddress()->sprint(addr);
+    if (strlen(client->getClientId()) + (client->getWillTopic() ? strlen(client->getWillTopic()) : 0)
+            + (client->getWillMsg() ? strlen(client->getWillMsg()) : 0) + strlen(addr) + 32 > HANDOFF_ITEM_SIZE)
+    {
+        WRITELOG("%s Handoff skipped %s. The session is too large to be handed over.%s\n", ERRMSG_HEADER,
+                client->getClientId(), ERRMSG_FOOTER);
+        return false;
+    }
+    return true;
+}
+
+/*
+ *  Sends a client which isHandedOver() has accepted, its topics and its sleeping messages.
+ */
+bool Handoff::sendClient(Client* client)
+{
+    uint8_t* buf = (uint8_t*) malloc(HANDOFF_ITEM_SIZE);
+    uint8_t* ptr = buf;
+    Connect* connect = client->getConnectData();
+    Network* network = client->getExistingNetwork();
+    int fd = network ? network->getSock() : -1;
+    bool rc = false;
+    char addr[128];
+
+    client->getSensorNetAddress()->sprint(addr);
+    *ptr++ = HANDOFF_CLIENT;
+    putInt(&ptr, client->_status, 1);
+    putInt(&ptr, client->_sessionStatus, 1);
+    putInt(&ptr, client->_waitWillMsgFlg, 1);
+    putInt(&ptr, client->_sensorNetype, 1);
+    putInt(&ptr, client->isSecureNetwork(), 1);
+    putInt(&ptr, client->_packetId, 2);
+    putInt(&ptr, client->_snMsgId, 1);
+    putInt(&ptr, client->_keepAliveMsec, 4);
+    putInt(&ptr, connect->header.byte, 1);
+    putInt(&ptr, connect->flags.all, 1);
+    putInt(&ptr, connect->keepAliveTimer, 4);
+    putInt(&ptr, connect->version, 1);
+    putInt(&ptr, client->getTopics()->_nextTopicId, 2);
+    putString(&ptr, addr);
+    putString(&ptr, client->getClientId());
+    putString(&ptr, client->getWillTopic());
+    putString(&ptr, client->getWillMsg());
+
+    /* a TLS session can't be handed over. the client connects to the broker again. */
+    if (!sendItem(buf, ptr - buf, &fd, (network && network->isValid() && !network->isSecure()) ? 1 : 0))
+    {
+        goto exit;
+    }
+
+    for (Topic* topic = client->getTopics()->getFirstTopic(); topic; topic = client->getTopics()->getNextTopic(topic))
+    {
+        ptr = buf;
+        *ptr++ = HANDOFF_TOPIC;
+        putInt(&ptr, topic->getType(), 1);
+        putInt(&ptr, topic->getTopicId(), 2);
+        if (topic->getTopicName()->size() + 4 > HANDOFF_ITEM_SIZE)
+        {
+            continue;
+        }
+        memcpy(ptr, topic->getTopicName()->c_str(), topic->getTopicName()->size());
+        ptr += topic->getTopicName()->size();
+        if (!sendItem(buf, ptr - buf, nullptr, 0))
+        {
+            goto exit;
+        }
+    }
+
+    for (MQTTGWPacket* packet = client->getClientSleepPacket(); packet; packet = client->getClientSleepPacket())
+    {
+        if (packet->getPacketLength() < HANDOFF_ITEM_SIZE)
+        {
+            buf[0] = HANDOFF_SLEEP_PACKET;
+            if (!sendItem(buf, packet->getPacketData(buf + 1) + 1, nullptr, 0))
+            {
+                goto exit;
+            }
+        }
+        client->deleteFirstClientSleepPacket();
+    }
+    rc = sendInflight(client, buf);
+exit:
+    free(buf);
+    return rc;
+}
+
+/*
+ *  Sends the messages of the client waiting for a SUBACK, PUBACK or REGACK of the broker.
+ */
+bool Handoff::sendInflight(Client* client, uint8_t* buf)
+{
+    TopicIdMap* maps[2] = { client->_waitedPubTopicIdMap, client->_waitedSubTopicIdMap };
+    bool rc = true;
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (maps[i] == nullptr)
+        {
+            continue;
+        }
+        maps[i]->_index.forEach([&](uint16_t msgId, TopicIdMapElement* elm)
+        {
+            uint8_t* ptr = buf;
+            *ptr++ = HANDOFF_WAITED_TOPIC;
+            putInt(&ptr, i, 1);
+            putInt(&ptr, msgId, 2);
+            putInt(&ptr, elm->_topicId, 2);
+            putInt(&ptr, elm->_type, 1);
+            putInt(&ptr, elm->_wildcard, 1);
+            rc = rc && sendItem(buf, ptr - buf, nullptr, 0);
+        });
+    }
+
+    client->_waitREGACKList._index.forEach([&](uint16_t msgId, MQTTSNPacket** packet)
+    {
+        int len = (*packet)->getPacketLength();
+        if (len + 3 <= HANDOFF_ITEM_SIZE)
+        {
+            uint8_t* ptr = buf;
+            *ptr++ = HANDOFF_WAIT_REGACK;
+            putInt(&ptr, msgId, 2);
+            memcpy(ptr, (*packet)->getPacketData(), len);
+            rc = rc && sendItem(buf, len + 3, nullptr, 0);
+        }
+    });
+    return rc;
+}
+
+/*
+ *  Restores a client from the item. The broker connection is attached if it was handed over.
+ */
+Client* Handoff::restoreClient(uint8_t* buf, int len, int brokerFd)
+{
+    uint8_t* ptr = buf;
+    uint8_t* end = buf + len;
+    MQTTSNString clientId = MQTTSNString_initializer;
+    MQTTSNString willTopic = MQTTSNString_initializer;
+    MQTTSNString willMsg = MQTTSNString_initializer;
+    MQTTSNString addrText = MQTTSNString_initializer;
+    SensorNetAddress addr;
+
+    if (len < 29)
+    {
+        if (brokerFd >= 0)
+        {
+            close(brokerFd);
+        }
+        return nullptr;
+    }
+
+    ClientStatus status = (ClientStatus) getInt(&ptr, 1);
+    bool sessionStatus = getInt(&ptr, 1);
+    bool waitWillMsg = getInt(&ptr, 1);
+    bool sensorNetype = getInt(&ptr, 1);
+    bool secure = getInt(&ptr, 1);
+    uint16_t packetId = getInt(&ptr, 2);
+    uint8_t snMsgId = getInt(&ptr, 1);
+    uint32_t keepAliveMsec = getInt(&ptr, 4);
+    uint8_t header = getInt(&ptr, 1);
+    uint8_t flags = getInt(&ptr, 1);
+    int keepAliveTimer = getInt(&ptr, 4);
+    uint8_t version = getInt(&ptr, 1);
+    uint16_t nextTopicId = getInt(&ptr, 2);
+
+    /* the address is carried as the text of clients.conf */
+    bool valid = getString(&ptr, end, &addrText);
+    if (valid)
+    {
+        string text(addrText.lenstring.data, addrText.lenstring.len);
+        valid = addr.setAddress(&text) == 0;
+    }
+
+    if (!valid || !getString(&ptr, end, &clientId) || !getString(&ptr, end, &willTopic) || !getString(&ptr, end, &willMsg)
+            || MQTTSNstrlen(clientId) == 0)
+    {
+        if (brokerFd >= 0)
+        {
+            close(brokerFd);
+        }
+        return nullptr;
+    }
+
+    ClientList* clientList = _gateway->getClientList();
+    Client* client = clientList->getClient(&clientId);
+    if (client == nullptr)
+    {
+        client = clientList->createClient(&addr, &clientId, sensorNetype, secure, TRANSPEARENT_TYPE);
+    }
+    if (client == nullptr)
+    {
+        if (brokerFd >= 0)
+        {
+            close(brokerFd);
+        }
+        return nullptr;
+    }
+
+    clientList->setClientAddress(client, &addr);
+    client->setSensorNetType(sensorNetype);
+    if (MQTTSNstrlen(willTopic))
+    {
+        client->setWillTopic(willTopic);
+    }
+    if (MQTTSNstrlen(willMsg))
+    {
+        client->setWillMsg(willMsg);
+    }
+    client->_sessionStatus = sessionStatus;
+    client->_waitWillMsgFlg = waitWillMsg;
+    client->_packetId = packetId;
+    client->_snMsgId = snMsgId;
+    client->_keepAliveMsec = keepAliveMsec;
+    client->getTopics()->_nextTopicId = nextTopicId;
+
+    Connect* connect = client->getConnectData();
+    memset(connect, 0, sizeof(Connect));
+    connect->header.byte = header;
+    connect->flags.all = flags;
+    connect->keepAliveTimer = keepAliveTimer;
+    connect->version = version;
+    connect->clientID = client->getClientId();
+    connect->willTopic = connect->flags.bits.will ? client->getWillTopic() : nullptr;
+    connect->willMsg = connect->flags.bits.will ? client->getWillMsg() : nullptr;
+
+    /* without the broker connection the client has to connect again. */
+    if (brokerFd >= 0 && client->getNetwork()->attach(brokerFd))
+    {
+        client->_status = status;
+    }
+    else
+    {
+        if (brokerFd >= 0)
+        {
+            close(brokerFd);
+        }
+        client->_status = Cstat_Disconnected;
+    }
+    return client;
+}
+
+bool Handoff::sendItem(uint8_t* buf, int len, int* fds, int fdCnt)
+{
+    iovec iov = { buf, (size_t) len };
+    msghdr msg;
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (fdCnt > 0)
+    {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fdCnt);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fdCnt);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fdCnt);
+    }
+
+    if (sendmsg(_connFd, &msg, MSG_NOSIGNAL) != len)
+    {
+        WRITELOG("%s Handoff can't send the snapshot errno=%d %s\n", ERRMSG_HEADER, errno, ERRMSG_FOOTER);
+        return false;
+    }
+    return true;
+}
+
+int Handoff::recvItem(uint8_t* buf, int len, int* fds, int* fdCnt)
+{
+    iovec iov = { buf, (size_t) len };
+    msghdr msg;
+    char control[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    *fdCnt = 0;
+
+    int rc = recvmsg(_connFd, &msg, MSG_CMSG_CLOEXEC);
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); rc >= 0 && cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            *fdCnt = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * *fdCnt);
+        }
+    }
+    return rc;
+}
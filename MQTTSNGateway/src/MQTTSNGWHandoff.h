@@ -0,0 +1,81 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+#ifndef MQTTSNGWHANDOFF_H_
+#define MQTTSNGWHANDOFF_H_
+
+#include <stdint.h>
+#include "MQTTSNGWDefines.h"
+
+namespace MQTTSNGW
+{
+
+#define HANDOFF_MAGIC          0x4D534E48              // "MSNH"
+#define HANDOFF_VERSION        3
+#define HANDOFF_MAX_FDS        4
+#define HANDOFF_ITEM_SIZE      (MQTTSNGW_MAX_PACKET_SIZE * 4)
+#define HANDOFF_TIMEOUT        30                      // secs to wait for the running gateway
+
+/* types of the items of the snapshot */
+#define HANDOFF_HELLO          1       // magic, version and the sockets of the SensorNetwork
+#define HANDOFF_CLIENT         2       // session of a client and the socket of its broker connection
+#define HANDOFF_TOPIC          3       // topic registered by the last client
+#define HANDOFF_SLEEP_PACKET   4       // packet buffered for the last client while it sleeps
+#define HANDOFF_END            5
+#define HANDOFF_WAITED_TOPIC   6       // topicId of a PUBLISH or SUBSCRIBE of the last client waiting for the broker
+#define HANDOFF_WAIT_REGACK    7       // PUBLISH of the last client waiting for the REGACK
+
+class Gateway;
+class Client;
+
+/*=====================================
+ Class Handoff
+
+ Hands the sockets and the sessions of the running gateway over to the next process.
+ The running gateway listens on a Unix socket. The next process connects to it,
+ the running gateway stops its tasks and sends a snapshot of the clients,
+ one item per SOCK_SEQPACKET message, with the sockets attached by SCM_RIGHTS.
+ =====================================*/
+class Handoff
+{
+public:
+    Handoff(Gateway* gateway);
+    ~Handoff();
+    void initialize(const char* path);
+    bool receive(void);
+    int getSensorFds(int* fds, int maxFds);
+    bool listen(void);
+    bool accept(int msecs);
+    bool send(void);
+
+private:
+    bool isHandedOver(Client* client);
+    bool sendItem(uint8_t* buf, int len, int* fds, int fdCnt);
+    int recvItem(uint8_t* buf, int len, int* fds, int* fdCnt);
+    bool sendClient(Client* client);
+    bool sendInflight(Client* client, uint8_t* buf);
+    Client* restoreClient(uint8_t* buf, int len, int brokerFd);
+
+    Gateway* _gateway;
+    char* _path { nullptr };
+    int _listenFd { -1 };
+    int _connFd { -1 };
+    int _sensorFds[HANDOFF_MAX_FDS];
+    int _sensorFdCnt { 0 };
+};
+
+}
+
+#endif /* MQTTSNGWHANDOFF_H_ */
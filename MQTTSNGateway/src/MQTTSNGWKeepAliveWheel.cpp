@@ -0,0 +1,205 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+
+#include "MQTTSNGWKeepAliveWheel.h"
+#include "MQTTSNGWClient.h"
+
+using namespace MQTTSNGW;
+
+#define KEEPALIVE_WHEEL_MASK   (KEEPALIVE_WHEEL_SLOTS - 1)
+#define KEEPALIVE_WHEEL_SPAN   (1UL << (KEEPALIVE_WHEEL_BITS * KEEPALIVE_WHEEL_LEVELS))
+
+/*=====================================
+ Class KeepAliveWheel
+ =====================================*/
+KeepAliveWheel::KeepAliveWheel()
+{
+    for (int i = 0; i < KEEPALIVE_WHEEL_LEVELS; i++)
+    {
+        for (int j = 0; j < KEEPALIVE_WHEEL_SLOTS; j++)
+        {
+            _slots[i][j] = nullptr;
+        }
+    }
+    _expired = nullptr;
+    _tick = 0;
+    _lastMsec = 0;
+    _started = false;
+    _cnt = 0;
+}
+
+KeepAliveWheel::~KeepAliveWheel()
+{
+
+}
+
+/*
+ *  (Re)starts the keep alive timer of the client. It expires after msecs.
+ */
+void KeepAliveWheel::schedule(Client* client, uint32_t msecs)
+{
+    uint32_t ticks = (msecs + KEEPALIVE_WHEEL_TICK - 1) / KEEPALIVE_WHEEL_TICK;
+
+    /* the current tick is partially elapsed. */
+    ticks++;
+    if (ticks >= KEEPALIVE_WHEEL_SPAN)
+    {
+        ticks = KEEPALIVE_WHEEL_SPAN - 1;
+    }
+
+    unlink(client);
+    client->_keepAliveExpire = _tick + ticks;
+    place(client);
+}
+
+void KeepAliveWheel::cancel(Client* client)
+{
+    if (client->_keepAliveSlot)
+    {
+        unlink(client);
+    }
+}
+
+/*
+ *  Advances the wheel to now (msecs) and moves the clients whose deadline has passed to the expired list.
+ */
+void KeepAliveWheel::advance(uint32_t now)
+{
+    if (!_started)
+    {
+        _lastMsec = now;
+        _started = true;
+        return;
+    }
+
+    while (now - _lastMsec >= KEEPALIVE_WHEEL_TICK)
+    {
+        _lastMsec += KEEPALIVE_WHEEL_TICK;
+        _tick++;
+
+        int index = _tick & KEEPALIVE_WHEEL_MASK;
+        if (index == 0)
+        {
+            cascade(1);
+            if (((_tick >> KEEPALIVE_WHEEL_BITS) & KEEPALIVE_WHEEL_MASK) == 0)
+            {
+                cascade(2);
+            }
+        }
+
+        Client* client = _slots[0][index];
+        while (client)
+        {
+            Client* next = client->_keepAliveNext;
+            unlink(client);
+            link(&_expired, client);
+            client = next;
+        }
+    }
+}
+
+/*
+ *  Pops a client whose keep alive timer expired.
+ */
+Client* KeepAliveWheel::getExpiredClient(void)
+{
+    Client* client = _expired;
+    if (client)
+    {
+        unlink(client);
+    }
+    return client;
+}
+
+int KeepAliveWheel::getCount(void)
+{
+    return _cnt;
+}
+
+void KeepAliveWheel::link(Client** slot, Client* client)
+{
+    client->_keepAliveSlot = slot;
+    client->_keepAlivePrev = nullptr;
+    client->_keepAliveNext = *slot;
+    if (*slot)
+    {
+        (*slot)->_keepAlivePrev = client;
+    }
+    *slot = client;
+    _cnt++;
+}
+
+void KeepAliveWheel::unlink(Client* client)
+{
+    if (client->_keepAliveSlot == nullptr)
+    {
+        return;
+    }
+    if (client->_keepAlivePrev)
+    {
+        client->_keepAlivePrev->_keepAliveNext = client->_keepAliveNext;
+    }
+    else
+    {
+        *client->_keepAliveSlot = client->_keepAliveNext;
+    }
+    if (client->_keepAliveNext)
+    {
+        client->_keepAliveNext->_keepAlivePrev = client->_keepAlivePrev;
+    }
+    client->_keepAliveSlot = nullptr;
+    client->_keepAlivePrev = nullptr;
+    client->_keepAliveNext = nullptr;
+    _cnt--;
+}
+
+/*
+ *  Links the client to the slot of the level which covers its deadline.
+ */
+void KeepAliveWheel::place(Client* client)
+{
+    uint32_t expire = client->_keepAliveExpire;
+    uint32_t delta = expire - _tick;
+
+    if (delta < (1UL << KEEPALIVE_WHEEL_BITS))
+    {
+        link(&_slots[0][expire & KEEPALIVE_WHEEL_MASK], client);
+    }
+    else if (delta < (1UL << (KEEPALIVE_WHEEL_BITS * 2)))
+    {
+        link(&_slots[1][(expire >> KEEPALIVE_WHEEL_BITS) & KEEPALIVE_WHEEL_MASK], client);
+    }
+    else
+    {
+        link(&_slots[2][(expire >> (KEEPALIVE_WHEEL_BITS * 2)) & KEEPALIVE_WHEEL_MASK], client);
+    }
+}
+
+/*
+ *  Re-places the clients of the current slot of the level into lower levels.
+ */
+void KeepAliveWheel::cascade(int level)
+{
+    Client** slot = &_slots[level][(_tick >> (KEEPALIVE_WHEEL_BITS * level)) & KEEPALIVE_WHEEL_MASK];
+    Client* client = *slot;
+    while (client)
+    {
+        Client* next = client->_keepAliveNext;
+        unlink(client);
+        place(client);
+        client = next;
+    }
+}
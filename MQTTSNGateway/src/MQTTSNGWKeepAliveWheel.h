@@ -0,0 +1,66 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+#ifndef MQTTSNGWKEEPALIVEWHEEL_H_
+#define MQTTSNGWKEEPALIVEWHEEL_H_
+
+#include <stdint.h>
+
+namespace MQTTSNGW
+{
+
+#define KEEPALIVE_WHEEL_TICK     1000    // msecs
+#define KEEPALIVE_WHEEL_BITS     6
+#define KEEPALIVE_WHEEL_SLOTS    (1 << KEEPALIVE_WHEEL_BITS)
+#define KEEPALIVE_WHEEL_LEVELS   3       // 64 ^ 3 ticks = 72 hours > 1.5 * 65535 secs
+
+class Client;
+
+/*=====================================
+ Class KeepAliveWheel
+
+ Hierarchical timing wheel of the keep alive deadlines of clients.
+ Level 0 holds deadlines within 64 ticks, level 1 within 64^2 ticks and level 2 the rest.
+ Slots of the upper level are cascaded down when the lower level wraps around,
+ so schedule() and cancel() are O(1) and advance() is O(1) per tick plus expired clients.
+ A wheel is owned by one PacketHandleTask and is not thread safe.
+ =====================================*/
+class KeepAliveWheel
+{
+public:
+    KeepAliveWheel();
+    ~KeepAliveWheel();
+    void schedule(Client* client, uint32_t msecs);
+    void cancel(Client* client);
+    void advance(uint32_t now);
+    Client* getExpiredClient(void);
+    int getCount(void);
+
+private:
+    void link(Client** slot, Client* client);
+    void unlink(Client* client);
+    void place(Client* client);
+    void cascade(int level);
+
+    Client* _slots[KEEPALIVE_WHEEL_LEVELS][KEEPALIVE_WHEEL_SLOTS];
+    Client* _expired;
+    uint32_t _tick;
+    uint32_t _lastMsec;
+    bool _started;
+    int _cnt;
+};
+
+}
+#endif /* MQTTSNGWKEEPALIVEWHEEL_H_ */
@@ -30,58 +30,48 @@ MessageIdTable::MessageIdTable()
 MessageIdTable::~MessageIdTable()
 {
     _mutex.lock();
-    if (_head != nullptr)
+    for (int i = 0; _msgIds && i < MESSAGEID_TABLE_SIZE; i++)
     {
-        MessageIdElement* p = _tail;
-        while (p)
-        {
-            MessageIdElement* pPrev = p;
-            delete p;
-            _cnt--;
-            p = pPrev->_prev;
-        }
-        _head = _tail = nullptr;
+        delete _msgIds[i];
     }
+    delete[] _msgIds;
+    _msgIds = nullptr;
+    _cnt = 0;
     _mutex.unlock();
 }
 
+uint32_t MessageIdTable::hash(Client* client, uint16_t clientMsgId)
+{
+    return hashPointer(client) ^ (clientMsgId * 2654435761U);
+}
+
+/*
+ *  Returns nullptr if the clientMsgId of the client is already in the table
+ *  or all msgIds are used.
+ */
 MessageIdElement* MessageIdTable::add(Aggregater* aggregater, Client* client, uint16_t clientMsgId)
 {
-    if (_cnt > _maxSize)
-    {
-        return nullptr;
-    }
+    MessageIdElement* elm = nullptr;
 
-    MessageIdElement* elm = new MessageIdElement(0, client, clientMsgId);
-    if (elm == nullptr)
-    {
-        return nullptr;
-    }
     _mutex.lock();
-    if (_head == nullptr)
+    if (_msgIds == nullptr)
     {
-        elm->_msgId = aggregater->msgId();
-        _head = elm;
-        _tail = elm;
-        _cnt++;
+        _msgIds = new MessageIdElement*[MESSAGEID_TABLE_SIZE]();
     }
-    else
+
+    if (find(client, clientMsgId) == nullptr && _cnt < MESSAGEID_TABLE_SIZE - 2)
     {
-        MessageIdElement* p = find(client, clientMsgId);
-        if (p == nullptr)
-        {
-            elm->_msgId = aggregater->msgId();
-            p = _tail;
-            _tail = elm;
-            elm->_prev = p;
-            p->_next = elm;
-            _cnt++;
-        }
-        else
+        /* skip the msgIds which are still waiting for their ack */
+        uint16_t msgId = aggregater->msgId();
+        while (_msgIds[msgId] != nullptr)
         {
-            delete elm;
-            elm = nullptr;
+            msgId = aggregater->msgId();
         }
+
+        elm = new MessageIdElement(msgId, client, clientMsgId);
+        _msgIds[msgId] = elm;
+        _clientIndex.add(hash(client, clientMsgId), elm);
+        _cnt++;
     }
     _mutex.unlock();
     return elm;
@@ -89,30 +79,15 @@ MessageIdElement* MessageIdTable::add(Aggregater* aggregater, Client* client, ui
 
 MessageIdElement* MessageIdTable::find(uint16_t msgId)
 {
-    MessageIdElement* p = _head;
-    while (p)
-    {
-        if (p->_msgId == msgId)
-        {
-            break;
-        }
-        p = p->_next;
-    }
-    return p;
+    return _msgIds ? _msgIds[msgId] : nullptr;
 }
 
 MessageIdElement* MessageIdTable::find(Client* client, uint16_t clientMsgId)
 {
-    MessageIdElement* p = _head;
-    while (p)
+    return _clientIndex.find(hash(client, clientMsgId), [client, clientMsgId](MessageIdElement* elm)
     {
-        if (p->_clientMsgId == clientMsgId && p->_client == client)
-        {
-            break;
-        }
-        p = p->_next;
-    }
-    return p;
+        return elm->_clientMsgId == clientMsgId && elm->_client == client;
+    });
 }
 
 Client* MessageIdTable::getClientMsgId(uint16_t msgId, uint16_t* clientMsgId)
@@ -131,6 +106,19 @@ Client* MessageIdTable::getClientMsgId(uint16_t msgId, uint16_t* clientMsgId)
     return clt;
 }
 
+Client* MessageIdTable::getClient(uint16_t msgId)
+{
+    Client* clt = nullptr;
+    _mutex.lock();
+    MessageIdElement* p = find(msgId);
+    if (p != nullptr)
+    {
+        clt = p->_client;
+    }
+    _mutex.unlock();
+    return clt;
+}
+
 void MessageIdTable::erase(uint16_t msgId)
 {
     _mutex.lock();
@@ -145,55 +133,35 @@ void MessageIdTable::clear(MessageIdElement* elm)
     {
         return;
     }
-
-    if (elm->_prev == nullptr)
-    {
-        _head = elm->_next;
-        if (_head == nullptr)
-        {
-            _tail = nullptr;
-        }
-        else
-        {
-            _head->_prev = nullptr;
-        }
-        delete elm;
-        _cnt--;
-        return;
-    }
-    else
-    {
-        elm->_prev->_next = elm->_next;
-        if (elm->_next == nullptr)
-        {
-            _tail = elm->_prev;
-        }
-        else
-        {
-            elm->_next->_prev = elm->_prev;
-        }
-        delete elm;
-        _cnt--;
-        return;
-    }
+    _msgIds[elm->_msgId] = nullptr;
+    _clientIndex.remove(hash(elm->_client, elm->_clientMsgId), elm);
+    delete elm;
+    _cnt--;
 }
 
 uint16_t MessageIdTable::getMsgId(Client* client, uint16_t clientMsgId)
 {
     uint16_t msgId = 0;
+    _mutex.lock();
     MessageIdElement* p = find(client, clientMsgId);
     if (p != nullptr)
     {
         msgId = p->_msgId;
     }
+    _mutex.unlock();
     return msgId;
 }
 
+int MessageIdTable::getCount(void)
+{
+    return _cnt;
+}
+
 /*===============================
  * Class MessageIdElement
  ===============================*/
 MessageIdElement::MessageIdElement(void) :
-        _msgId { 0 }, _clientMsgId { 0 }, _client { nullptr }, _next { nullptr }, _prev { nullptr }
+        _msgId { 0 }, _clientMsgId { 0 }, _client { nullptr }
 {
 
 }
@@ -28,8 +28,14 @@ class Client;
 class MessageIdElement;
 class Meutex;
 class Aggregater;
+#define MESSAGEID_TABLE_SIZE    0x10000    // one entry for each msgId
+
 /*=====================================
  Class MessageIdTable
+
+ msgIds of the aggregating gateway and the client and msgId which they replace.
+ The elements are indexed by msgId in a direct array and by client and client's msgId in a hash.
+ The table holds as many elements as there are msgIds.
  ======================================*/
 class MessageIdTable
 {
@@ -40,16 +46,18 @@ public:
     MessageIdElement* add(Aggregater* aggregater, Client* client,
             uint16_t clientMsgId);
     Client* getClientMsgId(uint16_t msgId, uint16_t* clientMsgId);
+    Client* getClient(uint16_t msgId);
     uint16_t getMsgId(Client* client, uint16_t clientMsgId);
     void erase(uint16_t msgId);
     void clear(MessageIdElement* elm);
+    int getCount(void);
 private:
     MessageIdElement* find(uint16_t msgId);
     MessageIdElement* find(Client* client, uint16_t clientMsgId);
-    MessageIdElement* _head { nullptr };
-    MessageIdElement* _tail{ nullptr };
+    static uint32_t hash(Client* client, uint16_t clientMsgId);
+    MessageIdElement** _msgIds { nullptr };        // allocated by the first add()
+    HashIndex<MessageIdElement> _clientIndex;      // elements by client and clientMsgId
     int _cnt { 0 };
-    int _maxSize { MAX_MESSAGEID_TABLE_SIZE };
     Mutex _mutex;
 };
 
@@ -69,8 +77,6 @@ private:
     uint16_t _msgId;
     uint16_t _clientMsgId;
     Client* _client;
-    MessageIdElement* _next;
-    MessageIdElement* _prev;
 };
 
 }
@@ -16,6 +16,7 @@
 
 #include "MQTTSNGateway.h"
 #include "MQTTSNGWPacket.h"
+#include "MQTTSNGWBufferArena.h"
 #include "MQTTSNPacket.h"
 #include "SensorNetwork.h"
 #include <stdio.h>
@@ -24,6 +25,9 @@
 
 using namespace std;
 using namespace MQTTSNGW;
+
+static_assert(sizeof(MQTTSNPacket) + ARENA_HEADER_SIZE <= 64, "MQTTSNPacket doesn't fit in a block of 64 bytes");
+
 int readInt(char** pptr);
 void writeInt(unsigned char** pptr, int msgId);
 
@@ -35,27 +39,32 @@ MQTTSNPacket::MQTTSNPacket(void)
 
 MQTTSNPacket::MQTTSNPacket(MQTTSNPacket& packet)
 {
-    _buf = (unsigned char*) malloc(packet._bufLen);
-    if (_buf)
-    {
-        _bufLen = packet._bufLen;
-        memcpy(_buf, packet._buf, _bufLen);
-    }
-    else
+    _buf = nullptr;
+    _bufLen = 0;
+    if (packet._buf)
     {
-        _buf = nullptr;
-        _bufLen = 0;
+        desirialize(packet._buf, packet._bufLen);
     }
 }
 
 MQTTSNPacket::~MQTTSNPacket()
 {
-    if (_buf)
+    if (_buf != _inline)
     {
-        free(_buf);
+        BufferArena::release(_buf);
     }
 }
 
+void* MQTTSNPacket::operator new(size_t size)
+{
+    return BufferArena::allocate(size);
+}
+
+void MQTTSNPacket::operator delete(void* ptr)
+{
+    BufferArena::release(ptr);
+}
+
 int MQTTSNPacket::unicast(SensorNetwork* network, SensorNetAddress* sendTo)
 {
     return network->unicast(_buf, _bufLen, sendTo);
@@ -74,21 +83,22 @@ int MQTTSNPacket::serialize(uint8_t* buf)
 
 int MQTTSNPacket::desirialize(unsigned char* buf, unsigned short len)
 {
-    if (_buf)
+    if (_buf != _inline)
     {
-        free(_buf);
+        BufferArena::release(_buf);
     }
 
-    _buf = (unsigned char*) calloc(len, sizeof(unsigned char));
-    if (_buf)
+    /* control packets are held in the object, PUBLISH and REGISTER spill to the BufferArena */
+    if (len <= MQTTSNPACKET_INLINE_SIZE)
     {
-        memcpy(_buf, buf, len);
-        _bufLen = len;
+        _buf = _inline;
     }
     else
     {
-        _bufLen = 0;
+        _buf = (unsigned char*) BufferArena::allocate(len);
     }
+    memcpy(_buf, buf, len);
+    _bufLen = len;
     return _bufLen;
 }
 
@@ -126,6 +136,24 @@ bool MQTTSNPacket::isQoSMinusPUBLISH(void)
     return ((_buf[p] == MQTTSN_PUBLISH) && ((_buf[p + 1] & 0x60) == 0x60));
 }
 
+/*
+ *  QoS of PUBLISH, 3 means QoS-1. Other packets return 0.
+ */
+int MQTTSNPacket::getQoS(void)
+{
+    if (_bufLen == 0)
+    {
+        return 0;
+    }
+    int value = 0;
+    int p = MQTTSNPacket_decode(_buf, _bufLen, &value);
+    if (_buf[p] != MQTTSN_PUBLISH)
+    {
+        return 0;
+    }
+    return (_buf[p + 1] & 0x60) >> 5;
+}
+
 unsigned char* MQTTSNPacket::getPacketData(void)
 {
     return _buf;
@@ -24,12 +24,16 @@ namespace MQTTSNGW
 {
 class SensorNetwork;
 
+#define MQTTSNPACKET_INLINE_SIZE   44   // packets up to this length are held in the object, the object fills a 64-byte block of the BufferArena
+
 class MQTTSNPacket
 {
 public:
     MQTTSNPacket(void);
     MQTTSNPacket(MQTTSNPacket &packet);
     ~MQTTSNPacket(void);
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
     int unicast(SensorNetwork* network, SensorNetAddress* sendTo);
     int broadcast(SensorNetwork* network);
     int recv(SensorNetwork* network);
@@ -90,14 +94,16 @@ public:
     bool isAccepted(void);
     bool isDuplicate(void);
     bool isQoSMinusPUBLISH(void);
+    int getQoS(void);
     char* getMsgId(char* buf);
     int getMsgId(void);
     void setMsgId(uint16_t msgId);
     char* print(char* buf);
 
 private:
-    unsigned char* _buf;    // Ptr to a packet data
+    unsigned char* _buf;    // Ptr to a packet data, _inline or a buffer of the BufferArena
     int _bufLen; // length of the packet data
+    unsigned char _inline[MQTTSNPACKET_INLINE_SIZE];
 };
 
 }
@@ -31,6 +31,7 @@
 #include "Timer.h"
 #include "MQTTSNAggregateConnectionHandler.h"
 
+#include <stdio.h>
 #include <string.h>
 
 using namespace std;
@@ -43,9 +44,10 @@ char* currentDateTime(void);
  Class PacketHandleTask
  =====================================*/
 
-PacketHandleTask::PacketHandleTask(Gateway* gateway)
+PacketHandleTask::PacketHandleTask(Gateway* gateway, int index)
 {
     _gateway = gateway;
+    _index = index;
     _gateway->attach((Thread*) this);
     _mqttConnection = new MQTTGWConnectionHandler(_gateway);
     _mqttPublish = new MQTTGWPublishHandler(_gateway);
@@ -56,6 +58,10 @@ PacketHandleTask::PacketHandleTask(Gateway* gateway)
 
     _mqttsnAggrConnection = new MQTTSNAggregateConnectionHandler(_gateway);
     setTaskName("PacketHandleTask");
+
+    char name[16];
+    snprintf(name, sizeof(name), "PktHandle%d", index);
+    setThreadName(name);
 }
 
 /**
@@ -97,16 +103,10 @@ PacketHandleTask::~PacketHandleTask()
 void PacketHandleTask::run()
 {
     Event* ev = nullptr;
-    EventQue* eventQue = _gateway->getPacketEventQue();
-    AdapterManager* adpMgr = _gateway->getAdapterManager();
-
-    Client* client = nullptr;
-    MQTTSNPacket* snPacket = nullptr;
-    MQTTGWPacket* brPacket = nullptr;
-    char msgId[6];
-    memset(msgId, 0, 6);
+    EventQue* eventQue = _gateway->getPacketEventQue()->getQue(_index);
+    ClientList* clientList = _gateway->getClientList();
 
-    _advertiseTimer.start(_gateway->getGWParams()->keepAlive * 1000UL);
+    startTimers();
 
     while (true)
     {
@@ -120,63 +120,127 @@ void PacketHandleTask::run()
             return;
         }
 
-        if (ev->getEventType() == EtTimeout)
+        /* a Network released by another task is not deleted while the handler uses it */
+        clientList->beginRead();
+        handleEvent(ev);
+        clientList->endRead();
+        delete ev;
+    }
+}
+
+/*
+ *  Starts the gateway wide timers. run() calls it before the first Event is handled.
+ */
+void PacketHandleTask::startTimers(void)
+{
+    _advertiseTimer.start(_gateway->getGWParams()->keepAlive.load(std::memory_order_relaxed) * 1000UL);
+
+    /*------ Clients taken over from the previous process are already connected ------*/
+    PacketEventQue* packetEventQue = _gateway->getPacketEventQue();
+    ClientList* clientList = _gateway->getClientList();
+    ClientHotFields* hot = clientList->getHotFields();
+    clientList->beginRead();
+    for (int i = 0; i < hot->size; i++)
+    {
+        ClientStatus status = hot->status[i];
+        if (status == Cstat_Active || status == Cstat_Asleep || status == Cstat_Awake)
         {
-            /*------ Check Keep Alive Timer & send Advertise ------*/
-            if (_advertiseTimer.isTimeup())
+            Client* client = clientList->getSlotClient(i);
+            if (packetEventQue->getQueIndex(client) == _index)
             {
-                _mqttsnConnection->sendADVERTISE();
-                _advertiseTimer.start(_gateway->getGWParams()->keepAlive * 1000UL);
+                client->startKeepAlive(&_keepAliveWheel);
             }
-
-            /*------ Check Adapters   Connect or PINGREQ ------*/
-            adpMgr->checkConnection();
         }
+    }
+    clientList->endRead();
+}
+
+/*
+ *  Handles an Event of the PacketEventQue. The caller deletes the Event.
+ */
+void PacketHandleTask::handleEvent(Event* ev)
+{
+    AdapterManager* adpMgr = _gateway->getAdapterManager();
+    Client* client = nullptr;
+    MQTTSNPacket* snPacket = nullptr;
+    MQTTGWPacket* brPacket = nullptr;
+    char msgId[6];
+    memset(msgId, 0, 6);
+
+    /*------ Clients which exceed the keep alive time are lost ------*/
+    _keepAliveWheel.advance(Timer::now());
+    while ((client = _keepAliveWheel.getExpiredClient()) != nullptr)
+    {
+        _mqttsnConnection->handleKeepAliveTimeout(client);
+    }
 
-        /*------    Handle SEARCHGW Message     ---------*/
-        else if (ev->getEventType() == EtBroadcast)
+    if (ev->getEventType() == EtTimeout)
+    {
+        /*------ Gateway wide timers are handled by the first task ------*/
+        if (_index > 0)
         {
-            snPacket = ev->getMQTTSNPacket();
-            _mqttsnConnection->handleSearchgw(snPacket);
+            return;
         }
 
-        /*------    Handle Messages form Clients      ---------*/
-        else if (ev->getEventType() == EtClientRecv)
+        /*------ Check Keep Alive Timer & send Advertise ------*/
+        if (_advertiseTimer.isTimeup())
         {
-            client = ev->getClient();
-            snPacket = ev->getMQTTSNPacket();
+            _mqttsnConnection->sendADVERTISE();
+            _advertiseTimer.start(_gateway->getGWParams()->keepAlive.load(std::memory_order_relaxed) * 1000UL);
+        }
 
-            DEBUGLOG("     PacketHandleTask gets %s %s from the client.\n", snPacket->getName(), snPacket->getMsgId(msgId));
+        /*------ Check Adapters   Connect or PINGREQ ------*/
+        adpMgr->checkConnection();
+    }
 
-            if (adpMgr->isAggregatedClient(client))
-            {
-                aggregatePacketHandler(client, snPacket); // client is converted to Aggregater by BrokerSendTask
-            }
-            else
-            {
-                transparentPacketHandler(client, snPacket);
-            }
+    /*------    Handle SEARCHGW Message     ---------*/
+    else if (ev->getEventType() == EtBroadcast)
+    {
+        snPacket = ev->getMQTTSNPacket();
+        _mqttsnConnection->handleSearchgw(snPacket);
+    }
 
-            /* Reset the Timer for PINGREQ. */
-            client->updateStatus(snPacket);
+    /*------    Handle Messages form Clients      ---------*/
+    else if (ev->getEventType() == EtClientRecv)
+    {
+        client = ev->getClient();
+        snPacket = ev->getMQTTSNPacket();
+
+        DEBUGLOG("     PacketHandleTask gets %s %s from the client.\n", snPacket->getName(), snPacket->getMsgId(msgId));
+
+        if (adpMgr->isAggregatedClient(client))
+        {
+            aggregatePacketHandler(client, snPacket); // client is converted to Aggregater by BrokerSendTask
         }
-        /*------  Handle Messages form Broker      ---------*/
-        else if (ev->getEventType() == EtBrokerRecv)
+        else
         {
-            client = ev->getClient();
-            brPacket = ev->getMQTTGWPacket();
-            DEBUGLOG("     PacketHandleTask gets %s %s from the broker.\n", brPacket->getName(), brPacket->getMsgId(msgId));
+            transparentPacketHandler(client, snPacket);
+        }
 
-            if (client->isAggregater())
-            {
-                aggregatePacketHandler(client, brPacket);
-            }
-            else
-            {
-                transparentPacketHandler(client, brPacket);
-            }
+        /* Reset the Timer for PINGREQ. */
+        client->updateStatus(snPacket, &_keepAliveWheel);
+
+        /* release the state which a sleeping or disconnected client doesn't use */
+        if (snPacket->getType() == MQTTSN_DISCONNECT && (client->isSleep() || client->isDisconnect()))
+        {
+            client->shrink();
+        }
+    }
+    /*------  Handle Messages form Broker      ---------*/
+    else if (ev->getEventType() == EtBrokerRecv)
+    {
+        client = ev->getClient();
+        brPacket = ev->getMQTTGWPacket();
+        DEBUGLOG("     PacketHandleTask gets %s %s from the broker.\n", brPacket->getName(), brPacket->getMsgId(msgId));
+
+        if (client->isAggregater())
+        {
+            aggregatePacketHandler(client, brPacket);
+        }
+        else
+        {
+            transparentPacketHandler(client, brPacket);
         }
-        delete ev;
     }
 }
 
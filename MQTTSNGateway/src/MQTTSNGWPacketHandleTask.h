@@ -19,12 +19,14 @@
 
 #include "Timer.h"
 #include "MQTTSNGWProcess.h"
+#include "MQTTSNGWKeepAliveWheel.h"
 namespace MQTTSNGW
 {
 class Gateway;
 class Client;
 class MQTTSNPacket;
 class MQTTGWPacket;
+class Event;
 class Timer;
 class MQTTGWConnectionHandler;
 class MQTTGWPublishHandler;
@@ -51,9 +53,11 @@ MAGIC_WORD_FOR_THREAD;
     friend class MQTTSNAggregatePublishHandler;
     friend class MQTTSNAggregateSubscribeHandler;
 public:
-    PacketHandleTask(Gateway* gateway);
+    PacketHandleTask(Gateway* gateway, int index = 0);
     ~PacketHandleTask();
     void run();
+    void startTimers(void);
+    void handleEvent(Event* ev);
 private:
     void aggregatePacketHandler(Client*client, MQTTSNPacket* packet);
     void aggregatePacketHandler(Client*client, MQTTGWPacket* packet);
@@ -62,8 +66,10 @@ private:
 
     Gateway* _gateway
     { nullptr };
+    int _index { 0 };       // index of the PacketEventQue this task handles
     Timer _advertiseTimer;
     Timer _sendUnixTimer;
+    KeepAliveWheel _keepAliveWheel;     // keep alive timers of clients handled by this task
     MQTTGWConnectionHandler* _mqttConnection { nullptr };
     MQTTGWPublishHandler* _mqttPublish { nullptr };
     MQTTGWSubscribeHandler* _mqttSubscribe { nullptr };
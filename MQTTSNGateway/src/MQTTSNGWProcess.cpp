@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <string>
+#include <fstream>
 #include <stdarg.h>
 #include <signal.h>
 #include <Timer.h>
@@ -42,9 +43,21 @@ MultiTaskProcess* MQTTSNGW::theMultiTaskProcess = nullptr;
  */
 volatile int theSignaled = 0;
 
+/*
+ *  SIGHUP requests to reload the config file
+ */
+volatile sig_atomic_t theReloadRequested = 0;
+
 static void signalHandler(int sig)
 {
-    theSignaled = sig;
+    if (sig == SIGHUP)
+    {
+        theReloadRequested = 1;
+    }
+    else
+    {
+        theSignaled = sig;
+    }
 }
 
 /*=====================================
@@ -59,6 +72,7 @@ Process::Process()
     _log = 0;
     _rbsem = NULL;
     _rb = NULL;
+    _configLoaded = false;
 }
 
 Process::~Process()
@@ -80,7 +94,6 @@ void Process::run()
 
 void Process::initialize(int argc, char** argv)
 {
-    char param[MQTTSNGW_PARAM_MAX];
     _argc = argc;
     _argv = argv;
     signal(SIGINT, signalHandler);
@@ -108,17 +121,29 @@ void Process::initialize(int argc, char** argv)
     _rbsem = new NamedSemaphore(MQTTSNGW_RB_SEMAPHOR_NAME, 0);
     _rb = new RingBuffer(_configDir.c_str());
 
-    if (getParam("ShearedMemory", param) == 0)
+    if (!loadConfig())
     {
-        if (!strcasecmp(param, "YES"))
-        {
-            _log = 1;
-        }
-        else
-        {
-            _log = 0;
-        }
+        throw Exception("Config file not found:\n\nUsage: Command -f path/config_file_name\n", 0);
     }
+    _log = getBoolParam("ShearedMemory", false) ? 1 : 0;
+}
+
+/*
+ *  Reads the config file again and applies the parameters which can be changed while running.
+ *  Called by the main thread when SIGHUP has been received.
+ */
+void Process::reload(void)
+{
+    if (!loadConfig())
+    {
+        WRITELOG("%s Process::reload can't read the config file %s%s.\n", currentDateTime(), _configDir.c_str(),
+                _configFile.c_str());
+        return;
+    }
+    _mt.lock();
+    _log = getBoolParam("ShearedMemory", false) ? 1 : 0;
+    _mt.unlock();
+    WRITELOG("%s %s%s has been reloaded.\n", currentDateTime(), _configDir.c_str(), _configFile.c_str());
 }
 
 void Process::putLog(const char* format, ...)
@@ -153,75 +178,114 @@ char** Process::getArgv()
     return _argv;
 }
 
-int Process::getParam(const char* parameter, char* value)
+/*
+ *  Parses the config file into the key/value table.
+ *  Lines beginning with # are comment lines. The first record of a key wins.
+ *  The table is left unchanged if the file can't be opened.
+ */
+bool Process::loadConfig(void)
 {
-    char str[MQTTSNGW_PARAM_MAX];
-    char param[MQTTSNGW_PARAM_MAX];
-    memset(str, 0, sizeof(str));
-    memset(param, 0, sizeof(param));
-    FILE *fp;
-
-    int i = 0, j = 0;
     string configPath = _configDir + _configFile;
+    ifstream ifs(configPath.c_str());
 
-    if ((fp = fopen(configPath.c_str(), "r")) == NULL)
+    if (!ifs)
     {
-        throw Exception("Config file not found:\n\nUsage: Command -f path/config_file_name\n", 0);
+        return false;
     }
 
-    int paramlen = strlen(parameter);
+    unordered_map<string, string> config;
+    string line;
+    const char* space = " \t\r\n";
 
-    while (true)
+    while (getline(ifs, line))
     {
-        int pos = 0;
-        int len = 0;
-        if (fgets(str, MQTTSNGW_PARAM_MAX - 1, fp) == NULL)
+        if (line.empty() || line[0] == '#')
         {
-            fclose(fp);
-            return -3;
+            continue;
         }
-        if (str[0] == '#' || str[0] == '\n')
+        size_t pos = line.find('=');
+        if (pos == string::npos)
         {
             continue;
         }
 
-        len = strlen(str);
-        for (pos = 0; i < len; pos++)
-        {
-            if (str[pos] == '=')
-            {
-                break;
-            }
-        }
+        string key = line.substr(0, pos);
+        string value = line.substr(pos + 1);
+        key.erase(key.find_last_not_of(space) + 1);
+        key.erase(0, key.find_first_not_of(space));
+        value.erase(value.find_last_not_of(space) + 1);
+        value.erase(0, value.find_first_not_of(space));
 
-        if (pos == paramlen)
+        if (!key.empty())
         {
-            if (strncmp(str, parameter, paramlen) == 0)
-            {
-                strcpy(param, str + pos + 1);
-                param[len - pos - 2] = '\0';
-
-
-                for (i = strlen(param) - 1; i >= 0 && isspace(param[i]); i--)
-                    ;
-                param[i + 1] = '\0';
-                for (i = 0; isspace(param[i]); i++)
-                    ;
-                if (i > 0)
-                {
-                    j = 0;
-                    while (param[i])
-                        param[j++] = param[i++];
-                    param[j] = '\0';
-                }
-                strcpy(value, param);
-                fclose(fp);
-                return 0;
-            }
+            config.emplace(key, value);
         }
     }
-    fclose(fp);
-    return -2;
+
+    _configMutex.lock();
+    _config.swap(config);
+    _configLoaded = true;
+    _configMutex.unlock();
+    return true;
+}
+
+/*
+ *  Returns 0 and the value of the parameter, or -3 if the parameter is not in the config file.
+ *  The value is truncated to MQTTSNGW_PARAM_MAX - 1 characters.
+ */
+int Process::getParam(const char* parameter, char* value)
+{
+    string str;
+    int rc = getParam(parameter, str);
+
+    if (rc == 0)
+    {
+        size_t len = str.copy(value, MQTTSNGW_PARAM_MAX - 1);
+        value[len] = '\0';
+    }
+    return rc;
+}
+
+int Process::getParam(const char* parameter, string& value)
+{
+    if (!_configLoaded && !loadConfig())
+    {
+        throw Exception("Config file not found:\n\nUsage: Command -f path/config_file_name\n", 0);
+    }
+
+    int rc = -3;
+    _configMutex.lock();
+    unordered_map<string, string>::const_iterator it = _config.find(parameter);
+    if (it != _config.end())
+    {
+        value = it->second;
+        rc = 0;
+    }
+    _configMutex.unlock();
+    return rc;
+}
+
+int Process::getIntParam(const char* parameter, int defaultValue)
+{
+    string value;
+    if (getParam(parameter, value) == 0)
+    {
+        return atoi(value.c_str());
+    }
+    return defaultValue;
+}
+
+/*
+ *  Returns true if the value is YES, false if it is another value.
+ */
+bool Process::getBoolParam(const char* parameter, bool defaultValue)
+{
+    string value;
+    if (getParam(parameter, value) == 0)
+    {
+        return strcasecmp(value.c_str(), "YES") == 0;
+    }
+    return defaultValue;
 }
 
 const char* Process::getLog()
@@ -251,6 +315,19 @@ int Process::checkSignal(void)
     return theSignaled;
 }
 
+/*
+ *  Returns true once for each SIGHUP received.
+ */
+bool Process::checkReload(void)
+{
+    if (theReloadRequested)
+    {
+        theReloadRequested = 0;
+        return true;
+    }
+    return false;
+}
+
 const string* Process::getConfigDirName(void)
 {
     return &_configDir;
@@ -291,10 +368,7 @@ void MultiTaskProcess::initialize(int argc, char** argv)
 
 void MultiTaskProcess::run(void)
 {
-    for (int i = 0; i < _threadCount; i++)
-    {
-        _threadList[i]->start();
-    }
+    startThreads();
 
     while (true)
     {
@@ -302,10 +376,22 @@ void MultiTaskProcess::run(void)
         {
             return;
         }
+        if (theProcess->checkReload())
+        {
+            theProcess->reload();
+        }
         sleep(1);
     }
 }
 
+void MultiTaskProcess::startThreads(void)
+{
+    for (int i = 0; i < _threadCount; i++)
+    {
+        _threadList[i]->start();
+    }
+}
+
 void MultiTaskProcess::waitStop(void)
 {
     while (_stopCount < _threadCount)
@@ -343,12 +429,178 @@ void MultiTaskProcess::attach(Thread* thread)
     _mutex.unlock();
 }
 
-int MultiTaskProcess::getParam(const char* parameter, char* value)
+int MultiTaskProcess::getThreadCount(void)
+{
+    return _threadCount;
+}
+
+Thread* MultiTaskProcess::getThread(int index)
+{
+    if (index < 0 || index >= _threadCount)
+    {
+        return nullptr;
+    }
+    return _threadList[index];
+}
+
+/*=====================================
+ Class Epoch
+ ====================================*/
+static_assert(EPOCH_MAX_READERS <= 64, "the slots of the readers don't fit in theEpochReaderIds");
+
+/*
+ *  Returns the slot of the readers when the thread exits.
+ */
+struct EpochReader
+{
+    int id { -1 };
+    ~EpochReader();
+};
+
+static std::atomic<uint64_t> theEpochReaderIds { 0 };     // a bit for each slot in use
+static thread_local EpochReader theEpochReader;
+
+/*
+ *  Each thread gets a free slot of the readers at its first enter().
+ */
+static int epochReaderId(void)
+{
+    if (theEpochReader.id < 0)
+    {
+        uint64_t ids = theEpochReaderIds.load();
+        int id;
+        do
+        {
+            for (id = 0; id < EPOCH_MAX_READERS && (ids & (1ULL << id)); id++)
+            {
+            }
+            if (id == EPOCH_MAX_READERS)
+            {
+                throw Exception("Epoch: too many reader threads.", 0);
+            }
+        } while (!theEpochReaderIds.compare_exchange_weak(ids, ids | (1ULL << id)));
+        theEpochReader.id = id;
+    }
+    return theEpochReader.id;
+}
+
+EpochReader::~EpochReader()
+{
+    if (id >= 0)
+    {
+        theEpochReaderIds.fetch_and(~(1ULL << id));
+    }
+}
+
+Epoch::Epoch()
+{
+    _epoch = 1;
+    for (int i = 0; i < EPOCH_MAX_READERS; i++)
+    {
+        _readers[i] = 0;
+        _depth[i] = 0;
+    }
+    _retired = nullptr;
+    _retiredCnt = 0;
+}
+
+Epoch::~Epoch()
+{
+    while (_retired)
+    {
+        Retired* r = _retired;
+        _retired = r->next;
+        r->reclaimer(r->obj);
+        delete r;
+    }
+}
+
+void Epoch::enter(void)
+{
+    int id = epochReaderId();
+    if (_depth[id]++ == 0)
+    {
+        _readers[id].store(_epoch.load());
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+void Epoch::leave(void)
+{
+    int id = epochReaderId();
+    if (--_depth[id] == 0)
+    {
+        _readers[id].store(0, std::memory_order_release);
+    }
+}
+
+/*
+ *  The object must have been unlinked, so that readers which enter from now on can't find it.
+ */
+void Epoch::retire(void* obj, void (*reclaimer)(void*))
+{
+    Retired* r = new Retired;
+    r->obj = obj;
+    r->reclaimer = reclaimer;
+
+    _mutex.lock();
+    r->epoch = _epoch.fetch_add(1);
+    r->next = _retired;
+    _retired = r;
+    _retiredCnt++;
+    _mutex.unlock();
+
+    reclaim();
+}
+
+/*
+ *  Reclaims the objects retired before the oldest reader entered.
+ */
+void Epoch::reclaim(void)
 {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < EPOCH_MAX_READERS; i++)
+    {
+        uint64_t epoch = _readers[i].load(std::memory_order_acquire);
+        if (epoch != 0 && epoch < oldest)
+        {
+            oldest = epoch;
+        }
+    }
+
+    Retired* list = nullptr;
     _mutex.lock();
-    int rc = Process::getParam(parameter, value);
+    Retired** p = &_retired;
+    while (*p)
+    {
+        Retired* r = *p;
+        if (r->epoch < oldest)
+        {
+            *p = r->next;
+            r->next = list;
+            list = r;
+            _retiredCnt--;
+        }
+        else
+        {
+            p = &r->next;
+        }
+    }
     _mutex.unlock();
-    return rc;
+
+    while (list)
+    {
+        Retired* r = list;
+        list = r->next;
+        r->reclaimer(r->obj);
+        delete r;
+    }
+}
+
+int Epoch::getRetiredCount(void)
+{
+    return _retiredCnt;
 }
 
 /*=====================================
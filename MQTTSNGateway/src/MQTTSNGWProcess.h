@@ -19,6 +19,7 @@
 
 #include <exception>
 #include <string>
+#include <unordered_map>
 #include <signal.h>
 #include "MQTTSNGWDefines.h"
 #include "Threading.h"
@@ -31,9 +32,9 @@ namespace MQTTSNGW
 /*=================================
  *    Parameters
  ==================================*/
-#define MQTTSNGW_MAX_TASK           10  // number of Tasks
+#define MQTTSNGW_MAX_TASK           20  // number of Tasks
 #define PROCESS_LOG_BUFFER_SIZE  16384  // Ring buffer size for Logs
-#define MQTTSNGW_PARAM_MAX         128  // Max length of config records.
+#define MQTTSNGW_PARAM_MAX         128  // Max length of a value copied by getParam(const char*, char*)
 
 /*=================================
  *    Macros
@@ -58,11 +59,21 @@ public:
     int getArgc(void);
     char** getArgv(void);
     int getParam(const char* parameter, char* value);
+    int getParam(const char* parameter, string& value);
+    int getIntParam(const char* parameter, int defaultValue);
+    bool getBoolParam(const char* parameter, bool defaultValue);
+    virtual void reload(void);
     const char* getLog(void);
     int checkSignal(void);
+    bool checkReload(void);
     const string* getConfigDirName(void);
     const string* getConfigFileName(void);
 private:
+    bool loadConfig(void);
+
+    unordered_map<string, string> _config;
+    Mutex _configMutex;
+    bool _configLoaded;
     int _argc;
     char** _argv;
     string _configDir;
@@ -83,12 +94,14 @@ public:
     MultiTaskProcess(void);
     ~MultiTaskProcess();
     void initialize(int argc, char** argv);
-    int getParam(const char* parameter, char* value);
     void run(void);
+    void startThreads(void);
     void waitStop(void);
     void threadStopped(void);
     void attach(Thread* thread);
     void abort(void);
+    int getThreadCount(void);
+    Thread* getThread(int index);
 
 private:
     Thread* _threadList[MQTTSNGW_MAX_TASK];
@@ -1017,6 +1030,520 @@ private:
     int _size;
 };
 
+/*=====================================
+ Class Epoch
+
+ Epoch based reclamation for read-mostly structures.
+ Readers access the structure between enter() and leave() without a lock, sections may nest.
+ A writer unlinks an object, then retires it. The object is reclaimed
+ when every reader which may still see it has left.
+ =====================================*/
+#define EPOCH_MAX_READERS   64    // threads which ever enter an Epoch
+
+class Epoch
+{
+public:
+    Epoch();
+    ~Epoch();
+    void enter(void);
+    void leave(void);
+    void retire(void* obj, void (*reclaimer)(void*));
+    void reclaim(void);
+    int getRetiredCount(void);
+
+private:
+    struct Retired
+    {
+        void* obj;
+        void (*reclaimer)(void*);
+        uint64_t epoch;
+        Retired* next;
+    };
+    std::atomic<uint64_t> _epoch;
+    std::atomic<uint64_t> _readers[EPOCH_MAX_READERS];    // epoch at enter(), 0 while not reading
+    int _depth[EPOCH_MAX_READERS];
+    Retired* _retired;
+    int _retiredCnt;
+    Mutex _mutex;
+};
+
+/*=====================================
+ Class HashIndex
+
+ Open addressing hash table of pointers with linear probing.
+ The hash of an element is given by the caller and kept in the slot,
+ so elements are compared only when their hashes are equal.
+ The table grows to keep the load factor under 1/2.
+ A removed slot is refilled by shifting the following entries back, no tombstones are left.
+
+ Writers must be serialized by the owner. find() takes no lock:
+ it retries while a writer changes the table, like a seqlock.
+ If readers run concurrently, an Epoch must be set to reclaim the tables replaced by growing,
+ and the elements themselves must be reclaimed through the same Epoch.
+ =====================================*/
+#define HASHINDEX_MIN_SIZE  16
+
+/*
+ *  FNV-1a hash of a byte string
+ */
+inline uint32_t hashBytes(const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    uint32_t h = 2166136261U;
+    for (size_t i = 0; i < len; i++)
+    {
+        h = (h ^ p[i]) * 16777619U;
+    }
+    return h;
+}
+
+/*
+ *  Hash of a pointer, HashIndex mixes the bits
+ */
+inline uint32_t hashPointer(const void* ptr)
+{
+    uint64_t v = (uint64_t) (uintptr_t) ptr;
+    return (uint32_t) (v ^ (v >> 32));
+}
+
+template<typename T>
+class HashIndex
+{
+public:
+    HashIndex()
+    {
+        _table = nullptr;
+        _epoch = nullptr;
+        _cnt = 0;
+        _seq = 0;
+    }
+    ~HashIndex()
+    {
+        delete _table.load();
+    }
+
+    void setEpoch(Epoch* epoch)
+    {
+        _epoch = epoch;
+    }
+
+    /*
+     *  Reserves the slots for maxElements without growing.
+     */
+    void allocate(int maxElements)
+    {
+        uint32_t size = HASHINDEX_MIN_SIZE;
+        while (size < (uint32_t) maxElements * 2)
+        {
+            size <<= 1;
+        }
+        Table* table = _table.load(std::memory_order_relaxed);
+        if (table == nullptr || size > table->mask + 1)
+        {
+            resize(size);
+        }
+    }
+
+    void add(uint32_t hash, T* elm)
+    {
+        Table* table = _table.load(std::memory_order_relaxed);
+        if (table == nullptr || (uint32_t) (_cnt + 1) * 2 > table->mask + 1)
+        {
+            resize(table ? (table->mask + 1) * 2 : HASHINDEX_MIN_SIZE);
+            table = _table.load(std::memory_order_relaxed);
+        }
+        hash = mix(hash);
+        uint32_t i = hash & table->mask;
+        while (table->slots[i].elm.load(std::memory_order_relaxed) != nullptr)
+        {
+            i = (i + 1) & table->mask;
+        }
+        beginWrite();
+        table->slots[i].hash.store(hash, std::memory_order_relaxed);
+        table->slots[i].elm.store(elm, std::memory_order_relaxed);
+        endWrite();
+        _cnt++;
+    }
+
+    /*
+     *  Returns the first element of the hash for which match(elm) is true.
+     */
+    template<typename M>
+    T* find(uint32_t hash, M match)
+    {
+        hash = mix(hash);
+        while (true)
+        {
+            uint32_t seq = _seq.load(std::memory_order_acquire);
+            if (seq & 1)
+            {
+                continue;    // a writer is changing the table
+            }
+
+            T* found = nullptr;
+            Table* table = _table.load(std::memory_order_acquire);
+            uint32_t probes = 0;
+            for (uint32_t i = hash & (table ? table->mask : 0); table && probes <= table->mask;
+                    i = (i + 1) & table->mask, probes++)
+            {
+                T* elm = table->slots[i].elm.load(std::memory_order_relaxed);
+                if (elm == nullptr)
+                {
+                    break;
+                }
+                if (table->slots[i].hash.load(std::memory_order_relaxed) == hash && match(elm))
+                {
+                    found = elm;
+                    break;
+                }
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_seq.load(std::memory_order_relaxed) == seq)
+            {
+                return found;
+            }
+        }
+    }
+
+    bool remove(uint32_t hash, T* elm)
+    {
+        Table* table = _table.load(std::memory_order_relaxed);
+        if (table == nullptr)
+        {
+            return false;
+        }
+        hash = mix(hash);
+        uint32_t i = hash & table->mask;
+        while (table->slots[i].elm.load(std::memory_order_relaxed) != elm)
+        {
+            if (table->slots[i].elm.load(std::memory_order_relaxed) == nullptr)
+            {
+                return false;
+            }
+            i = (i + 1) & table->mask;
+        }
+
+        /* shift back the entries which can't be found once the slot is empty */
+        beginWrite();
+        uint32_t j = i;
+        while (true)
+        {
+            j = (j + 1) & table->mask;
+            T* next = table->slots[j].elm.load(std::memory_order_relaxed);
+            if (next == nullptr)
+            {
+                break;
+            }
+            uint32_t nextHash = table->slots[j].hash.load(std::memory_order_relaxed);
+            uint32_t home = nextHash & table->mask;
+            bool between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (!between)
+            {
+                table->slots[i].hash.store(nextHash, std::memory_order_relaxed);
+                table->slots[i].elm.store(next, std::memory_order_relaxed);
+                i = j;
+            }
+        }
+        table->slots[i].elm.store(nullptr, std::memory_order_relaxed);
+        endWrite();
+        _cnt--;
+        return true;
+    }
+
+    void clear(void)
+    {
+        Table* table = _table.load(std::memory_order_relaxed);
+        beginWrite();
+        for (uint32_t i = 0; table && i <= table->mask; i++)
+        {
+            table->slots[i].elm.store(nullptr, std::memory_order_relaxed);
+        }
+        endWrite();
+        _cnt = 0;
+    }
+
+    int getCount(void)
+    {
+        return _cnt;
+    }
+
+    size_t getMemorySize(void)
+    {
+        Table* table = _table.load(std::memory_order_relaxed);
+        return table ? sizeof(Table) + (table->mask + 1) * sizeof(Slot) : 0;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<T*> elm;
+        std::atomic<uint32_t> hash;
+    };
+
+    struct Table
+    {
+        Table(uint32_t size)
+        {
+            mask = size - 1;
+            slots = new Slot[size];
+            for (uint32_t i = 0; i < size; i++)
+            {
+                slots[i].elm.store(nullptr, std::memory_order_relaxed);
+                slots[i].hash.store(0, std::memory_order_relaxed);
+            }
+        }
+        ~Table()
+        {
+            delete[] slots;
+        }
+        uint32_t mask;
+        Slot* slots;
+    };
+
+    static void deleteTable(void* table)
+    {
+        delete (Table*) table;
+    }
+
+    static uint32_t mix(uint32_t h)
+    {
+        h ^= h >> 16;
+        h *= 0x85ebca6bU;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35U;
+        h ^= h >> 16;
+        return h;
+    }
+
+    void beginWrite(void)
+    {
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite(void)
+    {
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /*
+     *  Builds a larger table and publishes it, readers of the old one finish on it.
+     */
+    void resize(uint32_t size)
+    {
+        Table* old = _table.load(std::memory_order_relaxed);
+        Table* table = new Table(size);
+
+        for (uint32_t i = 0; old && i <= old->mask; i++)
+        {
+            T* elm = old->slots[i].elm.load(std::memory_order_relaxed);
+            if (elm != nullptr)
+            {
+                uint32_t hash = old->slots[i].hash.load(std::memory_order_relaxed);
+                uint32_t j = hash & table->mask;
+                while (table->slots[j].elm.load(std::memory_order_relaxed) != nullptr)
+                {
+                    j = (j + 1) & table->mask;
+                }
+                table->slots[j].hash.store(hash, std::memory_order_relaxed);
+                table->slots[j].elm.store(elm, std::memory_order_relaxed);
+            }
+        }
+        _table.store(table, std::memory_order_release);
+
+        if (old)
+        {
+            if (_epoch)
+            {
+                _epoch->retire(old, deleteTable);
+            }
+            else
+            {
+                delete old;
+            }
+        }
+    }
+
+    std::atomic<Table*> _table;
+    std::atomic<uint32_t> _seq;
+    Epoch* _epoch;
+    int _cnt;
+};
+
+/*=====================================
+ Class MsgIdIndex
+
+ Elements of the messages in flight, open addressed by msgId with linear probing.
+ The slots are allocated by allocate() only, add() and erase() don't allocate.
+ The owner keeps the slots less than half full and serializes the access.
+ =====================================*/
+template<class T>
+class MsgIdIndex
+{
+public:
+    MsgIdIndex()
+    {
+        _slots = nullptr;
+        _size = 0;
+        _cnt = 0;
+    }
+
+    ~MsgIdIndex()
+    {
+        delete[] _slots;
+    }
+
+    /*
+     *  Rebuilds the slots, size is a power of two. The elements are kept, size 0 releases empty slots.
+     */
+    void allocate(int size)
+    {
+        Slot* slots = _slots;
+        int oldSize = _size;
+
+        _slots = size ? new Slot[size]() : nullptr;
+        _size = size;
+        for (int i = 0; i < oldSize; i++)
+        {
+            if (slots[i].used)
+            {
+                int j = slots[i].msgId & (size - 1);
+                while (_slots[j].used)
+                {
+                    j = (j + 1) & (size - 1);
+                }
+                _slots[j] = slots[i];
+            }
+        }
+        delete[] slots;
+    }
+
+    T* find(uint16_t msgId)
+    {
+        int i = findSlot(msgId);
+        return i < 0 ? nullptr : &_slots[i].elm;
+    }
+
+    /*
+     *  Returns the element of the msgId, a new one is value initialized. nullptr when no slot is free.
+     */
+    T* add(uint16_t msgId)
+    {
+        T* elm = find(msgId);
+        if (elm || _cnt + 1 >= _size)
+        {
+            return elm;
+        }
+        int mask = _size - 1;
+        int i = msgId & mask;
+        while (_slots[i].used)
+        {
+            i = (i + 1) & mask;
+        }
+        _slots[i].used = true;
+        _slots[i].msgId = msgId;
+        _slots[i].elm = T();
+        _cnt++;
+        return &_slots[i].elm;
+    }
+
+    bool erase(uint16_t msgId)
+    {
+        int i = findSlot(msgId);
+        if (i < 0)
+        {
+            return false;
+        }
+
+        /* shift back the elements which can't be found once the slot is empty */
+        int mask = _size - 1;
+        int j = i;
+        while (true)
+        {
+            j = (j + 1) & mask;
+            if (!_slots[j].used)
+            {
+                break;
+            }
+            int home = _slots[j].msgId & mask;
+            bool between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (!between)
+            {
+                _slots[i] = _slots[j];
+                i = j;
+            }
+        }
+        _slots[i].used = false;
+        _cnt--;
+        return true;
+    }
+
+    void clear(void)
+    {
+        for (int i = 0; i < _size; i++)
+        {
+            _slots[i].used = false;
+        }
+        _cnt = 0;
+    }
+
+    /*
+     *  Calls f(msgId, elm) for each element.
+     */
+    template<typename F>
+    void forEach(F f)
+    {
+        for (int i = 0; i < _size; i++)
+        {
+            if (_slots[i].used)
+            {
+                f(_slots[i].msgId, &_slots[i].elm);
+            }
+        }
+    }
+
+    int getCount(void)
+    {
+        return _cnt;
+    }
+
+    int getSize(void)
+    {
+        return _size;
+    }
+
+    size_t getMemorySize(void)
+    {
+        return _size * sizeof(Slot);
+    }
+
+private:
+    struct Slot
+    {
+        T elm;
+        uint16_t msgId;
+        bool used;
+    };
+
+    int findSlot(uint16_t msgId)
+    {
+        int mask = _size - 1;
+        for (int i = msgId & mask; _slots && _slots[i].used; i = (i + 1) & mask)
+        {
+            if (_slots[i].msgId == msgId)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    Slot* _slots;
+    int _size;
+    int _cnt;
+};
+
 extern Process* theProcess;
 extern MultiTaskProcess* theMultiTaskProcess;
 
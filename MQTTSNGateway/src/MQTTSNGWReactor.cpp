@@ -0,0 +1,244 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+
+#include "MQTTSNGWReactor.h"
+#include "MQTTSNGWProcess.h"
+#include "MQTTSNGWClient.h"
+#include "MQTTSNGWAdapterManager.h"
+#include "MQTTSNGWPacketHandleTask.h"
+#include "MQTTSNGWClientRecvTask.h"
+#include "MQTTSNGWClientSendTask.h"
+#include "MQTTSNGWBrokerRecvTask.h"
+#include "MQTTSNGWBrokerSendTask.h"
+#include "MQTTSNPacket.h"
+#include "SensorNetwork.h"
+#include "Timer.h"
+#include <errno.h>
+#include <unistd.h>
+#ifndef __APPLE__
+#include <sys/epoll.h>
+#endif
+
+using namespace MQTTSNGW;
+
+char* currentDateTime(void);
+
+/*=====================================
+ Class Reactor
+ =====================================*/
+Reactor::Reactor(Gateway* gateway)
+{
+    _gateway = gateway;
+}
+
+Reactor::~Reactor()
+{
+    if (_epollFd >= 0)
+    {
+        close(_epollFd);
+    }
+}
+
+/*
+ *  Finds the tasks attached to the gateway and registers the sockets of the SensorNetwork.
+ */
+void Reactor::initialize(void)
+{
+#ifdef __APPLE__
+    throw Exception("Reactor::initialize: ReactorMode is not supported on this platform.", 0);
+#else
+    for (int i = 0; i < _gateway->getThreadCount(); i++)
+    {
+        Thread* thread = _gateway->getThread(i);
+        if (_packetHandleTask == nullptr)
+        {
+            _packetHandleTask = dynamic_cast<PacketHandleTask*>(thread);
+        }
+        if (_clientRecvTask == nullptr)
+        {
+            _clientRecvTask = dynamic_cast<ClientRecvTask*>(thread);
+        }
+        if (_clientSendTask == nullptr)
+        {
+            _clientSendTask = dynamic_cast<ClientSendTask*>(thread);
+        }
+        if (_brokerRecvTask == nullptr)
+        {
+            _brokerRecvTask = dynamic_cast<BrokerRecvTask*>(thread);
+        }
+        if (_brokerSendTask == nullptr)
+        {
+            _brokerSendTask = dynamic_cast<BrokerSendTask*>(thread);
+        }
+    }
+
+    if (!_packetHandleTask || !_clientRecvTask || !_clientSendTask || !_brokerRecvTask || !_brokerSendTask)
+    {
+        throw Exception("Reactor::initialize: a task is missing.", 0);
+    }
+
+    int fds[REACTOR_MAX_SENSOR_FDS];
+    int cnt = _gateway->getSensorNetwork()->getPollFds(fds, REACTOR_MAX_SENSOR_FDS);
+    if (cnt == 0)
+    {
+        throw Exception("Reactor::initialize: SensorNetwork doesn't support ReactorMode.", 0);
+    }
+
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epollFd < 0)
+    {
+        throw Exception("Reactor::initialize: can't create an epoll instance.", errno);
+    }
+
+    for (int i = 0; i < cnt; i++)
+    {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;    // nullptr marks the SensorNetwork
+        if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fds[i], &event) < 0)
+        {
+            throw Exception("Reactor::initialize: can't watch the SensorNetwork.", errno);
+        }
+    }
+#endif
+}
+
+/*
+ *  Runs until CTRL+C entered or Exception occurred.
+ */
+void Reactor::run(void)
+{
+#ifndef __APPLE__
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    SensorNetwork* sensorNetwork = _gateway->getSensorNetwork();
+    ClientList* clientList = _gateway->getClientList();
+    Timer timer;
+
+    _packetHandleTask->startTimers();
+    timer.start(REACTOR_TIMEOUT_TIME);
+
+    while (true)
+    {
+        int cnt = epoll_wait(_epollFd, events, REACTOR_MAX_EVENTS, REACTOR_WAIT_TIME);
+
+        if (CHK_SIGINT)
+        {
+            WRITELOG("%s Reactor stopped.\n", currentDateTime());
+            return;
+        }
+
+        if (_gateway->checkReload())
+        {
+            _gateway->reload();
+        }
+
+        for (int i = 0; i < cnt; i++)
+        {
+            Client* client = (Client*) events[i].data.ptr;
+
+            if (client == nullptr)
+            {
+                MQTTSNPacket* packet = new MQTTSNPacket();
+                int packetLen = packet->recv(sensorNetwork);
+                clientList->beginRead();
+                _clientRecvTask->handlePacket(packet, packetLen);
+                clientList->endRead();
+            }
+            else if (client->getNetwork()->isValid())
+            {
+                _brokerRecvTask->recvPacket(client);
+            }
+            dispatch();
+        }
+
+        if (timer.isTimeup())
+        {
+            Event* ev = new Event();
+            ev->setTimeout();
+            _packetHandleTask->handleEvent(ev);
+            delete ev;
+            dispatch();
+            timer.start(REACTOR_TIMEOUT_TIME);
+        }
+    }
+#endif
+}
+
+/*
+ *  Handles the Events posted by the handlers until all EventQues are empty.
+ */
+void Reactor::dispatch(void)
+{
+    EventQue* packetEventQue = _gateway->getPacketEventQue()->getQue(0);
+    EventQue* brokerSendQue = _gateway->getBrokerSendQue();
+    EventQue* clientSendQue = _gateway->getClientSendQue();
+    Event* ev = nullptr;
+    bool busy = true;
+
+    while (busy)
+    {
+        busy = false;
+
+        while ((ev = packetEventQue->pop()) != nullptr)
+        {
+            _packetHandleTask->handleEvent(ev);
+            delete ev;
+            busy = true;
+        }
+
+        while ((ev = brokerSendQue->pop()) != nullptr)
+        {
+            _brokerSendTask->handleEvent(ev);
+            if (ev->getEventType() == EtBrokerSend)
+            {
+                watchBroker(ev->getClient());
+            }
+            delete ev;
+            busy = true;
+        }
+
+        while ((ev = clientSendQue->pop()) != nullptr)
+        {
+            _clientSendTask->handleEvent(ev);
+            delete ev;
+            busy = true;
+        }
+    }
+}
+
+/*
+ *  Adds the broker connection of the client to the epoll set after it has been connected.
+ */
+void Reactor::watchBroker(Client* client)
+{
+#ifndef __APPLE__
+    client = _gateway->getAdapterManager()->getClient(client);
+    Network* network = client->getNetwork();
+
+    if (!network->isValid())
+    {
+        return;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = client;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, network->getSock(), &event) < 0 && errno == EEXIST)
+    {
+        epoll_ctl(_epollFd, EPOLL_CTL_MOD, network->getSock(), &event);
+    }
+#endif
+}
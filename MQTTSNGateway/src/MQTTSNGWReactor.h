@@ -0,0 +1,67 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation and/or initial documentation
+ **************************************************************************************/
+#ifndef MQTTSNGWREACTOR_H_
+#define MQTTSNGWREACTOR_H_
+
+#include "MQTTSNGateway.h"
+
+namespace MQTTSNGW
+{
+
+#define REACTOR_MAX_EVENTS     64
+#define REACTOR_MAX_SENSOR_FDS 4
+#define REACTOR_WAIT_TIME      1000   // msecs
+#define REACTOR_TIMEOUT_TIME   2000   // msecs, same as the EventQue timeout of PacketHandleTask
+
+class Client;
+class PacketHandleTask;
+class ClientRecvTask;
+class ClientSendTask;
+class BrokerRecvTask;
+class BrokerSendTask;
+
+/*=====================================
+ Class Reactor
+
+ Runs all tasks of the gateway in the calling thread.
+ The sockets of the SensorNetwork and of the broker connections are watched by one epoll set,
+ and the Events posted by a handler are dispatched inline until all EventQues are empty.
+ Only SensorNetworks which expose their sockets by getPollFds() are supported.
+ =====================================*/
+class Reactor
+{
+public:
+    Reactor(Gateway* gateway);
+    ~Reactor();
+    void initialize(void);
+    void run(void);
+
+private:
+    void dispatch(void);
+    void watchBroker(Client* client);
+
+    Gateway* _gateway;
+    PacketHandleTask* _packetHandleTask { nullptr };
+    ClientRecvTask* _clientRecvTask { nullptr };
+    ClientSendTask* _clientSendTask { nullptr };
+    BrokerRecvTask* _brokerRecvTask { nullptr };
+    BrokerSendTask* _brokerSendTask { nullptr };
+    int _epollFd { -1 };
+};
+
+}
+
+#endif /* MQTTSNGWREACTOR_H_ */
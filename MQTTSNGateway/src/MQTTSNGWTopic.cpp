@@ -28,21 +28,29 @@ Topic::Topic()
 {
     _type = MQTTSN_TOPIC_TYPE_NORMAL;
     _topicName = nullptr;
+    _interned = false;
     _topicId = 0;
     _next = nullptr;
+    _seq = 0;
 }
 
 Topic::Topic(string* topic, MQTTSN_topicTypes type)
 {
     _type = type;
     _topicName = topic;
+    _interned = false;
     _topicId = 0;
     _next = nullptr;
+    _seq = 0;
 }
 
 Topic::~Topic()
 {
-    if (_topicName)
+    if (_topicName && _interned)
+    {
+        TopicNameTable::getInstance()->release(_topicName);
+    }
+    else if (_topicName)
     {
         delete _topicName;
     }
@@ -68,7 +76,8 @@ Topic* Topic::duplicate(void)
     Topic* newTopic = new Topic();
     newTopic->_type = _type;
     newTopic->_topicId = _topicId;
-    newTopic->_topicName = new string(_topicName->c_str());
+    newTopic->_topicName = TopicNameTable::getInstance()->intern(_topicName->data(), _topicName->size());
+    newTopic->_interned = true;
     return newTopic;
 }
 
@@ -169,14 +178,336 @@ void Topic::print(void)
     WRITELOG("TopicName=%s  ID=%d  Type=%d\n", _topicName->c_str(), _topicId, _type);
 }
 
+/*=====================================
+ Class TopicTrieNode
+ ======================================*/
+TopicTrieNode::TopicTrieNode(TopicTrieNode* parent, const char* level, int len) :
+        _level(level, len)
+{
+    _parent = parent;
+    _child = nullptr;
+    _sibling = nullptr;
+    _prevSibling = nullptr;
+    _childCnt = 0;
+    _plus = nullptr;
+    _topic = nullptr;
+    _hash = nullptr;
+}
+
+TopicTrieNode::~TopicTrieNode()
+{
+    TopicTrieNode* p = _child;
+    while (p)
+    {
+        TopicTrieNode* q = p->_sibling;
+        delete p;
+        p = q;
+    }
+    if (_plus)
+    {
+        delete _plus;
+    }
+}
+
+/*=====================================
+ Class TopicTrie
+ ======================================*/
+TopicTrie::TopicTrie()
+{
+    _root = new TopicTrieNode(nullptr, "", 0);
+    _nodeCnt = 1;
+}
+
+TopicTrie::~TopicTrie()
+{
+    delete _root;
+}
+
+void TopicTrie::clear(void)
+{
+    _children.clear();
+    delete _root;
+    _root = new TopicTrieNode(nullptr, "", 0);
+    _nodeCnt = 1;
+}
+
+uint32_t TopicTrie::hashChild(TopicTrieNode* parent, const char* level, size_t len)
+{
+    return hashBytes(level, len) ^ hashPointer(parent);
+}
+
+TopicTrieNode* TopicTrie::findChild(TopicTrieNode* node, const char* level, size_t len)
+{
+    if (node->_childCnt <= TOPICTRIE_SCAN_CHILDREN)
+    {
+        for (TopicTrieNode* child = node->_child; child; child = child->_sibling)
+        {
+            if (child->_level.size() == len && memcmp(child->_level.data(), level, len) == 0)
+            {
+                return child;
+            }
+        }
+        return nullptr;
+    }
+    return _children.find(hashChild(node, level, len), [node, level, len](TopicTrieNode* child)
+    {
+        return child->_parent == node && child->_level.size() == len && memcmp(child->_level.data(), level, len) == 0;
+    });
+}
+
+/*
+ *  Unlinks a literal child from its parent and deletes it.
+ */
+void TopicTrie::eraseChild(TopicTrieNode* child)
+{
+    TopicTrieNode* parent = child->_parent;
+    _children.remove(hashChild(parent, child->_level.data(), child->_level.size()), child);
+    if (child->_prevSibling)
+    {
+        child->_prevSibling->_sibling = child->_sibling;
+    }
+    else
+    {
+        parent->_child = child->_sibling;
+    }
+    if (child->_sibling)
+    {
+        child->_sibling->_prevSibling = child->_prevSibling;
+    }
+    parent->_childCnt--;
+    child->_sibling = nullptr;
+    delete child;
+    _nodeCnt--;
+}
+
+/*
+ *  Adds the filter of the topic. A filter which is already indexed keeps its first Topic.
+ *  The levels after '#' are ignored.
+ */
+void TopicTrie::add(Topic* topic)
+{
+    const char* level = topic->_topicName->c_str();
+    const char* end = level + topic->_topicName->size();
+    TopicTrieNode* node = _root;
+
+    while (true)
+    {
+        const char* sep = (const char*) memchr(level, '/', end - level);
+        int len = (sep ? sep : end) - level;
+
+        if (len == 1 && *level == MQTTSN_TOPIC_MULTI_WILDCARD)
+        {
+            if (node->_hash == nullptr)
+            {
+                node->_hash = topic;
+            }
+            return;
+        }
+
+        TopicTrieNode* next = nullptr;
+        if (len == 1 && *level == MQTTSN_TOPIC_SINGLE_WILDCARD)
+        {
+            if (node->_plus == nullptr)
+            {
+                node->_plus = new TopicTrieNode(node, level, len);
+                _nodeCnt++;
+            }
+            next = node->_plus;
+        }
+        else
+        {
+            next = findChild(node, level, len);
+            if (next == nullptr)
+            {
+                next = new TopicTrieNode(node, level, len);
+                next->_sibling = node->_child;
+                if (node->_child)
+                {
+                    node->_child->_prevSibling = next;
+                }
+                node->_child = next;
+                node->_childCnt++;
+                _children.add(hashChild(node, level, len), next);
+                _nodeCnt++;
+            }
+        }
+        node = next;
+
+        if (sep == nullptr)
+        {
+            if (node->_topic == nullptr)
+            {
+                node->_topic = topic;
+            }
+            return;
+        }
+        level = sep + 1;
+    }
+}
+
+/*
+ *  Returns the first added Topic whose filter matches the name, or nullptr.
+ */
+Topic* TopicTrie::match(const char* name, int len)
+{
+    Topic* found = nullptr;
+    match(_root, name, name + len, &found);
+    return found;
+}
+
+/*
+ *  level points the next level of the name, nullptr after the last level.
+ */
+void TopicTrie::match(TopicTrieNode* node, const char* level, const char* end, Topic** found)
+{
+    /* '#' matches the rest of the name, also no level */
+    if (node->_hash && (*found == nullptr || node->_hash->_seq < (*found)->_seq))
+    {
+        *found = node->_hash;
+    }
+
+    if (level == nullptr)
+    {
+        if (node->_topic && (*found == nullptr || node->_topic->_seq < (*found)->_seq))
+        {
+            *found = node->_topic;
+        }
+        return;
+    }
+
+    const char* sep = (const char*) memchr(level, '/', end - level);
+    size_t len = (sep ? sep : end) - level;
+    const char* next = sep ? sep + 1 : nullptr;
+
+    TopicTrieNode* child = findChild(node, level, len);
+    if (child)
+    {
+        match(child, next, end, found);
+    }
+    if (node->_plus)
+    {
+        match(node->_plus, next, end, found);
+    }
+}
+
+/*
+ *  Stores the Topics of all filters which match the name, up to size. Returns their number.
+ */
+int TopicTrie::matchAll(const char* name, int len, Topic** topics, int size)
+{
+    int cnt = 0;
+    matchAll(_root, name, name + len, topics, size, &cnt);
+    return cnt;
+}
+
+void TopicTrie::matchAll(TopicTrieNode* node, const char* level, const char* end, Topic** topics, int size, int* cnt)
+{
+    if (node->_hash && *cnt < size)
+    {
+        topics[(*cnt)++] = node->_hash;
+    }
+
+    if (level == nullptr)
+    {
+        if (node->_topic && *cnt < size)
+        {
+            topics[(*cnt)++] = node->_topic;
+        }
+        return;
+    }
+
+    const char* sep = (const char*) memchr(level, '/', end - level);
+    size_t len = (sep ? sep : end) - level;
+    const char* next = sep ? sep + 1 : nullptr;
+
+    TopicTrieNode* child = findChild(node, level, len);
+    if (child)
+    {
+        matchAll(child, next, end, topics, size, cnt);
+    }
+    if (node->_plus)
+    {
+        matchAll(node->_plus, next, end, topics, size, cnt);
+    }
+}
+
+/*
+ *  Removes the filter of the topic and deletes the nodes left empty.
+ */
+void TopicTrie::remove(Topic* topic)
+{
+    const char* name = topic->_topicName->c_str();
+    remove(_root, name, name + topic->_topicName->size(), topic);
+}
+
+/*
+ *  Returns true if the node has become empty.
+ */
+bool TopicTrie::remove(TopicTrieNode* node, const char* level, const char* end, Topic* topic)
+{
+    const char* sep = (const char*) memchr(level, '/', end - level);
+    size_t len = (sep ? sep : end) - level;
+
+    if (len == 1 && *level == MQTTSN_TOPIC_MULTI_WILDCARD)
+    {
+        if (node->_hash == topic)
+        {
+            node->_hash = nullptr;
+        }
+    }
+    else
+    {
+        bool plus = len == 1 && *level == MQTTSN_TOPIC_SINGLE_WILDCARD;
+        TopicTrieNode* next = plus ? node->_plus : findChild(node, level, len);
+        if (next == nullptr)
+        {
+            return false;
+        }
+
+        bool empty = false;
+        if (sep == nullptr)
+        {
+            if (next->_topic == topic)
+            {
+                next->_topic = nullptr;
+            }
+            empty = next->_topic == nullptr && next->_hash == nullptr && next->_child == nullptr && next->_plus == nullptr;
+        }
+        else
+        {
+            empty = remove(next, sep + 1, end, topic);
+        }
+
+        if (empty && plus)
+        {
+            node->_plus = nullptr;
+            delete next;
+            _nodeCnt--;
+        }
+        else if (empty)
+        {
+            eraseChild(next);
+        }
+    }
+    return node != _root && node->_topic == nullptr && node->_hash == nullptr && node->_child == nullptr
+            && node->_plus == nullptr;
+}
+
+size_t TopicTrie::getMemorySize(void)
+{
+    return sizeof(TopicTrieNode) * _nodeCnt + _children.getMemorySize();
+}
+
 /*=====================================
  Class Topics
  ======================================*/
 Topics::Topics()
 {
     _first = nullptr;
+    _last = nullptr;
     _nextTopicId = 0;
     _cnt = 0;
+    _seq = 0;
 }
 
 Topics::~Topics()
@@ -192,34 +523,39 @@ Topics::~Topics()
 
 Topic* Topics::getTopicByName(const MQTTSN_topicid* topicid)
 {
-    Topic* p = _first;
-    char* ch = topicid->data.long_.name;
+    _mutex.lock();
+    Topic* p = find(topicid->data.long_.name, topicid->data.long_.len);
+    _mutex.unlock();
+    return p;
+}
 
-    string sname = string(ch, ch + topicid->data.long_.len);
-    while (p)
+Topic* Topics::find(const char* name, int len)
+{
+    return _nameIndex.find(hashBytes(name, len), [name, len](Topic* topic)
     {
-        if (p->_topicName->compare(sname) == 0)
-        {
-            return p;
-        }
-        p = p->_next;
-    }
-    return 0;
+        return topic->_topicName->size() == (size_t) len && memcmp(topic->_topicName->data(), name, len) == 0;
+    });
 }
 
 Topic* Topics::getTopicById(const MQTTSN_topicid* topicid)
 {
-    Topic* p = _first;
+    uint16_t id = topicid->data.id;
+    Topic* p = nullptr;
 
-    while (p)
+    _mutex.lock();
+    if (topicid->type == MQTTSN_TOPIC_TYPE_NORMAL)
+    {
+        p = findNormal(id);
+    }
+    else if (topicid->type == MQTTSN_TOPIC_TYPE_PREDEFINED)
     {
-        if (p->_type == topicid->type && p->_topicId == topicid->data.id)
+        p = _predefinedIndex.find(id, [id](Topic* topic)
         {
-            return p;
-        }
-        p = p->_next;
+            return topic->_topicId == id;
+        });
     }
-    return 0;
+    _mutex.unlock();
+    return p;
 }
 
 // For MQTTSN_TOPIC_TYPE_NORMAL */
@@ -230,57 +566,62 @@ Topic* Topics::add(const MQTTSN_topicid* topicid)
         return 0;
     }
 
-    Topic* topic = getTopicByName(topicid);
-
-    if (topic)
-    {
-        return topic;
-    }
     string name(topicid->data.long_.name, topicid->data.long_.len);
     return add(name.c_str(), 0);
 }
 
 Topic* Topics::add(const char* topicName, uint16_t id)
 {
-    MQTTSN_topicid topicId;
-
-    if (_cnt >= MAX_TOPIC_PAR_CLIENT)
-    {
-        return 0;
-    }
+    return insert(topicName, id == 0 ? MQTTSN_TOPIC_TYPE_NORMAL : MQTTSN_TOPIC_TYPE_PREDEFINED, id);
+}
 
-    topicId.data.long_.name = (char*) const_cast<char*>(topicName);
-    topicId.data.long_.len = strlen(topicName);
+/*
+ *  Adds a topic of the type. A NORMAL topic gets the next free id unless id is given.
+ */
+Topic* Topics::insert(const char* topicName, MQTTSN_topicTypes type, uint16_t id)
+{
+    int len = strlen(topicName);
 
-    Topic* topic = getTopicByName(&topicId);
+    _mutex.lock();
+    Topic* topic = find(topicName, len);
 
     if (topic)
     {
+        _mutex.unlock();
         return topic;
     }
 
-    topic = new Topic();
-
-    if (topic == nullptr)
+    if (_cnt >= MAX_TOPIC_PAR_CLIENT)
     {
-        return nullptr;
+        _mutex.unlock();
+        return 0;
     }
 
-    string* name = new string(topicName);
-    topic->_topicName = name;
+    topic = new Topic();
+    topic->_topicName = TopicNameTable::getInstance()->intern(topicName, len);
+    topic->_interned = true;
+    topic->_type = type;
 
-    if (id == 0)
+    if (type == MQTTSN_TOPIC_TYPE_NORMAL)
     {
-        topic->_type = MQTTSN_TOPIC_TYPE_NORMAL;
-        topic->_topicId = getNextTopicId();
+        /* skip the ids still used after _nextTopicId has wrapped around */
+        while (id == 0 || findNormal(id))
+        {
+            id = getNextTopicId();
+        }
+        topic->_topicId = id;
+        _normalIndex.add(id, topic);
     }
     else
     {
-        topic->_type = MQTTSN_TOPIC_TYPE_PREDEFINED;
         topic->_topicId = id;
+        _predefinedIndex.add(id, topic);
     }
 
     _cnt++;
+    topic->_seq = _seq++;
+    _nameIndex.add(hashBytes(topicName, len), topic);
+    _trie.add(topic);
 
     if (_first == nullptr)
     {
@@ -288,23 +629,21 @@ Topic* Topics::add(const char* topicName, uint16_t id)
     }
     else
     {
-        Topic* tp = _first;
-        while (tp)
-        {
-            if (tp->_next == nullptr)
-            {
-                tp->_next = topic;
-                break;
-            }
-            else
-            {
-                tp = tp->_next;
-            }
-        }
+        _last->_next = topic;
     }
+    _last = topic;
+    _mutex.unlock();
     return topic;
 }
 
+Topic* Topics::findNormal(uint16_t id)
+{
+    return _normalIndex.find(id, [id](Topic* topic)
+    {
+        return topic->_topicId == id;
+    });
+}
+
 uint16_t Topics::getNextTopicId()
 {
     return ++_nextTopicId == 0xffff ? _nextTopicId += 2 : _nextTopicId;
@@ -316,22 +655,16 @@ Topic* Topics::match(const MQTTSN_topicid* topicid)
     {
         return 0;
     }
-    string topicName(topicid->data.long_.name, topicid->data.long_.len);
 
-    Topic* topic = _first;
-    while (topic)
-    {
-        if (topic->isMatch(&topicName))
-        {
-            return topic;
-        }
-        topic = topic->_next;
-    }
-    return 0;
+    _mutex.lock();
+    Topic* topic = _trie.match(topicid->data.long_.name, topicid->data.long_.len);
+    _mutex.unlock();
+    return topic;
 }
 
 void Topics::eraseNormal(void)
 {
+    _mutex.lock();
     Topic* topic = _first;
     Topic* next = nullptr;
     Topic* prev = nullptr;
@@ -349,6 +682,7 @@ void Topics::eraseNormal(void)
             {
                 prev->_next = next;
             }
+            _nameIndex.remove(hashBytes(topic->_topicName->data(), topic->_topicName->size()), topic);
             delete topic;
             _cnt--;
             topic = next;
@@ -359,6 +693,15 @@ void Topics::eraseNormal(void)
             topic = topic->_next;
         }
     }
+    _last = prev;
+    _normalIndex.clear();
+
+    _trie.clear();
+    for (topic = _first; topic; topic = topic->_next)
+    {
+        _trie.add(topic);
+    }
+    _mutex.unlock();
 }
 
 Topic* Topics::getFirstTopic(void)
@@ -388,40 +731,125 @@ void Topics::print(void)
     }
 }
 
-uint8_t Topics::getCount(void)
+int Topics::getCount(void)
 {
     return _cnt;
 }
 
+/*
+ *  Bytes held by the Topics, the indexes and the TopicTrie.
+ *  The names are counted by the TopicNameTable.
+ */
+size_t Topics::getMemorySize(void)
+{
+    return sizeof(Topics) + _trie.getMemorySize() + _nameIndex.getMemorySize() + _predefinedIndex.getMemorySize()
+            + _normalIndex.getMemorySize() + _cnt * sizeof(Topic);
+}
+
 /*=====================================
- Class TopicIdMap
- =====================================*/
-TopicIdMapElement::TopicIdMapElement(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic)
+ Class TopicNameTable
+ ======================================*/
+TopicName::TopicName(const char* name, int len) :
+        _name(name, len)
 {
-    _msgId = msgId;
-    _topicId = topicId;
-    _type = topic->type;
-    _wildcard = 0;
-    _next = nullptr;
-    _prev = nullptr;
+    _refCnt = 0;
+}
 
-    if (_type == MQTTSN_TOPIC_TYPE_NORMAL)
+TopicName::~TopicName()
+{
+
+}
+
+TopicNameTable::TopicNameTable()
+{
+    _cnt = 0;
+    _size = 0;
+}
+
+TopicNameTable::~TopicNameTable()
+{
+
+}
+
+/*
+ *  The table is never deleted, so Topics destroyed at the exit can still release their names.
+ */
+TopicNameTable* TopicNameTable::getInstance(void)
+{
+    static TopicNameTable* table = new TopicNameTable();
+    return table;
+}
+
+/*
+ *  Returns the interned string of the name and adds a reference to it.
+ */
+string* TopicNameTable::intern(const char* name, int len)
+{
+    uint32_t hash = hashBytes(name, len);
+
+    _mutex.lock();
+    TopicName* topicName = _index.find(hash, [name, len](TopicName* tn)
     {
-        if (strchr(topic->data.long_.name, '#') != 0 || strchr(topic->data.long_.name, '+') != 0)
-        {
-            _wildcard = 1;
-        }
+        return tn->_name.size() == (size_t) len && memcmp(tn->_name.data(), name, len) == 0;
+    });
+
+    if (topicName == nullptr)
+    {
+        topicName = new TopicName(name, len);
+        _index.add(hash, topicName);
+        _cnt++;
+        _size += sizeof(TopicName) + topicName->_name.capacity() + 1;
+    }
+    topicName->_refCnt++;
+    _mutex.unlock();
+    return &topicName->_name;
+}
+
+/*
+ *  Drops a reference to the interned string, the name is deleted with the last one.
+ */
+void TopicNameTable::release(string* name)
+{
+    uint32_t hash = hashBytes(name->data(), name->size());
+
+    _mutex.lock();
+    TopicName* topicName = _index.find(hash, [name](TopicName* tn)
+    {
+        return &tn->_name == name;
+    });
+
+    if (topicName && --topicName->_refCnt == 0)
+    {
+        _index.remove(hash, topicName);
+        _cnt--;
+        _size -= sizeof(TopicName) + topicName->_name.capacity() + 1;
+        delete topicName;
     }
+    _mutex.unlock();
 }
 
-TopicIdMapElement::~TopicIdMapElement()
+int TopicNameTable::getCount(void)
 {
+    _mutex.lock();
+    int cnt = _cnt;
+    _mutex.unlock();
+    return cnt;
+}
 
+size_t TopicNameTable::getMemorySize(void)
+{
+    _mutex.lock();
+    size_t size = sizeof(TopicNameTable) + _size + _index.getMemorySize();
+    _mutex.unlock();
+    return size;
 }
 
+/*=====================================
+ Class TopicIdMap
+ =====================================*/
 MQTTSN_topicTypes TopicIdMapElement::getTopicType(void)
 {
-    return _type;
+    return (MQTTSN_topicTypes) _type;
 }
 
 uint16_t TopicIdMapElement::getTopicId(void)
@@ -436,115 +864,77 @@ uint16_t TopicIdMapElement::getTopicId(void)
     }
 }
 
-TopicIdMap::TopicIdMap()
+/*
+ *  Up to maxInflight * 2 + 1 elements are accepted, the slots are kept less than half full.
+ */
+TopicIdMap::TopicIdMap(int maxInflight)
 {
-    _maxInflight = MAX_INFLIGHTMESSAGES;
-    _msgIds = 0;
-    _first = nullptr;
-    _end = nullptr;
-    _cnt = 0;
+    _maxCnt = maxInflight * 2 + 1;
+    int size = 4;
+    while (size < _maxCnt * 2)
+    {
+        size <<= 1;
+    }
+    _index.allocate(size);
 }
 
 TopicIdMap::~TopicIdMap()
 {
-    TopicIdMapElement* p = _first;
-    while (p)
-    {
-        TopicIdMapElement* q = p->_next;
-        delete p;
-        p = q;
-    }
+
+}
+
+int TopicIdMap::getCount(void)
+{
+    return _index.getCount();
+}
+
+size_t TopicIdMap::getMemorySize(void)
+{
+    return sizeof(TopicIdMap) + _index.getMemorySize();
 }
 
 TopicIdMapElement* TopicIdMap::getElement(uint16_t msgId)
 {
-    TopicIdMapElement* p = _first;
-    while (p)
-    {
-        if (p->_msgId == msgId)
-        {
-            return p;
-        }
-        p = p->_next;
-    }
-    return 0;
+    return _index.find(msgId);
 }
 
 TopicIdMapElement* TopicIdMap::add(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic)
 {
-    if (_cnt > _maxInflight * 2 || (topicId == 0 && topic->type != MQTTSN_TOPIC_TYPE_SHORT))
+    if (topicId == 0 && topic->type != MQTTSN_TOPIC_TYPE_SHORT)
     {
-        return 0;
-    }
-    if (getElement(msgId))
-    {
-        erase(msgId);
+        return nullptr;
     }
 
-    TopicIdMapElement* elm = new TopicIdMapElement(msgId, topicId, topic);
-    if (elm == 0)
-    {
-        return 0;
-    }
-    if (_first == nullptr)
+    TopicIdMapElement* elm = _index.find(msgId);
+    if (elm == nullptr)
     {
-        _first = elm;
-        _end = elm;
+        if (_index.getCount() >= _maxCnt)
+        {
+            return nullptr;
+        }
+        elm = _index.add(msgId);
     }
-    else
+
+    elm->_topicId = topicId;
+    elm->_type = topic->type;
+    elm->_wildcard = 0;
+    if (topic->type == MQTTSN_TOPIC_TYPE_NORMAL)
     {
-        elm->_prev = _end;
-        _end->_next = elm;
-        _end = elm;
+        if (strchr(topic->data.long_.name, '#') != 0 || strchr(topic->data.long_.name, '+') != 0)
+        {
+            elm->_wildcard = 1;
+        }
     }
-    _cnt++;
     return elm;
 }
 
 void TopicIdMap::erase(uint16_t msgId)
 {
-    TopicIdMapElement* p = _first;
-    while (p)
-    {
-        if (p->_msgId == msgId)
-        {
-            if (p->_prev == nullptr)
-            {
-                _first = p->_next;
-            }
-            else
-            {
-                p->_prev->_next = p->_next;
-            }
-
-            if (p->_next == nullptr)
-            {
-                _end = p->_prev;
-            }
-            else
-            {
-                p->_next->_prev = p->_prev;
-            }
-            delete p;
-            break;
-
-        }
-        p = p->_next;
-    }
-    _cnt--;
+    _index.erase(msgId);
 }
 
 void TopicIdMap::clear(void)
 {
-    TopicIdMapElement* p = _first;
-    while (p)
-    {
-        TopicIdMapElement* q = p->_next;
-        delete p;
-        p = q;
-    }
-    _first = nullptr;
-    _end = nullptr;
-    _cnt = 0;
+    _index.clear();
 }
 
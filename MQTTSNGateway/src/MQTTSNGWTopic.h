@@ -20,6 +20,8 @@
 
 #include "MQTTSNGWPacket.h"
 #include "MQTTSNPacket.h"
+#include "MQTTSNGWProcess.h"
+#include "Threading.h"
 
 namespace MQTTSNGW
 {
@@ -30,7 +32,9 @@ namespace MQTTSNGW
 class Topic
 {
     friend class Topics;
+    friend class TopicTrie;
     friend class AggregateTopicTable;
+    friend class Handoff;
 public:
     Topic();
     Topic(string* topic, MQTTSN_topicTypes type);
@@ -46,14 +50,116 @@ private:
     MQTTSN_topicTypes _type;
     uint16_t _topicId;
     string* _topicName;
+    bool _interned;     // _topicName is held in the TopicNameTable
     Topic* _next;
+    uint32_t _seq;      // order of addition, the first added filter wins a match
+};
+
+/*=====================================
+ Class TopicName
+ ======================================*/
+class TopicName
+{
+    friend class TopicNameTable;
+public:
+    TopicName(const char* name, int len);
+    ~TopicName();
+
+private:
+    string _name;
+    int _refCnt;
+};
+
+/*=====================================
+ Class TopicNameTable
+
+ Topic names of all clients of the gateway, each stored once.
+ A Topic holds the string of an interned name, which is freed when the last Topic releases it.
+ ======================================*/
+class TopicNameTable
+{
+public:
+    static TopicNameTable* getInstance(void);
+    string* intern(const char* name, int len);
+    void release(string* name);
+    int getCount(void);
+    size_t getMemorySize(void);
+
+private:
+    TopicNameTable();
+    ~TopicNameTable();
+    HashIndex<TopicName> _index;
+    int _cnt;
+    size_t _size;
+    Mutex _mutex;
+};
+
+/*=====================================
+ Class TopicTrieNode
+ ======================================*/
+#define TOPICTRIE_SCAN_CHILDREN  8   // more literal children than this are found by the hash
+
+class TopicTrieNode
+{
+    friend class TopicTrie;
+public:
+    TopicTrieNode(TopicTrieNode* parent, const char* level, int len);
+    ~TopicTrieNode();
+
+private:
+    string _level;
+    TopicTrieNode* _parent;
+    TopicTrieNode* _child;      // first child of a literal level
+    TopicTrieNode* _sibling;
+    TopicTrieNode* _prevSibling;
+    int _childCnt;
+    TopicTrieNode* _plus;       // child of the '+' level
+    Topic* _topic;              // filter ending at this node
+    Topic* _hash;               // filter ending with '#' below this node
+};
+
+/*=====================================
+ Class TopicTrie
+
+ Topic filters of the Topics indexed level by level.
+ match() walks the levels of a topic name once, following the literal and the '+' children,
+ and doesn't allocate. The literal children of a wide level are found by a hash of the parent
+ and the level, so a level with thousands of children costs about the same as one with a few.
+ ======================================*/
+class TopicTrie
+{
+public:
+    TopicTrie();
+    ~TopicTrie();
+    void add(Topic* topic);
+    void remove(Topic* topic);
+    void clear(void);
+    Topic* match(const char* name, int len);
+    int matchAll(const char* name, int len, Topic** topics, int size);
+    size_t getMemorySize(void);
+
+private:
+    void match(TopicTrieNode* node, const char* level, const char* end, Topic** found);
+    void matchAll(TopicTrieNode* node, const char* level, const char* end, Topic** topics, int size, int* cnt);
+    bool remove(TopicTrieNode* node, const char* level, const char* end, Topic* topic);
+    TopicTrieNode* findChild(TopicTrieNode* node, const char* level, size_t len);
+    void eraseChild(TopicTrieNode* child);
+    static uint32_t hashChild(TopicTrieNode* parent, const char* level, size_t len);
+    TopicTrieNode* _root;
+    HashIndex<TopicTrieNode> _children;    // literal children by parent and level
+    int _nodeCnt;
 };
 
 /*=====================================
  Class Topics
+
+ Topics of a client, in the order of addition.
+ Names and ids are hashed, so the lookups of REGISTER and PUBLISH don't depend
+ on the number of topics.
  ======================================*/
 class Topics
 {
+    friend class Handoff;
 public:
     Topics();
     ~Topics();
@@ -67,11 +173,22 @@ public:
     void eraseNormal(void);
     uint16_t getNextTopicId();
     void print(void);
-    uint8_t getCount(void);
+    int getCount(void);
+    size_t getMemorySize(void);
 private:
+    Topic* insert(const char* topicName, MQTTSN_topicTypes type, uint16_t id);
+    Topic* find(const char* name, int len);
+    Topic* findNormal(uint16_t id);
     uint16_t _nextTopicId;
     Topic* _first;
-    uint8_t _cnt;
+    Topic* _last;
+    int _cnt;
+    uint32_t _seq;
+    HashIndex<Topic> _nameIndex;          // Topics by name
+    HashIndex<Topic> _predefinedIndex;    // PREDEFINED Topics by id
+    HashIndex<Topic> _normalIndex;        // NORMAL Topics by id, ids keep growing across sessions
+    TopicTrie _trie;
+    Mutex _mutex;
 };
 
 /*=====================================
@@ -80,36 +197,38 @@ private:
 class TopicIdMapElement
 {
     friend class TopicIdMap;
+    friend class Handoff;
 public:
-    TopicIdMapElement(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic);
-    ~TopicIdMapElement();
     MQTTSN_topicTypes getTopicType(void);
     uint16_t getTopicId(void);
 
 private:
-    uint16_t _msgId;
     uint16_t _topicId;
     uint8_t _wildcard;
-    MQTTSN_topicTypes _type;
-    TopicIdMapElement* _next;
-    TopicIdMapElement* _prev;
+    uint8_t _type;
 };
 
+/*=====================================
+ Class TopicIdMap
+
+ TopicIds of the messages in flight, by msgId.
+ The slots are sized for the inflight window of the client and allocated once.
+ =====================================*/
 class TopicIdMap
 {
+    friend class Handoff;
 public:
-    TopicIdMap();
+    TopicIdMap(int maxInflight = MAX_INFLIGHTMESSAGES);
     ~TopicIdMap();
     TopicIdMapElement* getElement(uint16_t msgId);
     TopicIdMapElement* add(uint16_t msgId, uint16_t topicId, MQTTSN_topicid* topic);
     void erase(uint16_t msgId);
     void clear(void);
+    int getCount(void);
+    size_t getMemorySize(void);
 private:
-    uint16_t* _msgIds;
-    TopicIdMapElement* _first;
-    TopicIdMapElement* _end;
-    int _cnt;
-    int _maxInflight;
+    MsgIdIndex<TopicIdMapElement> _index;
+    int _maxCnt;
 };
 
 }
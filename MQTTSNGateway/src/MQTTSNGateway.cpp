@@ -20,7 +20,21 @@
 #include "MQTTSNGWVersion.h"
 #include "MQTTSNGWQoSm1Proxy.h"
 #include "MQTTSNGWClient.h"
+#include "MQTTSNGWAggregater.h"
+#include "MQTTSNGWPacketHandleTask.h"
+#include "MQTTSNGWClientRecvTask.h"
+#include "MQTTSNGWClientSendTask.h"
+#include "MQTTSNGWBrokerRecvTask.h"
+#include "MQTTSNGWBrokerSendTask.h"
+#include "MQTTSNGWReactor.h"
+#include "MQTTSNGWHandoff.h"
+#include "MQTTSNGWBufferArena.h"
 #include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <new>
+#include <cassert>
 using namespace MQTTSNGW;
 
 char* currentDateTime(void);
@@ -38,6 +52,11 @@ Gateway::Gateway(void)
     _clientList = new ClientList(this);
     _adapterManager = new AdapterManager(this);
     _topics = new Topics();
+    for (int i = 0; i < MAX_PACKET_HANDLE_TASKS; i++)
+    {
+        _packetHandleTasks[i] = nullptr;
+    }
+    _handoff = nullptr;
     _stopFlg = false;
 }
 
@@ -111,6 +130,10 @@ Gateway::~Gateway()
     {
         free(_params.gwPrivatekey);
     }
+    if (_params.handoffSocket)
+    {
+        free(_params.handoffSocket);
+    }
 
     if (_adapterManager)
     {
@@ -124,11 +147,17 @@ Gateway::~Gateway()
     {
         delete _topics;
     }
-}
-
-int Gateway::getParam(const char* parameter, char* value)
-{
-    return MultiTaskProcess::getParam(parameter, value);
+    if (_handoff)
+    {
+        delete _handoff;
+    }
+    for (int i = 0; i < MAX_PACKET_HANDLE_TASKS; i++)
+    {
+        if (_packetHandleTasks[i])
+        {
+            delete _packetHandleTasks[i];
+        }
+    }
 }
 
 char* Gateway::getClientListFileName(void)
@@ -192,10 +221,7 @@ void Gateway::initialize(int argc, char** argv)
         _params.gwPrivatekey = strdup(param);
     }
 
-    if (getParam("GatewayID", param) == 0)
-    {
-        _params.gatewayId = atoi(param);
-    }
+    _params.gatewayId = getIntParam("GatewayID", 0);
 
     if (_params.gatewayId == 0 || _params.gatewayId > 255)
     {
@@ -212,23 +238,9 @@ void Gateway::initialize(int argc, char** argv)
         throw Exception("Gateway::initialize: Gateway Name is missing.", 0);
     }
 
-    _params.mqttVersion = DEFAULT_MQTT_VERSION;
-    if (getParam("MQTTVersion", param) == 0)
-    {
-        _params.mqttVersion = atoi(param);
-    }
-
-    _params.maxInflightMsgs = MAX_INFLIGHTMESSAGES;
-    if (getParam("MaxInflightMsgs", param) == 0)
-    {
-        _params.maxInflightMsgs = atoi(param);
-    }
-
-    _params.keepAlive = DEFAULT_KEEP_ALIVE_TIME;
-    if (getParam("KeepAlive", param) == 0)
-    {
-        _params.keepAlive = atoi(param);
-    }
+    _params.mqttVersion = getIntParam("MQTTVersion", DEFAULT_MQTT_VERSION);
+    _params.maxInflightMsgs = getIntParam("MaxInflightMsgs", MAX_INFLIGHTMESSAGES);
+    _params.keepAlive.store(getIntParam("KeepAlive", DEFAULT_KEEP_ALIVE_TIME), std::memory_order_relaxed);
 
     if (getParam("LoginID", param) == 0)
     {
@@ -240,77 +252,78 @@ void Gateway::initialize(int argc, char** argv)
         _params.password = strdup(param);
     }
 
-    if (getParam("ClientAuthentication", param) == 0)
-    {
-        if (!strcasecmp(param, "YES"))
-        {
-            _params.clientAuthentication = true;
-        }
-    }
+    _params.clientAuthentication = getBoolParam("ClientAuthentication", false);
 
     if (getParam("ClientsList", param) == 0)
     {
         _params.clientListName = strdup(param);
     }
 
-    if (getParam("PredefinedTopic", param) == 0)
+    _params.predefinedTopic = getBoolParam("PredefinedTopic", false);
+    if (_params.predefinedTopic && getParam("PredefinedTopicList", param) == 0)
     {
-        if (!strcasecmp(param, "YES"))
-        {
-            _params.predefinedTopic = true;
-            if (getParam("PredefinedTopicList", param) == 0)
-            {
-                _params.predefinedTopicFileName = strdup(param);
-            }
-        }
+        _params.predefinedTopicFileName = strdup(param);
     }
 
-    if (getParam("AggregatingGateway", param) == 0)
-    {
-        if (!strcasecmp(param, "YES"))
-        {
-            _params.aggregatingGw = true;
-        }
-    }
+    _params.aggregatingGw = getBoolParam("AggregatingGateway", false);
+    _params.forwarder = getBoolParam("Forwarder", false);
+    _params.qosMinus1 = getBoolParam("QoS-1", false);
+    _params.maxClients = getIntParam("MaxNumberOfClients", MAX_CLIENTS);
 
-    if (getParam("Forwarder", param) == 0)
+    if (getParam("RFCOMMAddress", param) == 0)
     {
-        if (!strcasecmp(param, "YES"))
-        {
-            _params.forwarder = true;
-        }
+        _params.rfcommAddr = strdup(param);
     }
 
-    if (getParam("QoS-1", param) == 0)
+    _params.packetHandleTasks = getIntParam("PacketHandleTasks", 1);
+    if (_params.packetHandleTasks < 1 || _params.packetHandleTasks > MAX_PACKET_HANDLE_TASKS)
     {
-        if (!strcasecmp(param, "YES"))
-        {
-            _params.qosMinus1 = true;
-        }
+        throw Exception("Gateway::initialize: invalid number of PacketHandleTasks", 0);
     }
 
-    _params.maxClients = MAX_CLIENTS;
-    if (getParam("MaxNumberOfClients", param) == 0)
+    _params.reactorMode = getBoolParam("ReactorMode", false);
+    if (_params.reactorMode && _params.packetHandleTasks > 1)
     {
-        _params.maxClients = atoi(param);
+        throw Exception("Gateway::initialize: ReactorMode runs only one PacketHandleTask", 0);
     }
 
-    if (getParam("RFCOMMAddress", param) == 0)
+    /*  Setup PacketEventQues and the PacketHandleTasks in addition to the first one */
+    _packetEventQue.initialize(this, _params.packetHandleTasks, _params.maxInflightMsgs * _params.maxClients);
+    for (int i = 1; i < _params.packetHandleTasks; i++)
     {
-        _params.rfcommAddr = strdup(param);
+        _packetHandleTasks[i] = new PacketHandleTask(this, i);
     }
 
-    /*  Setup max PacketEventQue size  */
-    _packetEventQue.setMaxSize(_params.maxInflightMsgs * _params.maxClients);
-
     /*  Initialize adapters */
     _adapterManager->initialize(_params.gatewayName, _params.aggregatingGw, _params.forwarder, _params.qosMinus1);
 
     /*  Setup ClientList and Predefined topics  */
     _clientList->initialize(_params.aggregatingGw);
 
+    /*  Take over the sockets and the sessions from the running gateway */
+    if (getParam("HandoffSocket", param) == 0)
+    {
+        _params.handoffSocket = strdup(param);
+        _handoff = new Handoff(this);
+        _handoff->initialize(_params.handoffSocket);
+        if (_handoff->receive())
+        {
+            int fds[HANDOFF_MAX_FDS];
+            int cnt = _handoff->getSensorFds(fds, HANDOFF_MAX_FDS);
+            if (_sensorNetwork.setPollFds(fds, cnt) != cnt)
+            {
+                throw Exception("Gateway::initialize: SensorNetwork can't take over the sockets", 0);
+            }
+        }
+    }
+
     /*  SensorNetwork initialize */
     _sensorNetwork.initialize();
+
+    if (_handoff && !_params.reactorMode)
+    {
+        _handoff->listen();
+    }
 }
 
 void Gateway::run(void)
@@ -346,40 +359,161 @@ void Gateway::run(void)
     WRITELOG(" DtlsCertsKey: %s\n", _params.gwCertskey);
     WRITELOG(" DtlsPrivKey : %s\n", _params.gwPrivatekey);
 #endif
-    WRITELOG(" Max Clients : %d\n\n", _params.maxClients);
+    WRITELOG(" Max Clients : %d  (%u KB in use)\n", _params.maxClients,
+            (unsigned int) ((_clientList->getMemorySize() + TopicNameTable::getInstance()->getMemorySize()) / 1024));
+    WRITELOG(" PacketTasks : %d\n", _params.packetHandleTasks);
+    WRITELOG(" ReactorMode : %s\n\n", _params.reactorMode ? "YES" : "NO");
     WRITELOG("%s %s starts running.\n\n", currentDateTime(), _params.gatewayName);
 
     _stopFlg = false;
 
-    /* Run Tasks until CTRL+C entered or Exception occurred */
-    MultiTaskProcess::run();
+    if (_params.reactorMode)
+    {
+        /* Run all Tasks in this thread until CTRL+C entered or Exception occurred */
+        Reactor reactor(this);
+        reactor.initialize();
+        reactor.run();
+        _stopFlg = true;
+
+        WRITELOG("\n%s MQTT-SN Gateway  stopped.\n\n", currentDateTime());
+        _lightIndicator.allLightOff();
+        return;
+    }
+
+    bool handingOff = false;
+
+    if (_handoff)
+    {
+        /* Run Tasks until CTRL+C entered, Exception occurred or the next process takes over */
+        MultiTaskProcess::startThreads();
+        while (!CHK_SIGINT)
+        {
+            if (checkReload())
+            {
+                reload();
+            }
+            if (_handoff->accept(1000))
+            {
+                handingOff = true;
+                MultiTaskProcess::abort();   // stop Tasks as CTRL+C does
+            }
+        }
+    }
+    else
+    {
+        /* Run Tasks until CTRL+C entered or Exception occurred */
+        MultiTaskProcess::run();
+    }
     WRITELOG("\n");
     _stopFlg = true;
+    stopTasks();
 
-    /* stop Tasks */
-    Event* ev = new Event();
-    ev->setStop();
-    _packetEventQue.post(ev);
-    ev = new Event();
-    ev->setStop();
-    _brokerSendQue.post(ev);
-    ev = new Event();
-    ev->setStop();
-    _clientSendQue.post(ev);
-
-    /* wait until all Task stop */
-    MultiTaskProcess::waitStop();
+    /* pass the sockets and the sessions to the next process */
+    if (handingOff)
+    {
+        _handoff->send();
+    }
 
     WRITELOG("\n%s MQTT-SN Gateway  stopped.\n\n", currentDateTime());
     _lightIndicator.allLightOff();
 }
 
+/*
+ *  Applies the parameters of the reloaded config file which can be changed while running.
+ *  KeepAlive is advertised from the next ADVERTISE, and clients added to the ClientsList are accepted.
+ *  A client whose address is changed in the ClientsList is moved to the new address.
+ *  Clients removed from the ClientsList are not removed, they are accepted until the restart.
+ *  Other parameters, e.g. sizes of the pools and ques, the SensorNetwork and the broker, need a restart.
+ */
+void Gateway::reload(void)
+{
+    MultiTaskProcess::reload();
+
+    _params.keepAlive.store(getIntParam("KeepAlive", DEFAULT_KEEP_ALIVE_TIME), std::memory_order_relaxed);
+
+    if (_params.clientAuthentication)
+    {
+        int type = _params.aggregatingGw ? AGGREGATER_TYPE : TRANSPEARENT_TYPE;
+        if (!_clientList->createList(_params.clientListName, type))
+        {
+            WRITELOG("%s Gateway::reload can't read the ClientsList %s.%s\n", ERRMSG_HEADER, _params.clientListName,
+                    ERRMSG_FOOTER);
+        }
+    }
+    WRITELOG(" KeepAlive   : %d\n ClientList  : %d clients\n", _params.keepAlive.load(std::memory_order_relaxed), _clientList->getClientCount());
+
+    BufferArenaStats stats;
+    BufferArena::getStats(&stats);
+    uint64_t inUse = 0;
+    for (int i = 0; i <= ARENA_CLASSES; i++)
+    {
+        inUse += stats.inUseCnt[i];
+    }
+    WRITELOG(" Buffers     : %u KB in slabs, %llu in use, %llu allocated from the heap\n",
+            (unsigned int) (BufferArena::getMemorySize() / 1024), (unsigned long long) inUse,
+            (unsigned long long) stats.allocCnt[ARENA_CLASSES]);
+}
+
+/*
+ *  Posts a Stop behind the Events in the que. It is posted again if the que was full,
+ *  the producers of the que must be stopped.
+ */
+static void postStop(EventQue* que)
+{
+    while (true)
+    {
+        uint32_t drops = que->getDropCount(EpControl);
+        Event* ev = new Event();
+        ev->setStop();
+        que->post(ev);
+        if (que->getDropCount(EpControl) == drops)
+        {
+            return;
+        }
+        usleep(EVENTQUE_BACKOFF_USEC);
+    }
+}
+
+/*
+ *  Stops the tasks in the order the packets flow through them, so that no Event is queued behind a Stop.
+ *  The receiving tasks stop on SIGINT, the PacketHandleTasks handle the Events they have received,
+ *  then the sending tasks send what the PacketHandleTasks have forwarded.
+ */
+void Gateway::stopTasks(void)
+{
+    for (int i = 0; i < getThreadCount(); i++)
+    {
+        Thread* thread = getThread(i);
+        if (dynamic_cast<ClientRecvTask*>(thread) || dynamic_cast<BrokerRecvTask*>(thread))
+        {
+            thread->stop();
+        }
+    }
+
+    for (int i = 0; i < _packetEventQue.getQueCount(); i++)
+    {
+        postStop(_packetEventQue.getQue(i));
+    }
+    for (int i = 0; i < getThreadCount(); i++)
+    {
+        Thread* thread = getThread(i);
+        if (dynamic_cast<PacketHandleTask*>(thread))
+        {
+            thread->stop();
+        }
+    }
+
+    postStop(&_brokerSendQue);
+    postStop(&_clientSendQue);
+    MultiTaskProcess::waitStop();
+}
+
 bool Gateway::IsStopping(void)
 {
     return _stopFlg;
 }
 
-EventQue* Gateway::getPacketEventQue()
+PacketEventQue* Gateway::getPacketEventQue()
 {
     return &_packetEventQue;
 }
@@ -434,90 +568,463 @@ bool Gateway::hasSecureConnection(void)
  =====================================*/
 EventQue::EventQue()
 {
+    for (int i = 0; i < EVENT_PRIORITIES; i++)
+    {
+        _drops[i].store(0);
+    }
+    allocate(DEFAULT_EVENTQUE_SIZE);
 }
 
 EventQue::~EventQue()
 {
-    _mutex.lock();
-    while (_que.size() > 0)
+    Event* ev;
+    while ((ev = pop()) != nullptr)
     {
-        delete _que.front();
-        _que.pop();
+        delete ev;
     }
-    _mutex.unlock();
+    delete[] _slots;
 }
 
+/*
+ *  Must be called before any thread uses the que.
+ */
 void EventQue::setMaxSize(uint16_t maxSize)
 {
-    _que.setMaxSize((int) maxSize);
+    allocate(maxSize ? maxSize : DEFAULT_EVENTQUE_SIZE);
+}
+
+void EventQue::allocate(uint32_t capacity)
+{
+    if (_slots)
+    {
+        Event* ev;
+        while ((ev = pop()) != nullptr)
+        {
+            delete ev;
+        }
+        delete[] _slots;
+    }
+
+    uint32_t size = 2;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    _slots = new EventSlot[size];
+    for (uint32_t i = 0; i < size; i++)
+    {
+        _slots[i].seq.store(i, std::memory_order_relaxed);
+        _slots[i].event = nullptr;
+    }
+    _mask = size - 1;
+    _maxSize = capacity;
+    _limits[EpControl] = capacity;
+    _limits[EpQoS12] = capacity * EVENTQUE_QOS12_LIMIT / 100 ? capacity * EVENTQUE_QOS12_LIMIT / 100 : 1;
+    _limits[EpQoS0] = capacity * EVENTQUE_QOS0_LIMIT / 100 ? capacity * EVENTQUE_QOS0_LIMIT / 100 : 1;
+    _head = 0;
+    _tail.store(0);
+    _cnt.store(0);
+}
+
+Event* EventQue::pop(void)
+{
+    EventSlot* slot = &_slots[_head & _mask];
+    if ((int32_t) (slot->seq.load(std::memory_order_acquire) - (_head + 1)) < 0)
+    {
+        return nullptr;   // empty or the producer has not finished the slot yet
+    }
+    Event* ev = slot->event;
+    slot->seq.store(_head + _mask + 1, std::memory_order_release);
+    _head++;
+    _cnt.fetch_sub(1, std::memory_order_relaxed);
+    return ev;
 }
 
 Event* EventQue::wait(void)
 {
-    Event* ev = nullptr;
+    Event* ev;
 
-    while (ev == nullptr)
+    while ((ev = pop()) == nullptr)
     {
-        if (_que.size() == 0)
+        _idle.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((ev = pop()) != nullptr)
         {
-            _sem.wait();
+            _idle.store(0);
+            break;
         }
-        _mutex.lock();
-        ev = _que.front();
-        _que.pop();
-        _mutex.unlock();
+        _idle.wait(1);
+        _idle.store(0);
     }
     return ev;
 }
 
 Event* EventQue::timedwait(uint16_t millsec)
 {
-    Event* ev;
-    if (_que.size() == 0)
+    Event* ev = pop();
+
+    if (ev == nullptr)
     {
-        _sem.timedwait(millsec);
+        _idle.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((ev = pop()) == nullptr)
+        {
+            _idle.wait(1, millsec);
+            ev = pop();
+        }
+        _idle.store(0);
     }
-    _mutex.lock();
 
-    if (_que.size() == 0)
+    if (ev == nullptr)
     {
         ev = new Event();
         ev->setTimeout();
     }
-    else
-    {
-        ev = _que.front();
-        _que.pop();
-    }
-    _mutex.unlock();
     return ev;
 }
 
 void EventQue::post(Event* ev)
 {
-    if (ev)
+    if (ev == nullptr)
+    {
+        return;
+    }
+
+    EventPriority priority = ev->getPriority();
+    if (_cnt.fetch_add(1, std::memory_order_relaxed) >= _limits[priority])
+    {
+        _cnt.fetch_sub(1, std::memory_order_relaxed);
+        delete ev;
+
+        /* log at 1, 2, 4, 8 ... drops not to flood the log */
+        uint32_t drops = ++_drops[priority];
+        if (_dropLog && (drops & (drops - 1)) == 0)
+        {
+            const char* names[EVENT_PRIORITIES] = { "control", "QoS1/2", "QoS0/-1" };
+            WRITELOG("%s EventQue is full. %u %s events have been dropped.%s\n", ERRMSG_HEADER, drops, names[priority], ERRMSG_FOOTER);
+        }
+        return;
+    }
+
+    /* claim a slot, _cnt guarantees that one is free */
+    uint32_t pos = _tail.load(std::memory_order_relaxed);
+    EventSlot* slot;
+    while (true)
     {
-        _mutex.lock();
-        if (_que.post(ev))
+        slot = &_slots[pos & _mask];
+        int32_t dif = (int32_t) (slot->seq.load(std::memory_order_acquire) - pos);
+        if (dif == 0)
         {
-            _sem.post();
+            if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
         }
         else
         {
-            delete ev;
+            pos = _tail.load(std::memory_order_relaxed);
         }
-        _mutex.unlock();
+    }
+    slot->event = ev;
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    /* wake up the consumer only when it sleeps */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_idle.load() == 1 && _idle.exchange(0) == 1)
+    {
+        _idle.wake();
     }
 }
 
 int EventQue::size()
 {
-    _mutex.lock();
-    int sz = _que.size();
-    _mutex.unlock();
+    return _cnt.load(std::memory_order_relaxed);
+}
+
+/*
+ *  true when the lowest priority Events are being dropped.
+ */
+bool EventQue::isCongested(void)
+{
+    return size() >= _limits[EpQoS0];
+}
+
+uint32_t EventQue::getDropCount(EventPriority priority)
+{
+    return _drops[priority].load();
+}
+
+/*
+ *  Drops are still counted when they are not logged.
+ */
+void EventQue::setDropLog(bool enable)
+{
+    _dropLog = enable;
+}
+
+/*=====================================
+ Class PacketEventQue
+ =====================================*/
+PacketEventQue::PacketEventQue()
+{
+
+}
+
+PacketEventQue::~PacketEventQue()
+{
+    if (_ques)
+    {
+        delete[] _ques;
+    }
+}
+
+void PacketEventQue::initialize(Gateway* gateway, int queCnt, int maxSize)
+{
+    _gateway = gateway;
+    _queCnt = queCnt;
+    _ques = new EventQue[queCnt];
+    for (int i = 0; i < queCnt; i++)
+    {
+        _ques[i].setMaxSize((maxSize + queCnt - 1) / queCnt);
+    }
+}
+
+EventQue* PacketEventQue::getQue(int index)
+{
+    return &_ques[index];
+}
+
+int PacketEventQue::getQueCount(void)
+{
+    return _queCnt;
+}
+
+int PacketEventQue::size(void)
+{
+    int sz = 0;
+    for (int i = 0; i < _queCnt; i++)
+    {
+        sz += _ques[i].size();
+    }
     return sz;
 }
 
+bool PacketEventQue::isCongested(void)
+{
+    for (int i = 0; i < _queCnt; i++)
+    {
+        if (_ques[i].isCongested())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t PacketEventQue::getDropCount(EventPriority priority)
+{
+    uint32_t cnt = 0;
+    for (int i = 0; i < _queCnt; i++)
+    {
+        cnt += _ques[i].getDropCount(priority);
+    }
+    return cnt;
+}
+
+void PacketEventQue::post(Event* ev)
+{
+    if (ev)
+    {
+        _ques[getQueIndex(ev)].post(ev);
+    }
+}
+
+/*
+ *  Acks from the broker to the Aggregater are handled by the task of the client which sent the original packet.
+ */
+int PacketEventQue::getQueIndex(Event* ev)
+{
+    Client* client = ev->getClient();
+
+    if (_queCnt == 1 || client == nullptr)
+    {
+        return 0;
+    }
+
+    if (ev->getEventType() == EtBrokerRecv && client->isAggregater())
+    {
+        switch (ev->getMQTTGWPacket()->getType())
+        {
+        case PUBACK:
+        case PUBREC:
+        case PUBCOMP:
+        case SUBACK:
+        case UNSUBACK:
+        {
+            Client* owner = _gateway->getAdapterManager()->getAggregater()->findClient(ev->getMQTTGWPacket()->getMsgId());
+            if (owner != nullptr)
+            {
+                client = owner;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return getQueIndex(client);
+}
+
+/*
+ *  Index of the que which handles the Events of the client.
+ *  The Aggregater and the QoS-1 proxy belong to the first task, which runs their timers.
+ */
+int PacketEventQue::getQueIndex(Client* client)
+{
+    if (_queCnt == 1 || client == nullptr || client->isAdapter())
+    {
+        return 0;
+    }
+    uint32_t hash = (uint32_t) (((uintptr_t) client >> 3) * 2654435761U);
+    return (hash >> 16) % _queCnt;
+}
+
+/*=====================================
+ Class EventPool
+ =====================================*/
+#define EVENT_BLOCK_HEAP 0xFFFFFFFF
+
+struct EventBlock
+{
+    uint32_t index;                  // EVENT_BLOCK_HEAP for blocks out of the slabs
+    std::atomic<uint32_t> next;      // index + 1 of the next free block, 0 terminates
+    union
+    {
+        char body[sizeof(Event)];
+        long double align;
+    };
+};
+
+static_assert(sizeof(Event) <= sizeof(((EventBlock*) nullptr)->body), "Event doesn't fit in a block of the EventPool");
+
+static EventBlock* theEventSlabs[EVENT_POOL_MAX_SLABS];
+static std::atomic<uint32_t> theEventSlabCnt { 0 };
+static std::atomic<uint64_t> theEventFreeList { 0 };   // ABA tag << 32 | index + 1
+static std::atomic<uint32_t> theEventHeapAllocs { 0 };
+static std::atomic<uint32_t> theEventInUse { 0 };
+static Mutex theEventPoolMutex;
+
+static EventBlock* getEventBlock(uint32_t index)
+{
+    return &theEventSlabs[index / EVENT_POOL_SLAB_SIZE][index % EVENT_POOL_SLAB_SIZE];
+}
+
+void* EventPool::allocate(size_t size)
+{
+    assert(size <= sizeof(Event));    // a class derived from Event doesn't fit in a block
+    (void) size;
+    theEventInUse++;
+    void* ptr = pop();
+    if (ptr == nullptr)
+    {
+        ptr = grow();
+    }
+    return ptr;
+}
+
+void EventPool::release(void* ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+    theEventInUse--;
+    EventBlock* block = (EventBlock*) ((char*) ptr - offsetof(EventBlock, body));
+    if (block->index == EVENT_BLOCK_HEAP)
+    {
+        free(block);
+    }
+    else
+    {
+        push(block->index);
+    }
+}
+
+void* EventPool::pop(void)
+{
+    uint64_t head = theEventFreeList.load(std::memory_order_acquire);
+    while ((uint32_t) head)
+    {
+        EventBlock* block = getEventBlock((uint32_t) head - 1);
+        uint64_t next = ((head >> 32) + 1) << 32 | block->next.load(std::memory_order_relaxed);
+        if (theEventFreeList.compare_exchange_weak(head, next, std::memory_order_acquire))
+        {
+            return block->body;
+        }
+    }
+    return nullptr;
+}
+
+void EventPool::push(uint32_t index)
+{
+    EventBlock* block = getEventBlock(index);
+    uint64_t head = theEventFreeList.load(std::memory_order_relaxed);
+    uint64_t next;
+    do
+    {
+        block->next.store((uint32_t) head, std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | (index + 1);
+    } while (!theEventFreeList.compare_exchange_weak(head, next, std::memory_order_release));
+}
+
+/*
+ *  Adds a slab to the pool and returns its first block.
+ *  When all slabs are used, the Event is allocated from the heap.
+ */
+void* EventPool::grow(void)
+{
+    theEventHeapAllocs++;
+    theEventPoolMutex.lock();
+    uint32_t slab = theEventSlabCnt.load();
+    if (slab >= EVENT_POOL_MAX_SLABS)
+    {
+        theEventPoolMutex.unlock();
+        EventBlock* block = (EventBlock*) malloc(sizeof(EventBlock));
+        if (block == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        block->index = EVENT_BLOCK_HEAP;
+        return block->body;
+    }
+
+    EventBlock* blocks = new EventBlock[EVENT_POOL_SLAB_SIZE];
+    theEventSlabs[slab] = blocks;
+    theEventSlabCnt.store(slab + 1);
+    theEventPoolMutex.unlock();
+
+    uint32_t base = slab * EVENT_POOL_SLAB_SIZE;
+    for (uint32_t i = 0; i < EVENT_POOL_SLAB_SIZE; i++)
+    {
+        blocks[i].index = base + i;
+    }
+    for (uint32_t i = 1; i < EVENT_POOL_SLAB_SIZE; i++)
+    {
+        push(base + i);
+    }
+    return blocks[0].body;
+}
+
+uint32_t EventPool::getHeapAllocCount(void)
+{
+    return theEventHeapAllocs.load();
+}
+
+uint32_t EventPool::getInUseCount(void)
+{
+    return theEventInUse.load();
+}
+
 /*=====================================
  Class Event
  =====================================*/
@@ -526,6 +1033,16 @@ Event::Event()
 
 }
 
+void* Event::operator new(size_t size)
+{
+    return EventPool::allocate(size);
+}
+
+void Event::operator delete(void* ptr)
+{
+    EventPool::release(ptr);
+}
+
 Event::~Event()
 {
     if (_sensorNetAddr)
@@ -549,6 +1066,30 @@ EventType Event::getEventType()
     return _eventType;
 }
 
+EventPriority Event::getPriority(void)
+{
+    int qos = -1;
+
+    if (_mqttSNPacket && _mqttSNPacket->getType() == MQTTSN_PUBLISH)
+    {
+        qos = _mqttSNPacket->getQoS();
+    }
+    else if (_mqttGWPacket && _mqttGWPacket->getType() == PUBLISH)
+    {
+        qos = _mqttGWPacket->getQoS();
+    }
+
+    if (qos == 1 || qos == 2)
+    {
+        return EpQoS12;
+    }
+    else if (qos == 0 || qos == 3)
+    {
+        return EpQoS0;
+    }
+    return EpControl;
+}
+
 void Event::setClientSendEvent(Client* client, MQTTSNPacket* packet)
 {
     _client = client;
@@ -90,12 +90,46 @@ enum EventType
     EtSensornetSend
 };
 
+/*
+ *  When an EventQue is filling up, PUBLISH of lower QoS are dropped first.
+ */
+enum EventPriority
+{
+    EpControl = 0,      // session control, acks and gateway internal events
+    EpQoS12,            // QoS1 and QoS2 PUBLISH
+    EpQoS0              // QoS0 and QoS-1 PUBLISH
+};
+#define EVENT_PRIORITIES 3
+
+/*=====================================
+ Class EventPool
+
+ Lock-free free list of Event blocks carved out of slabs.
+ Slabs are never released, the pool is warmed up by the first burst of traffic.
+ ====================================*/
+class EventPool
+{
+public:
+    static void* allocate(size_t size);
+    static void release(void* ptr);
+    static uint32_t getHeapAllocCount(void);
+    static uint32_t getInUseCount(void);
+
+private:
+    static void* pop(void);
+    static void push(uint32_t index);
+    static void* grow(void);
+};
+
 class Event
 {
 public:
     Event();
     ~Event();
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
     EventType getEventType(void);
+    EventPriority getPriority(void);
     void setClientRecvEvent(Client*, MQTTSNPacket*);
     void setClientSendEvent(Client*, MQTTSNPacket*);
     void setBrokerRecvEvent(Client*, MQTTGWPacket*);
@@ -119,7 +153,16 @@ private:
 
 /*=====================================
  Class EventQue
+
+ Bounded ring buffer of Events.
+ Any thread can post, only one thread may wait or pop.
  ====================================*/
+struct EventSlot
+{
+    std::atomic<uint32_t> seq;
+    Event* event;
+};
+
 class EventQue
 {
 public:
@@ -127,14 +170,57 @@ public:
     ~EventQue();
     Event* wait(void);
     Event* timedwait(uint16_t millsec);
+    Event* pop(void);
     void setMaxSize(uint16_t maxSize);
     void post(Event*);
     int size();
+    bool isCongested(void);
+    uint32_t getDropCount(EventPriority priority);
+    void setDropLog(bool enable);
+
+private:
+    void allocate(uint32_t capacity);
+
+    EventSlot* _slots { nullptr };
+    uint32_t _mask { 0 };
+    int _maxSize { 0 };
+    int _limits[EVENT_PRIORITIES];        // max size for each EventPriority
+    uint32_t _head { 0 };                 // consumer only
+    char _pad[64];                        // keep the producers' cache line away from the consumer's
+    std::atomic<uint32_t> _tail { 0 };
+    std::atomic<int> _cnt { 0 };
+    std::atomic<uint32_t> _drops[EVENT_PRIORITIES];
+    bool _dropLog { true };
+    Futex _idle;                          // 1 while the consumer sleeps
+};
+
+/*=====================================
+ Class PacketEventQue
+
+ One EventQue per PacketHandleTask.
+ Events are routed by their Client, so that packets of a client are handled in order by one task.
+ ====================================*/
+class Gateway;
+
+class PacketEventQue
+{
+public:
+    PacketEventQue();
+    ~PacketEventQue();
+    void initialize(Gateway* gateway, int queCnt, int maxSize);
+    void post(Event* ev);
+    EventQue* getQue(int index);
+    int getQueCount(void);
+    int size(void);
+    bool isCongested(void);
+    uint32_t getDropCount(EventPriority priority);
+    int getQueIndex(Client* client);
 
 private:
-    Que<Event> _que;
-    Mutex _mutex;
-    Semaphore _sem;
+    int getQueIndex(Event* ev);
+    Gateway* _gateway { nullptr };
+    EventQue* _ques { nullptr };
+    int _queCnt { 0 };
 };
 
 /*=====================================
@@ -148,7 +234,7 @@ public:
     char* clientListName { nullptr };
     char* loginId { nullptr };
     char* password { nullptr };
-    uint16_t keepAlive { 0 };
+    std::atomic<uint16_t> keepAlive { 0 };    // written by reload(), read by the PacketHandleTasks
     uint8_t gatewayId { 0 };
     uint8_t mqttVersion { 0 };
     uint16_t maxInflightMsgs { 0 };
@@ -168,6 +254,9 @@ public:
     bool qosMinus1 { false };
     bool forwarder { false };
     int maxClients {0};
+    int packetHandleTasks { 1 };
+    bool reactorMode { false };
+    char* handoffSocket { nullptr };
     char* rfcommAddr { nullptr };
     char* gwCertskey { nullptr };
     char* gwPrivatekey { nullptr };
@@ -179,6 +268,8 @@ public:
 class AdapterManager;
 class ClientList;
 class ClientsPool;
+class PacketHandleTask;
+class Handoff;
 
 class Gateway: public MultiTaskProcess
 {
@@ -187,8 +278,9 @@ public:
     ~Gateway();
     virtual void initialize(int argc, char** argv);
     void run(void);
+    void reload(void);
 
-    EventQue* getPacketEventQue(void);
+    PacketEventQue* getPacketEventQue(void);
     EventQue* getClientSendQue(void);
     EventQue* getBrokerSendQue(void);
     ClientList* getClientList(void);
@@ -196,7 +288,6 @@ public:
     LightIndicator* getLightIndicator(void);
     GatewayParams* getGWParams(void);
     AdapterManager* getAdapterManager(void);
-    int getParam(const char* parameter, char* value);
     char* getClientListFileName(void);
     char* getPredefinedTopicFileName(void);
     bool hasSecureConnection(void);
@@ -205,15 +296,19 @@ public:
     void requestSensorNetSubTask(void);
 
 private:
+    void stopTasks(void);
+
     GatewayParams _params;
 	ClientList* _clientList;
-    EventQue _packetEventQue;
+    PacketEventQue _packetEventQue;
     EventQue _brokerSendQue;
     EventQue _clientSendQue;
     LightIndicator _lightIndicator;
     SensorNetwork _sensorNetwork;
 	AdapterManager* _adapterManager;
     Topics* _topics;
+    PacketHandleTask* _packetHandleTasks[MAX_PACKET_HANDLE_TASKS];
+    Handoff* _handoff;
     bool _stopFlg;
 };
 }
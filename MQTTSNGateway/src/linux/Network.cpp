@@ -40,6 +40,7 @@ TCPStack::TCPStack()
 {
 	_addrinfo = 0;
 	_sockfd = 0;
+	_sockMirror = nullptr;
 }
 
 TCPStack::~TCPStack()
@@ -61,7 +62,7 @@ void TCPStack::close()
 	if (_sockfd > 0)
 	{
 		::close(_sockfd);
-		_sockfd = 0;
+		setSock(0);
 		if (_addrinfo)
 		{
 			freeaddrinfo(_addrinfo);
@@ -96,7 +97,7 @@ bool TCPStack::bind(const char* service)
 		return false;
 	}
 
-	_sockfd = socket(_addrinfo->ai_family, _addrinfo->ai_socktype, _addrinfo->ai_protocol);
+	setSock(socket(_addrinfo->ai_family, _addrinfo->ai_socktype, _addrinfo->ai_protocol));
 	if (_sockfd < 0)
 	{
 		return false;
@@ -132,7 +133,7 @@ bool TCPStack::accept(TCPStack& new_socket)
 {
 	sockaddr_storage sa;
 	socklen_t len = sizeof(sa);
-	new_socket._sockfd = ::accept(_sockfd, (struct sockaddr*) &sa, &len);
+	new_socket.setSock(::accept(_sockfd, (struct sockaddr*) &sa, &len));
 	if (new_socket._sockfd <= 0)
 	{
 		return false;
@@ -200,7 +201,20 @@ bool TCPStack::connect(const char* host, const char* service)
 		return false;
 	}
 
-	_sockfd = sockfd;
+	setSock(sockfd);
+	return true;
+}
+
+/*
+ *  Takes over a socket which is already connected, e.g. handed over by another process.
+ */
+bool TCPStack::attach(int sockfd)
+{
+	if (isValid() || sockfd <= 0)
+	{
+		return false;
+	}
+	setSock(sockfd);
 	return true;
 }
 
@@ -231,6 +245,27 @@ int TCPStack::getSock()
 	return _sockfd;
 }
 
+/*
+ *  Copies the socket to *mirror whenever it changes, 0 while it is closed.
+ */
+void TCPStack::setSockMirror(int* mirror)
+{
+	_sockMirror = mirror;
+	if (_sockMirror)
+	{
+		*_sockMirror = _sockfd;
+	}
+}
+
+void TCPStack::setSock(int sockfd)
+{
+	_sockfd = sockfd;
+	if (_sockMirror)
+	{
+		*_sockMirror = sockfd;
+	}
+}
+
 /*========================================
  Class Network
  =======================================*/
@@ -274,6 +309,21 @@ exit:
 	return rc;
 }
 
+/*
+ *  A TLS session can't be taken over, only plain connections can be attached.
+ */
+bool Network::attach(int sockfd)
+{
+	bool rc = false;
+	_mutex.lock();
+	if (!_secureFlg)
+	{
+		rc = TCPStack::attach(sockfd);
+	}
+	_mutex.unlock();
+	return rc;
+}
+
 bool Network::connect(const char* host, const char* port, const char* caPath, const char* caFile, const char* certkey, const char* prvkey)
 {
 	char errmsg[256];
@@ -46,6 +46,7 @@ public:
 
 	// Client initialization
 	bool connect(const char* host, const char* service);
+	bool attach(int sockfd);
 
 	int send(const uint8_t* buf, int length);
 	int recv(uint8_t* buf, int len);
@@ -55,9 +56,13 @@ public:
 
 	bool isValid();
 	int getSock();
+	void setSockMirror(int* mirror);
 
 private:
+	void setSock(int sockfd);
+
 	int _sockfd;
+	int* _sockMirror;
 	addrinfo* _addrinfo;
 	Mutex _mutex;
 };
@@ -73,6 +78,7 @@ public:
 
 	bool connect(const char* host, const char* port, const char* caPath, const char* caFile, const char* cert, const char* prvkey);
 	bool connect(const char* host, const char* port);
+	bool attach(int sockfd);
 	void close(void);
 	int  send(const uint8_t* buf, uint16_t length);
 	int  recv(uint8_t* buf, uint16_t len);
@@ -26,6 +26,10 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <errno.h>
+#ifndef __APPLE__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 using namespace std;
 using namespace MQTTSNGW;
@@ -209,6 +213,67 @@ void Semaphore::timedwait(uint16_t millsec)
 #endif
 }
 
+/*=====================================
+ Class Futex
+ =====================================*/
+Futex::Futex(int val)
+{
+	_word.store(val);
+#ifdef __APPLE__
+	_sem = dispatch_semaphore_create(0);
+#endif
+}
+
+Futex::~Futex()
+{
+#ifdef __APPLE__
+	dispatch_release(_sem);
+#endif
+}
+
+int Futex::load(void)
+{
+	return _word.load();
+}
+
+void Futex::store(int val)
+{
+	_word.store(val);
+}
+
+int Futex::exchange(int val)
+{
+	return _word.exchange(val);
+}
+
+/*
+ *  Sleeps as long as the word holds the expected value.
+ *  Returns on wake(), on timeout or spuriously, the caller re-checks its condition.
+ */
+void Futex::wait(int expected, uint16_t millsec)
+{
+#ifdef __APPLE__
+	if (_word.load() == expected)
+	{
+		dispatch_semaphore_wait(_sem, millsec ? dispatch_time(DISPATCH_TIME_NOW, int64_t(millsec) * 1000000) : DISPATCH_TIME_FOREVER);
+	}
+#else
+	struct timespec ts;
+	ts.tv_sec = millsec / 1000;
+	ts.tv_nsec = (millsec % 1000) * 1000000;
+	syscall(SYS_futex, reinterpret_cast<int*>(&_word), FUTEX_WAIT_PRIVATE, expected, millsec ? &ts : nullptr, nullptr, 0);
+#endif
+}
+
+void Futex::wake(void)
+{
+#ifdef __APPLE__
+	dispatch_semaphore_signal(_sem);
+#else
+	syscall(SYS_futex, reinterpret_cast<int*>(&_word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#endif
+}
+
 /*=====================================
  Class NamedSemaphore
  =====================================*/
@@ -495,18 +560,97 @@ Thread::Thread()
 {
 	_threadID = 0;
 	_taskName = nullptr;
+	_threadName[0] = 0;
 }
 
 Thread::~Thread()
 {
 }
 
-void* Thread::_run(void* runnable)
+void* Thread::_run(void* thread)
 {
-	static_cast<Runnable*>(runnable)->EXECRUN();
+	static_cast<Thread*>(thread)->setup();
+	static_cast<Thread*>(thread)->EXECRUN();
 	return 0;
 }
 
+/*
+ *  Parses a CPU list such as "0-3,6".
+ */
+#ifndef __APPLE__
+static bool parseCPUs(const char* list, cpu_set_t* cpus)
+{
+	CPU_ZERO(cpus);
+	const char* p = list;
+	while (*p)
+	{
+		char* end;
+		long first = strtol(p, &end, 10);
+		long last = first;
+		if (end == p || first < 0)
+		{
+			return false;
+		}
+		if (*end == '-')
+		{
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p || last < first)
+			{
+				return false;
+			}
+		}
+		for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+		{
+			CPU_SET(cpu, cpus);
+		}
+		p = end;
+		while (*p == ',' || *p == ' ')
+		{
+			p++;
+		}
+	}
+	return CPU_COUNT(cpus) > 0;
+}
+#endif
+
+/*
+ *  Runs on the new thread before the task starts.
+ *  Sets the OS-visible thread name, the one given by setThreadName() or the task name cut to 15 chars,
+ *  and pins the thread to the CPUs given by "<TaskName>CPUs" parameter.
+ */
+void Thread::setup(void)
+{
+	if (_taskName == nullptr)
+	{
+		return;
+	}
+
+	char name[16];
+	strncpy(name, _threadName[0] ? _threadName : _taskName, sizeof(name) - 1);
+	name[sizeof(name) - 1] = 0;
+#ifdef __APPLE__
+	pthread_setname_np(name);
+#else
+	pthread_setname_np(pthread_self(), name);
+
+	char param[MQTTSNGW_PARAM_MAX];
+	string key = string(_taskName) + "CPUs";
+	if (theMultiTaskProcess && theMultiTaskProcess->getParam(key.c_str(), param) == 0)
+	{
+		cpu_set_t cpus;
+		if (!parseCPUs(param, &cpus))
+		{
+			WRITELOG("%s%s: invalid CPU list %s%s\n", RED_HDR, key.c_str(), param, CLR_HDR);
+		}
+		else if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus) != 0)
+		{
+			WRITELOG("%s%s can't be pinned to CPUs %s%s\n", RED_HDR, _taskName, param, CLR_HDR);
+		}
+	}
+#endif
+}
+
 void Thread::initialize(int argc, char** argv)
 {
 
@@ -524,8 +668,7 @@ bool Thread::equals(pthread_t *t1, pthread_t *t2)
 
 int Thread::start(void)
 {
-    Runnable* runnable = this;
-	return pthread_create(&_threadID, 0, _run, runnable);
+	return pthread_create(&_threadID, 0, _run, this);
 }
 
 void Thread::stop(void)
@@ -542,6 +685,15 @@ void Thread::setTaskName(const char* name)
     _taskName = name;
 }
 
+/*
+ *  Sets the OS-visible name of the thread, up to 15 chars.
+ */
+void Thread::setThreadName(const char* name)
+{
+	strncpy(_threadName, name, sizeof(_threadName) - 1);
+	_threadName[sizeof(_threadName) - 1] = 0;
+}
+
 const char* Thread::getTaskName(void)
 {
     return _taskName;
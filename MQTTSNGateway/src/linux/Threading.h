@@ -19,6 +19,7 @@
 
 #include <pthread.h>
 #include <semaphore.h>
+#include <atomic>
 #ifdef __APPLE__
 #include <dispatch/dispatch.h>
 #endif
@@ -72,6 +73,27 @@ private:
 #endif
 };
 
+/*=====================================
+         Class Futex
+  ====================================*/
+class Futex
+{
+public:
+	Futex(int val = 0);
+	~Futex();
+	int load(void);
+	void store(int val);
+	int exchange(int val);
+	void wait(int expected, uint16_t millsec = 0);  // 0: no timeout
+	void wake(void);
+
+private:
+	std::atomic<int> _word;
+#ifdef __APPLE__
+	dispatch_semaphore_t _sem;
+#endif
+};
+
 /*=====================================
          Class NamedSemaphore
   ====================================*/
@@ -154,11 +176,14 @@ public:
 	void stop(void);
 	const char* getTaskName(void);
 	void setTaskName(const char* name);
+	void setThreadName(const char* name);
 	void abort(int threadNo);
 private:
 	static void* _run(void*);
+	void setup(void);
 	pthread_t _threadID;
 	const char* _taskName;
+	char _threadName[16];
 };
 
 }
@@ -26,25 +26,59 @@
 using namespace std;
 using namespace MQTTSNGW;
 
+#ifdef CLOCK_MONOTONIC_COARSE
+#define GW_CLOCK_MONOTONIC   CLOCK_MONOTONIC_COARSE
+#define GW_CLOCK_REALTIME    CLOCK_REALTIME_COARSE
+#else
+#define GW_CLOCK_MONOTONIC   CLOCK_MONOTONIC
+#define GW_CLOCK_REALTIME    CLOCK_REALTIME
+#endif
+
+/*
+ *  Milliseconds of the coarse monotonic clock.
+ *  It is read from the vDSO without a system call and does not jump when the wall clock is stepped.
+ */
+static uint64_t monotonicMsec(void)
+{
+	struct timespec ts;
+	clock_gettime(GW_CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 /*=====================================
  Print Current Date & Time
  =====================================*/
-char theCurrentTime[32];
+static thread_local char theCurrentTime[32];
+static thread_local time_t theCurrentSecond = -1;
 
+/*
+ *  The date and time part is formatted only when the second changes,
+ *  then milliseconds are appended. Each thread has its own buffer.
+ */
 const char* currentDateTime()
 {
-	struct timeval now;
+	struct timespec now;
 	struct tm tstruct;
-	gettimeofday(&now, 0);
-	tstruct = *localtime(&now.tv_sec);
-	strftime(theCurrentTime, sizeof(theCurrentTime), "%Y%m%d %H%M%S", &tstruct);
-	sprintf(theCurrentTime + 15, ".%03d", (int)now.tv_usec / 1000 );
+	clock_gettime(GW_CLOCK_REALTIME, &now);
+	if (now.tv_sec != theCurrentSecond)
+	{
+		theCurrentSecond = now.tv_sec;
+		localtime_r(&now.tv_sec, &tstruct);
+		strftime(theCurrentTime, sizeof(theCurrentTime), "%Y%m%d %H%M%S", &tstruct);
+	}
+	int msec = now.tv_nsec / 1000000;
+	theCurrentTime[15] = '.';
+	theCurrentTime[16] = '0' + msec / 100;
+	theCurrentTime[17] = '0' + msec / 10 % 10;
+	theCurrentTime[18] = '0' + msec % 10;
+	theCurrentTime[19] = 0;
 	return theCurrentTime;
 }
 
 /*============================================
  Timer
  ============================================*/
+
 Timer::Timer(void)
 {
 	stop();
@@ -57,7 +91,7 @@ Timer::~Timer(void)
 
 void Timer::start(uint32_t msecs)
 {
-	gettimeofday(&_startTime, 0);
+	_startTime = monotonicMsec();
 	_millis = msecs;
 }
 
@@ -68,27 +102,30 @@ bool Timer::isTimeup(void)
 
 bool Timer::isTimeup(uint32_t msecs)
 {
-	struct timeval curTime;
-	long secs, usecs;
-	if (_startTime.tv_sec == 0)
+	if (_startTime == 0)
 	{
 		return false;
 	}
 	else
 	{
-		gettimeofday(&curTime, 0);
-		secs = (curTime.tv_sec - _startTime.tv_sec) * 1000;
-		usecs = (curTime.tv_usec - _startTime.tv_usec) / 1000.0;
-		return ((secs + usecs) > (long) msecs);
+		return (monotonicMsec() - _startTime) > msecs;
 	}
 }
 
 void Timer::stop()
 {
-	_startTime.tv_sec = 0;
+	_startTime = 0;
 	_millis = 0;
 }
 
+/*
+ *  Milliseconds of the monotonic clock. It wraps around every 49 days.
+ */
+uint32_t Timer::now(void)
+{
+	return (uint32_t) monotonicMsec();
+}
+
 /*=====================================
 Class LightIndicator
 =====================================*/
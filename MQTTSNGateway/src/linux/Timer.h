@@ -42,9 +42,10 @@ public:
 	bool isTimeup(void);
 	bool isTimeup(uint32_t msecs);
 	void stop();
+	static uint32_t now(void);
 
 private:
-	struct timeval _startTime;
+	uint64_t _startTime;    // msecs of the monotonic clock
 	uint32_t _millis;
 };
 
@@ -211,6 +211,21 @@ bool SensorNetAddress::isMatch(SensorNetAddress *addr)
     return false;
 }
 
+uint32_t SensorNetAddress::hash(void)
+{
+    uint32_t h = 0;
+
+    if (_ipAddr.af == AF_INET6)
+    {
+        h = hashBytes(&_ipAddr.addr.ad6, sizeof(struct in6_addr));
+    }
+    else
+    {
+        h = hashBytes(&_ipAddr.addr.ad4, sizeof(struct in_addr));
+    }
+    return h ^ _portNo ^ ((uint32_t) _ipAddr.af << 16);
+}
+
 SensorNetAddress& SensorNetAddress::operator =(SensorNetAddress &addr)
 {
     this->_portNo = addr._portNo;
@@ -904,6 +919,23 @@ SensorNetAddress* SensorNetwork::getSenderAddress(void)
     return &_senderAddr;
 }
 
+/*
+ *  The single threaded event loop is not supported.
+ *  DTLS sessions are accepted on their own sockets.
+ */
+int SensorNetwork::getPollFds(int* fds, int maxFds)
+{
+    return 0;
+}
+
+/*
+ *  Sockets can't be handed over to another process.
+ */
+int SensorNetwork::setPollFds(int* fds, int cnt)
+{
+    return 0;
+}
+
 int SensorNetwork::openV4(string *ipAddress, uint16_t multiPortNo, uint16_t uniPortNo, uint32_t ttl)
 {
     int optval = 0;
@@ -66,6 +66,7 @@ public:
     void clear(void);
 
     bool isMatch(SensorNetAddress *addr);
+    uint32_t hash(void);
     SensorNetAddress& operator =(SensorNetAddress &addr);
     char* sprint(char *buf);
 private:
@@ -135,6 +136,8 @@ public:
     void initialize(void);
     const char* getDescription(void);
     SensorNetAddress* getSenderAddress(void);
+    int getPollFds(int* fds, int maxFds);
+    int setPollFds(int* fds, int cnt);
     Connections* getConnections(void);
     void close();
 
@@ -79,6 +79,11 @@ bool SensorNetAddress::isMatch(SensorNetAddress* addr)
 	return _devAddr == addr->_devAddr;
 }
 
+uint32_t SensorNetAddress::hash(void)
+{
+	return _devAddr;
+}
+
 SensorNetAddress& SensorNetAddress::operator =(SensorNetAddress& addr)
 {
 	_devAddr =  addr._devAddr;
@@ -163,6 +168,23 @@ SensorNetAddress* SensorNetwork::getSenderAddress(void)
 	return &_clientAddr;
 }
 
+/*
+ *  The single threaded event loop is not supported.
+ *  LoRaLink::unicast waits for the response read by the receiving task.
+ */
+int SensorNetwork::getPollFds(int* fds, int maxFds)
+{
+	return 0;
+}
+
+/*
+ *  Sockets can't be handed over to another process.
+ */
+int SensorNetwork::setPollFds(int* fds, int cnt)
+{
+	return 0;
+}
+
 /*===========================================
               Class  LoRaLink
  ============================================*/
@@ -120,6 +120,11 @@ bool SensorNetAddress::isMatch(SensorNetAddress* addr)
     return ((this->_channel == addr->_channel) && bacmp(&this->_bdAddr, &addr->_bdAddr) == 0);
 }
 
+uint32_t SensorNetAddress::hash(void)
+{
+    return hashBytes(&_bdAddr, sizeof(bdaddr_t)) ^ _channel;
+}
+
 SensorNetAddress& SensorNetAddress::operator =(SensorNetAddress& addr)
 {
     this->_channel = addr._channel;
@@ -307,6 +312,23 @@ SensorNetAddress* SensorNetwork::getSenderAddress(void)
     return &_senderAddr;
 }
 
+/*
+ *  The single threaded event loop is not supported.
+ *  RFCOMM channels are accepted on their own sockets.
+ */
+int SensorNetwork::getPollFds(int* fds, int maxFds)
+{
+    return 0;
+}
+
+/*
+ *  Sockets can't be handed over to another process.
+ */
+int SensorNetwork::setPollFds(int* fds, int cnt)
+{
+	return 0;
+}
+
 /*=========================================
  Class BleStack
  =========================================*/
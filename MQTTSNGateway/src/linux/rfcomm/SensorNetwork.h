@@ -41,6 +41,7 @@ public:
 	uint16_t getPortNo(void);
     bdaddr_t* getAddress(void);
 	bool isMatch(SensorNetAddress* addr);
+	uint32_t hash(void);
 	SensorNetAddress& operator =(SensorNetAddress& addr);
 	char* sprint(char* buf);
 private:
@@ -86,6 +87,8 @@ public:
 	void initialize(void);
 	const char* getDescription(void);
 	SensorNetAddress* getSenderAddress(void);
+	int getPollFds(int* fds, int maxFds);
+	int setPollFds(int* fds, int cnt);
 
 private:
     // sockets for RFCOMM
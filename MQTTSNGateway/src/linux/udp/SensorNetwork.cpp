@@ -121,6 +121,11 @@ bool SensorNetAddress::isMatch(SensorNetAddress* addr)
 	return ((this->_portNo == addr->_portNo) && (this->_IpAddr == addr->_IpAddr));
 }
 
+uint32_t SensorNetAddress::hash(void)
+{
+	return (_IpAddr * 0x9E3779B1U) ^ _portNo;
+}
+
 SensorNetAddress& SensorNetAddress::operator =(SensorNetAddress& addr)
 {
 	this->_portNo = addr._portNo;
@@ -281,6 +286,13 @@ int UDPPort::open(const char *multicastIP, uint16_t multiPortNo, uint16_t uniPor
         return -1;
     }
 
+    /*------ Sockets handed over by the previous process are already bound --------*/
+    if (_pollFds[0].fd > 0 && _pollFds[1].fd > 0)
+    {
+        _multicastAddr.setAddress(inet_addr(multicastIP), htons(multiPortNo));
+        return 0;
+    }
+
     /*------ Create unicast socket --------*/
     sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0)
@@ -403,6 +415,40 @@ int UDPPort::recv(uint8_t* buf, uint16_t len, SensorNetAddress* addr)
     return rc;
 }
 
+/*
+ *  Returns the unicast and multicast sockets for a single threaded event loop.
+ */
+int UDPPort::getPollFds(int* fds, int maxFds)
+{
+	int cnt = 0;
+	for (int i = 0; i < 2 && cnt < maxFds; i++)
+	{
+		if (_pollFds[i].fd > 0)
+		{
+			fds[cnt++] = _pollFds[i].fd;
+		}
+	}
+	return cnt;
+}
+
+/*
+ *  Adopts the unicast and multicast sockets handed over by the previous gateway process.
+ *  They must be set before open().
+ */
+int UDPPort::setPollFds(int* fds, int cnt)
+{
+	if (cnt != 2)
+	{
+		return 0;
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		_pollFds[i].fd = fds[i];
+		_pollFds[i].events = POLLIN;
+	}
+	return cnt;
+}
+
 int UDPPort::recvfrom(int sockfd, uint8_t* buf, uint16_t len, uint8_t flags, SensorNetAddress* addr)
 {
     sockaddr_in sender;
@@ -39,6 +39,7 @@ public:
 	uint16_t getPortNo(void);
 	uint32_t getIpAddress(void);
 	bool isMatch(SensorNetAddress* addr);
+	uint32_t hash(void);
 	SensorNetAddress& operator =(SensorNetAddress& addr);
 	char* sprint(char* buf);
 private:
@@ -60,6 +61,8 @@ public:
 	int unicast(const uint8_t* buf, uint32_t length, SensorNetAddress* sendToAddr);
 	int broadcast(const uint8_t* buf, uint32_t length);
 	int recv(uint8_t* buf, uint16_t len, SensorNetAddress* addr);
+	int getPollFds(int* fds, int maxFds);
+	int setPollFds(int* fds, int cnt);
 
 private:
 	void setNonBlocking(const bool);
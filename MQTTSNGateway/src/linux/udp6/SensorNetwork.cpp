@@ -126,6 +126,11 @@ bool SensorNetAddress::isMatch(SensorNetAddress* addr)
                     sizeof(this->_IpAddr.sin6_addr.s6_addr)) == 0);
 }
 
+uint32_t SensorNetAddress::hash(void)
+{
+    return hashBytes(_IpAddr.sin6_addr.s6_addr, sizeof(_IpAddr.sin6_addr.s6_addr)) ^ _IpAddr.sin6_port;
+}
+
 SensorNetAddress& SensorNetAddress::operator =(SensorNetAddress& addr)
 {
     memcpy(&this->_IpAddr, &addr._IpAddr, sizeof(this->_IpAddr));
@@ -266,6 +271,17 @@ int UDPPort6::open(uint16_t uniPortNo, uint16_t multiPortNo, const char *multica
         return -1;
     }
 
+    // Sockets handed over by the previous process are already bound
+    if (_pollfds[0].fd > 0 && _pollfds[1].fd > 0)
+    {
+        memset(&addr6, 0, sizeof(addr6));
+        addr6.sin6_family = AF_INET6;
+        addr6.sin6_port = htons(multiPortNo);
+        inet_pton(AF_INET6, multicastAddr, &addr6.sin6_addr);
+        _grpAddr.setAddress(&addr6);
+        return 0;
+    }
+
     // Create a unicast socket
     sock = socket(AF_INET6, SOCK_DGRAM, 0);
     if (sock < 0)
@@ -457,6 +473,40 @@ int UDPPort6::recv(uint8_t* buf, uint16_t len, SensorNetAddress* addr)
     return 0;
 }
 
+/*
+ *  Returns the unicast and multicast sockets for a single threaded event loop.
+ */
+int UDPPort6::getPollFds(int* fds, int maxFds)
+{
+    int cnt = 0;
+    for (int i = 0; i < 2 && cnt < maxFds; i++)
+    {
+        if (_pollfds[i].fd > 0)
+        {
+            fds[cnt++] = _pollfds[i].fd;
+        }
+    }
+    return cnt;
+}
+
+/*
+ *  Adopts the unicast and multicast sockets handed over by the previous gateway process.
+ *  They must be set before open().
+ */
+int UDPPort6::setPollFds(int* fds, int cnt)
+{
+    if (cnt != 2)
+    {
+        return 0;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        _pollfds[i].fd = fds[i];
+        _pollfds[i].events = POLLIN;
+    }
+    return cnt;
+}
+
 int UDPPort6::recvfrom(int sockfd, uint8_t* buf, uint16_t len, uint8_t flags, SensorNetAddress* addr)
 {
     sockaddr_in6 sender;
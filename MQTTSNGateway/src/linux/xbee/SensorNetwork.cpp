@@ -73,6 +73,11 @@ bool SensorNetAddress::isMatch(SensorNetAddress* addr)
 	return (memcmp(this->_address64, addr->_address64, 8 ) == 0 &&  memcmp(this->_address16, addr->_address16, 2) == 0);
 }
 
+uint32_t SensorNetAddress::hash(void)
+{
+	return hashBytes(_address64, 8) ^ ((uint32_t) _address16[0] << 8) ^ _address16[1];
+}
+
 SensorNetAddress& SensorNetAddress::operator =(SensorNetAddress& addr)
 {
 	memcpy(_address64, addr._address64, 8);
@@ -164,6 +169,23 @@ SensorNetAddress* SensorNetwork::getSenderAddress(void)
 	return &_clientAddr;
 }
 
+/*
+ *  The single threaded event loop is not supported.
+ *  XBee::unicast waits for the transmit status read by the receiving task.
+ */
+int SensorNetwork::getPollFds(int* fds, int maxFds)
+{
+	return 0;
+}
+
+/*
+ *  Sockets can't be handed over to another process.
+ */
+int SensorNetwork::setPollFds(int* fds, int cnt)
+{
+	return 0;
+}
+
 /*===========================================
               Class  XBee
  ============================================*/
@@ -68,6 +68,7 @@ public:
 	int  setAddress(string* data);
 	void setBroadcastAddress(void);
 	bool isMatch(SensorNetAddress* addr);
+	uint32_t hash(void);
 	SensorNetAddress& operator =(SensorNetAddress& addr);
 	char* sprint(char*);
 private:
@@ -122,6 +123,8 @@ public:
 	void initialize(void);
 	const char* getDescription(void);
 	SensorNetAddress* getSenderAddress(void);
+	int getPollFds(int* fds, int maxFds);
+	int setPollFds(int* fds, int cnt);
 
 private:
 	SensorNetAddress _clientAddr;   // Sender's address. not gateway's one.
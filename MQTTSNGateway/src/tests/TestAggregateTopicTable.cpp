@@ -0,0 +1,197 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "TestAggregateTopicTable.h"
+#include "TestUtil.h"
+#include "MQTTSNGWClient.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define BENCH_DEVICES   20000   // each subscribes its own filter and the broadcast filter
+#define BENCH_PUBLISH   100000
+#define BENCH_WALKS     100     // matches by walking the filters, as the table did before the trie
+
+TestAggregateTopicTable::TestAggregateTopicTable()
+{
+
+}
+
+TestAggregateTopicTable::~TestAggregateTopicTable()
+{
+
+}
+
+static void subscribe(AggregateTopicTable* table, const char* filter, Client* client, bool add)
+{
+	Topic topic(new string(filter), MQTTSN_TOPIC_TYPE_NORMAL);
+	if (add)
+	{
+		table->add(&topic, client);
+	}
+	else
+	{
+		table->erase(&topic, client);
+	}
+}
+
+static int publish(AggregateTopicTable* table, const char* name, Client** clients, int size)
+{
+	return table->getClients(name, strlen(name), clients, size);
+}
+
+static bool has(Client** clients, int cnt, Client* client)
+{
+	for (int i = 0; i < cnt; i++)
+	{
+		if (clients[i] == client)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void TestAggregateTopicTable::test(void)
+{
+	AggregateTopicTable table;
+	Client* cl[4];
+	Client* clients[8];
+	int cnt;
+
+	for (int i = 0; i < 4; i++)
+	{
+		cl[i] = new Client();
+	}
+
+	subscribe(&table, "a/+/c", cl[0], true);
+	subscribe(&table, "a/#", cl[1], true);
+	subscribe(&table, "a/b/c", cl[0], true);
+	subscribe(&table, "a/b/c", cl[2], true);
+	subscribe(&table, "a/b/c", cl[2], true);
+	subscribe(&table, "+/x", cl[3], true);
+	assert(table.getCount() == 4);
+
+	/* all matching filters, each client once */
+	cnt = publish(&table, "a/b/c", clients, 8);
+	assert(cnt == 3 && has(clients, cnt, cl[0]) && has(clients, cnt, cl[1]) && has(clients, cnt, cl[2]));
+	cnt = publish(&table, "a", clients, 8);
+	assert(cnt == 1 && clients[0] == cl[1]);
+	cnt = publish(&table, "b/x", clients, 8);
+	assert(cnt == 1 && clients[0] == cl[3]);
+	assert(publish(&table, "b/y", clients, 8) == 0);
+
+	/* no more clients than the size */
+	assert(publish(&table, "a/b/c", clients, 2) == 2);
+
+	/* the filter is kept while a client subscribes it */
+	subscribe(&table, "a/+/c", cl[0], false);
+	cnt = publish(&table, "a/b/c", clients, 8);
+	assert(cnt == 3 && has(clients, cnt, cl[0]));
+	assert(publish(&table, "a/z/c", clients, 8) == 1);
+	subscribe(&table, "a/b/c", cl[0], false);
+	cnt = publish(&table, "a/b/c", clients, 8);
+	assert(cnt == 2 && !has(clients, cnt, cl[0]));
+	assert(table.getCount() == 3);
+
+	subscribe(&table, "a/b/c", cl[2], false);
+	subscribe(&table, "a/#", cl[1], false);
+	subscribe(&table, "+/x", cl[3], false);
+	assert(table.getCount() == 0 && publish(&table, "a/b/c", clients, 8) == 0);
+
+	subscribe(&table, "a/#", cl[1], true);
+	table.clear();
+	assert(table.getCount() == 0 && publish(&table, "a/b", clients, 8) == 0);
+
+	for (int i = 0; i < 4; i++)
+	{
+		delete cl[i];
+	}
+	printf("[ OK ]\n");
+}
+
+/*
+ *  Fan-out of the PUBLISH of a device filter and of the broadcast filter
+ *  by the TopicTrie and by walking the filters with Topic::isMatch.
+ */
+void TestAggregateTopicTable::bench(void)
+{
+	AggregateTopicTable table;
+	Client* devices = new Client[BENCH_DEVICES];
+	Client** clients = new Client*[BENCH_DEVICES];
+	Topic** filters = new Topic*[BENCH_DEVICES];
+	char buf[64];
+	struct timespec start;
+	long found = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_DEVICES; i++)
+	{
+		sprintf(buf, "site/%d/cmd", i);
+		filters[i] = new Topic(new string(buf), MQTTSN_TOPIC_TYPE_NORMAL);
+		table.add(filters[i], &devices[i]);
+		subscribe(&table, "site/+/broadcast", &devices[i], true);
+	}
+	double addMsec = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_PUBLISH; i++)
+	{
+		sprintf(buf, "site/%d/cmd", i % BENCH_DEVICES);
+		found += publish(&table, buf, clients, BENCH_DEVICES);
+	}
+	double trieMsec = elapsed(&start);
+	assert(found == BENCH_PUBLISH);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	found = publish(&table, "site/7/broadcast", clients, BENCH_DEVICES);
+	double broadcastMsec = elapsed(&start);
+	assert(found == BENCH_DEVICES);
+
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_WALKS; i++)
+	{
+		sprintf(buf, "site/%d/cmd", (i * 197) % BENCH_DEVICES);
+		string name(buf);
+		for (int j = 0; j < BENCH_DEVICES; j++)
+		{
+			if (filters[j]->isMatch(&name))
+			{
+				found++;
+				break;
+			}
+		}
+	}
+	double walkMsec = elapsed(&start);
+	assert(found == BENCH_WALKS);
+
+	printf("      %d subscriptions added in %.1f ms  PUBLISH to a device %.3f us  to all %.3f ms\n", BENCH_DEVICES * 2,
+			addMsec, trieMsec * 1000.0 / BENCH_PUBLISH, broadcastMsec);
+	printf("      match by walking the filters %.3f us\n", walkMsec * 1000.0 / BENCH_WALKS);
+
+	table.clear();
+	for (int i = 0; i < BENCH_DEVICES; i++)
+	{
+		delete filters[i];
+	}
+	delete[] filters;
+	delete[] clients;
+	delete[] devices;
+}
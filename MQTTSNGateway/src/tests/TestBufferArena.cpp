@@ -0,0 +1,321 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cassert>
+#include <time.h>
+#include "TestBufferArena.h"
+#include "TestUtil.h"
+#include "MQTTSNGWPacket.h"
+#include "Threading.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define TEST_BUFFERS     1000
+#define BENCH_BUFFERS   64        // packets in flight in a task
+#define BENCH_ROUNDS    100000
+#define BENCH_HANDOVERS 1000      // buffers allocated by a task and released by another
+#define BENCH_HANDOVER_ROUNDS 100 // tasks started
+#define BENCH_PACKETS   1000000
+
+TestBufferArena::TestBufferArena()
+{
+
+}
+
+TestBufferArena::~TestBufferArena()
+{
+
+}
+
+static uint64_t getInUse(void)
+{
+	BufferArenaStats stats;
+	BufferArena::getStats(&stats);
+	uint64_t inUse = 0;
+	for (int i = 0; i <= ARENA_CLASSES; i++)
+	{
+		inUse += stats.inUseCnt[i];
+	}
+	return inUse;
+}
+
+static uint64_t getAllocs(void)
+{
+	BufferArenaStats stats;
+	BufferArena::getStats(&stats);
+	uint64_t allocs = 0;
+	for (int i = 0; i <= ARENA_CLASSES; i++)
+	{
+		allocs += stats.allocCnt[i];
+	}
+	return allocs;
+}
+
+/*
+ *  Allocates the buffers as the ClientRecvTask does, the main thread releases them.
+ */
+class BufferAllocator: public Thread
+{
+public:
+	BufferAllocator(void** bufs, int cnt, bool arena)
+	{
+		_bufs = bufs;
+		_cnt = cnt;
+		_arena = arena;
+	}
+
+	void EXECRUN()
+	{
+		for (int i = 0; i < _cnt; i++)
+		{
+			int size = 7 + (i % 16) * 64;
+			_bufs[i] = _arena ? BufferArena::allocate(size) : malloc(size);
+			memset(_bufs[i], i, size);
+		}
+	}
+
+private:
+	void** _bufs;
+	int _cnt;
+	bool _arena;
+};
+
+/*
+ *  Destructed after the cache of the thread because it is constructed before the thread uses the BufferArena.
+ */
+struct LateUser
+{
+	void* buf { nullptr };
+
+	~LateUser()
+	{
+		BufferArena::release(buf);
+		void* small = BufferArena::allocate(48);
+		void* large = BufferArena::allocate(64 * 1024);
+		memset(small, 0xa5, 48);
+		memset(large, 0x5a, 64 * 1024);
+		BufferArena::release(small);
+		BufferArena::release(large);
+	}
+};
+
+static thread_local LateUser theLateUser;
+
+class LateAllocator: public Thread
+{
+public:
+	void EXECRUN()
+	{
+		theLateUser.buf = nullptr;
+		theLateUser.buf = BufferArena::allocate(48);
+	}
+};
+
+void TestBufferArena::test(void)
+{
+	BufferArenaStats stats;
+	size_t sizes[] = { 0, 1, 7, 8, 9, 100, 1024, 1040, BufferArena::getClassSize(ARENA_CLASSES - 1) };
+
+	assert(BufferArena::getClassSize(0) == 8);
+	assert(BufferArena::getClassSize(ARENA_CLASSES - 1) >= MQTTSNGW_MAX_PACKET_SIZE + 8);
+
+	uint64_t inUse = getInUse();
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(size_t); i++)
+	{
+		void* buf = BufferArena::allocate(sizes[i]);
+		assert(((uintptr_t) buf & 7) == 0);
+		memset(buf, 0xa5, sizes[i]);
+		BufferArena::release(buf);
+
+		/* the buffer just released is reused */
+		assert(BufferArena::allocate(sizes[i]) == buf);
+		BufferArena::release(buf);
+	}
+	BufferArena::release(nullptr);
+	assert(getInUse() == inUse);
+
+	/* larger than the largest class */
+	BufferArena::getStats(&stats);
+	uint64_t heapCnt = stats.allocCnt[ARENA_CLASSES];
+	void* large = BufferArena::allocate(64 * 1024);
+	memset(large, 0x5a, 64 * 1024);
+	BufferArena::getStats(&stats);
+	assert(stats.allocCnt[ARENA_CLASSES] == heapCnt + 1 && stats.inUseCnt[ARENA_CLASSES] >= 1);
+	BufferArena::release(large);
+
+	/* more buffers than a thread caches */
+	void* bufs[TEST_BUFFERS];
+	for (int i = 0; i < TEST_BUFFERS; i++)
+	{
+		bufs[i] = BufferArena::allocate(48);
+		memset(bufs[i], i, 48);
+	}
+	assert(getInUse() == inUse + TEST_BUFFERS);
+	for (int i = 0; i < TEST_BUFFERS; i++)
+	{
+		assert(((unsigned char*) bufs[i])[47] == (unsigned char) i);
+		BufferArena::release(bufs[i]);
+	}
+	assert(getInUse() == inUse);
+
+	/* released by another thread, the slabs are reused once this thread caches its share */
+	uint32_t slabCnt = 0;
+	for (int r = 0; r < 4; r++)
+	{
+		BufferAllocator allocator(bufs, TEST_BUFFERS, true);
+		allocator.start();
+		allocator.stop();
+		for (int i = 0; i < TEST_BUFFERS; i++)
+		{
+			BufferArena::release(bufs[i]);
+		}
+		BufferArena::getStats(&stats);
+		assert(r < 2 || stats.slabCnt == slabCnt);
+		slabCnt = stats.slabCnt;
+	}
+	assert(getInUse() == inUse);
+
+	/* buffers allocated and released after the thread flushed its cache are counted once */
+	uint64_t allocs = getAllocs();
+	for (int r = 0; r < 2; r++)
+	{
+		LateAllocator allocator;
+		allocator.start();
+		allocator.stop();
+	}
+	assert(getAllocs() == allocs + 6 && getInUse() == inUse);
+
+	/* a control packet is held in the object, which takes one buffer */
+	MQTTSNPacket* packet = new MQTTSNPacket();
+	packet->setPUBACK(1, 2, 0);
+	MQTTSNPacket* copy = new MQTTSNPacket(*packet);
+	assert(copy->getPacketLength() == 7 && memcmp(copy->getPacketData(), packet->getPacketData(), 7) == 0);
+	assert(packet->getPacketData() > (unsigned char*) packet && packet->getPacketData() < (unsigned char*) (packet + 1));
+	assert(getInUse() == inUse + 2);
+	assert(((uintptr_t) packet - ARENA_HEADER_SIZE) % 64 == 0);
+
+	/* a large PUBLISH spills to a buffer, and back to the object when it is reused */
+	uint8_t payload[100];
+	memset(payload, 0x55, sizeof(payload));
+	MQTTSN_topicid topic;
+	topic.type = MQTTSN_TOPIC_TYPE_NORMAL;
+	topic.data.id = 1;
+	packet->setPUBLISH(0, 1, 0, 3, topic, payload, sizeof(payload));
+	assert(packet->getPacketLength() > MQTTSNPACKET_INLINE_SIZE);
+	assert(getInUse() == inUse + 3);
+	delete copy;
+	copy = new MQTTSNPacket(*packet);
+	assert(copy->getPacketLength() == packet->getPacketLength());
+	assert(memcmp(copy->getPacketData(), packet->getPacketData(), packet->getPacketLength()) == 0);
+	assert(getInUse() == inUse + 4);
+	packet->setPINGRESP();
+	assert(getInUse() == inUse + 3);
+	delete packet;
+	delete copy;
+	assert(getInUse() == inUse);
+
+	MQTTSNPacket onStack;
+	onStack.setCONNACK(0);
+	assert(onStack.isAccepted() && getInUse() == inUse);
+
+	printf("[ OK ]\n");
+}
+
+void TestBufferArena::bench(void)
+{
+	void* bufs[BENCH_BUFFERS];
+	struct timespec start;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int r = 0; r < BENCH_ROUNDS; r++)
+	{
+		for (int i = 0; i < BENCH_BUFFERS; i++)
+		{
+			bufs[i] = BufferArena::allocate(7 + (i % 16) * 64);
+		}
+		for (int i = 0; i < BENCH_BUFFERS; i++)
+		{
+			BufferArena::release(bufs[i]);
+		}
+	}
+	double arenaMsec = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int r = 0; r < BENCH_ROUNDS; r++)
+	{
+		for (int i = 0; i < BENCH_BUFFERS; i++)
+		{
+			bufs[i] = malloc(7 + (i % 16) * 64);
+			*(volatile char*) bufs[i] = 0;
+		}
+		for (int i = 0; i < BENCH_BUFFERS; i++)
+		{
+			free(bufs[i]);
+		}
+	}
+	double mallocMsec = elapsed(&start);
+
+	printf("      %d buffers of 7..967 bytes  arena %.3f us  malloc %.3f us\n", BENCH_BUFFERS,
+			arenaMsec * 1000.0 / (BENCH_ROUNDS * BENCH_BUFFERS), mallocMsec * 1000.0 / (BENCH_ROUNDS * BENCH_BUFFERS));
+
+	void** handovers = new void*[BENCH_HANDOVERS];
+	double msec[2];
+	for (int arena = 1; arena >= 0; arena--)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (int r = 0; r < BENCH_HANDOVER_ROUNDS; r++)
+		{
+			BufferAllocator allocator(handovers, BENCH_HANDOVERS, arena);
+			allocator.start();
+			allocator.stop();
+			for (int i = 0; i < BENCH_HANDOVERS; i++)
+			{
+				if (arena)
+				{
+					BufferArena::release(handovers[i]);
+				}
+				else
+				{
+					free(handovers[i]);
+				}
+			}
+		}
+		msec[arena] = elapsed(&start);
+	}
+	delete[] handovers;
+
+	BufferArenaStats stats;
+	BufferArena::getStats(&stats);
+	printf("      %d x %d buffers released by another thread  arena %.1f ms  malloc %.1f ms  (%u KB of slabs)\n",
+			BENCH_HANDOVER_ROUNDS, BENCH_HANDOVERS, msec[1], msec[0], (unsigned int) (BufferArena::getMemorySize() / 1024));
+
+	/* PUBACK as PacketHandleTask creates it for ClientSendTask */
+	uint64_t allocs = getAllocs();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_PACKETS; i++)
+	{
+		MQTTSNPacket* packet = new MQTTSNPacket();
+		packet->setPUBACK(1, (uint16_t) i, 0);
+		delete packet;
+	}
+	double packetMsec = elapsed(&start);
+	allocs = getAllocs() - allocs;
+	printf("      %d PUBACK packets  %.3f us per packet  %.1f buffers per packet\n", BENCH_PACKETS,
+			packetMsec * 1000.0 / BENCH_PACKETS, (double) allocs / BENCH_PACKETS);
+}
@@ -0,0 +1,516 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "TestClientList.h"
+#include "TestUtil.h"
+#include "MQTTSNGWClientList.h"
+#include "MQTTSNGWClient.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define TEST_CLIENTS      100
+#define BENCH_CLIENTS  100000
+#define BENCH_LOOKUPS  100000
+#define BENCH_WALKS      1000   // lookups by walking the list, as ClientList did before the index
+#define BENCH_SWEEPS      100
+#define STABLE_CLIENTS   1000   // never changed while the readers run
+#define CHURN_CLIENTS   20000   // created, moved and erased while the readers run
+#define READERS             2
+#define ADDRESSLESS_CLIENTS 16000  // forwarded clients and clients of predefined topics
+
+static void printAddress(char* buf, int i)
+{
+	sprintf(buf, "10.%d.%d.%d:%d", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, 20000 + (i & 0x0f));
+}
+
+static void setAddress(SensorNetAddress* addr, int i)
+{
+	char buf[32];
+	printAddress(buf, i);
+	string str(buf);
+	assert(0 == addr->setAddress(&str));
+}
+
+static Client* createClient(ClientList* list, int i)
+{
+	char id[32];
+	SensorNetAddress addr;
+	MQTTSNString clientId = MQTTSNString_initializer;
+
+	sprintf(id, "client-%d", i);
+	clientId.cstring = id;
+	setAddress(&addr, i);
+	return list->createClient(&addr, &clientId, TRANSPEARENT_TYPE);
+}
+
+static Client* createAddresslessClient(ClientList* list, int i)
+{
+	char id[32];
+	MQTTSNString clientId = MQTTSNString_initializer;
+
+	sprintf(id, "forwarded-%d", i);
+	clientId.cstring = id;
+	return list->createClient(nullptr, &clientId, TRANSPEARENT_TYPE);
+}
+
+static Client* getClient(ClientList* list, int i)
+{
+	char id[32];
+	MQTTSNString clientId = MQTTSNString_initializer;
+
+	sprintf(id, "client-%d", i);
+	clientId.cstring = id;
+	return list->getClient(&clientId);
+}
+
+/*
+ *  Looks up and walks the clients without a lock while the main thread changes the list.
+ */
+class ClientReader: public Thread
+{
+public:
+	ClientReader(ClientList* list)
+	{
+		_list = list;
+		_misses = 0;
+		_stop = false;
+	}
+
+	void EXECRUN()
+	{
+		SensorNetAddress addr;
+		for (int i = 0; !_stop; i++)
+		{
+			int n = i % STABLE_CLIENTS;
+			setAddress(&addr, n);
+			_list->beginRead();
+			Client* client = _list->getClient(&addr);
+			if (client == nullptr || getClient(_list, n) != client)
+			{
+				_misses++;
+			}
+			if ((i & 0xff) == 0)
+			{
+				int cnt = 0;
+				for (client = _list->getClient(0); client; client = client->getNextClient())
+				{
+					cnt += (strncmp(client->getClientId(), "client-", 7) == 0);
+				}
+				if (cnt < STABLE_CLIENTS)
+				{
+					_misses++;
+				}
+			}
+			_list->endRead();
+		}
+	}
+
+	void stopRead(void)
+	{
+		_stop = true;
+		stop();
+	}
+
+	int getMisses(void)
+	{
+		return _misses;
+	}
+
+private:
+	ClientList* _list;
+	int _misses;
+	std::atomic<bool> _stop;
+};
+
+/*
+ *  Enters and leaves the Epoch once, then exits.
+ */
+class EpochReaderThread: public Thread
+{
+public:
+	EpochReaderThread(Epoch* epoch)
+	{
+		_epoch = epoch;
+		_left = false;
+	}
+
+	void EXECRUN()
+	{
+		_epoch->enter();
+		_epoch->leave();
+		_left = true;
+	}
+
+	bool hasLeft(void)
+	{
+		return _left;
+	}
+
+private:
+	Epoch* _epoch;
+	bool _left;
+};
+
+static int theReclaimed = 0;
+
+static void reclaimInt(void* obj)
+{
+	delete (int*) obj;
+	theReclaimed++;
+}
+
+TestClientList::TestClientList()
+{
+
+}
+
+TestClientList::~TestClientList()
+{
+
+}
+
+void TestClientList::test(void)
+{
+	ClientList* list = new ClientList(nullptr);
+	Client* clients[TEST_CLIENTS];
+	SensorNetAddress addr;
+
+	list->allocate(TEST_CLIENTS);
+	for (int i = 0; i < TEST_CLIENTS; i++)
+	{
+		clients[i] = createClient(list, i);
+		assert(clients[i] != nullptr);
+	}
+	assert(list->getClientCount() == TEST_CLIENTS);
+
+	/* the same address returns the registered client */
+	assert(createClient(list, 7) == clients[7]);
+	for (int i = 0; i < TEST_CLIENTS; i++)
+	{
+		setAddress(&addr, i);
+		assert(list->getClient(&addr) == clients[i]);
+	}
+	setAddress(&addr, TEST_CLIENTS);
+	assert(list->getClient(&addr) == nullptr);
+
+	/* ClientIds match exactly, not by prefix */
+	for (int i = 0; i < TEST_CLIENTS; i++)
+	{
+		assert(getClient(list, i) == clients[i]);
+	}
+	assert(getClient(list, TEST_CLIENTS) == nullptr);
+	MQTTSNString lenId = MQTTSNString_initializer;
+	lenId.lenstring.data = (char*) "client-12345";
+	lenId.lenstring.len = 9;
+	assert(list->getClient(&lenId) == clients[12]);
+	lenId.lenstring.len = 7;
+	assert(list->getClient(&lenId) == nullptr);
+
+	/* a client moved to another address */
+	setAddress(&addr, TEST_CLIENTS + 1);
+	list->setClientAddress(clients[3], &addr);
+	assert(list->getClient(&addr) == clients[3]);
+	setAddress(&addr, 3);
+	assert(list->getClient(&addr) == nullptr);
+
+	/* erased clients can't be found, the others still can */
+	for (int i = 0; i < TEST_CLIENTS; i += 2)
+	{
+		clients[i]->setSessionStatus(true);
+		list->erase(clients[i]);
+		assert(clients[i] == nullptr);
+	}
+	assert(list->getClientCount() == TEST_CLIENTS / 2);
+	for (int i = 0; i < TEST_CLIENTS; i++)
+	{
+		setAddress(&addr, i == 3 ? TEST_CLIENTS + 1 : i);
+		assert(list->getClient(&addr) == clients[i]);
+		assert(getClient(list, i) == clients[i]);
+	}
+
+	/* clients without an address are found by ClientId only, until they get one */
+	SensorNetAddress noAddr;
+	Client* forwarded[2];
+	for (int i = 0; i < 2; i++)
+	{
+		forwarded[i] = createAddresslessClient(list, i);
+		assert(forwarded[i] != nullptr);
+	}
+	assert(forwarded[0] != forwarded[1]);
+	assert(list->getClient(&noAddr) == nullptr);
+	setAddress(&addr, TEST_CLIENTS + 2);
+	list->setClientAddress(forwarded[1], &addr);
+	assert(list->getClient(&addr) == forwarded[1]);
+	forwarded[0]->setSessionStatus(true);
+	list->erase(forwarded[0]);
+	forwarded[1]->setSessionStatus(true);
+	list->erase(forwarded[1]);
+	assert(list->getClient(&addr) == nullptr);
+
+	/* the hot fields follow the clients, the slots of the erased clients are reused */
+	ClientHotFields* hot = list->getHotFields();
+	int used = 0;
+	for (int i = 0; i < hot->size; i++)
+	{
+		used += (hot->status[i] != Cstat_Free);
+		if (list->getSlotClient(i) == clients[1])
+		{
+			assert(hot->status[i] == Cstat_Disconnected);
+			clients[1]->updateStatus(Cstat_Active);
+			assert(hot->status[i] == Cstat_Active);
+			setAddress(&addr, 1);
+			assert(hot->sensorNetAddr[i].isMatch(&addr));
+			assert(hot->sock[i] == 0);
+		}
+	}
+	assert(used == TEST_CLIENTS / 2);
+	for (int i = TEST_CLIENTS + 2; i < TEST_CLIENTS + 2 + TEST_CLIENTS / 2; i++)
+	{
+		assert(createClient(list, i) != nullptr);
+	}
+	assert(list->getClientCount() == TEST_CLIENTS);
+
+	/* the state of a client is allocated on first use and released by shrink() while it is empty */
+	Client* client = clients[1];
+	size_t idleSize = client->getMemorySize();
+	MQTTSN_topicid topicid;
+	topicid.type = MQTTSN_TOPIC_TYPE_PREDEFINED;
+	topicid.data.id = 1;
+	client->setWaitedPubTopicId(1, 1, &topicid);
+	assert(client->getExistingNetwork() == nullptr && client->getMemorySize() > idleSize);
+	assert(client->getNetwork() == client->getExistingNetwork());
+	assert(client->getMemorySize() > idleSize);
+	assert(client->getWaitedPubTopicId(1) != nullptr);
+	client->eraseWaitedPubTopicId(1);
+	client->shrink();
+	assert(client->getExistingNetwork() != nullptr);
+	client->releaseNetwork();
+	assert(client->getMemorySize() == idleSize);
+	client->getTopics()->add("a/b");
+	client->shrink();
+	assert(client->getMemorySize() > idleSize && client->getTopics()->getCount() == 1);
+	assert(client->getWaitedPubTopicId(1) == nullptr && client->getClientSleepPacket() == nullptr);
+	assert(list->getMemorySize() > (size_t) TEST_CLIENTS * idleSize);
+	delete list;
+
+	/* a reloaded ClientsList moves the listed clients and adds the new ones */
+	list = new ClientList(nullptr);
+	list->allocate(TEST_CLIENTS);
+	clients[0] = createClient(list, 0);
+	clients[1] = createClient(list, 1);
+	clients[2] = createClient(list, 4);
+	clients[2]->updateStatus(Cstat_Active);
+	char fileName[] = "/tmp/TestClientList.XXXXXX";
+	int fd = mkstemp(fileName);
+	assert(fd >= 0);
+	FILE* fp = fdopen(fd, "w");
+	char buf[32];
+	printAddress(buf, 0);
+	fprintf(fp, "# reloaded\nclient-0,%s\n", buf);
+	printAddress(buf, 2);
+	fprintf(fp, "client-1,%s\n", buf);
+	printAddress(buf, 3);
+	fprintf(fp, "client-3,%s\n", buf);
+	printAddress(buf, 5);
+	fprintf(fp, "client-4,%s\n", buf);
+	fclose(fp);
+	assert(list->createList(fileName, TRANSPEARENT_TYPE));
+	unlink(fileName);
+	assert(list->getClientCount() == 4);
+	assert(getClient(list, 0) == clients[0] && getClient(list, 1) == clients[1]);
+	setAddress(&addr, 0);
+	assert(list->getClient(&addr) == clients[0]);
+	setAddress(&addr, 1);
+	assert(list->getClient(&addr) == nullptr);
+	setAddress(&addr, 2);
+	assert(list->getClient(&addr) == clients[1]);
+	setAddress(&addr, 3);
+	assert(list->getClient(&addr) == getClient(list, 3) && getClient(list, 3) != nullptr);
+	setAddress(&addr, 4);
+	assert(list->getClient(&addr) == clients[2]);
+	delete list;
+
+	/* retired objects outlive the readers which may see them */
+	Epoch* epoch = new Epoch();
+	epoch->enter();
+	epoch->retire(new int(1), reclaimInt);
+	epoch->enter();
+	epoch->leave();
+	assert(theReclaimed == 0 && epoch->getRetiredCount() == 1);
+	epoch->leave();
+	epoch->reclaim();
+	assert(theReclaimed == 1 && epoch->getRetiredCount() == 0);
+	epoch->retire(new int(2), reclaimInt);
+	assert(theReclaimed == 2);
+
+	/* the slot of a reader is reused after the thread exits */
+	for (int i = 0; i < EPOCH_MAX_READERS * 2; i++)
+	{
+		EpochReaderThread* reader = new EpochReaderThread(epoch);
+		reader->start();
+		reader->stop();
+		assert(reader->hasLeft());
+		delete reader;
+	}
+	delete epoch;
+
+	/* readers always find the stable clients while others come and go */
+	list = new ClientList(nullptr);
+	list->allocate(STABLE_CLIENTS + CHURN_CLIENTS);
+	for (int i = 0; i < STABLE_CLIENTS; i++)
+	{
+		assert(createClient(list, i) != nullptr);
+	}
+	ClientReader* readers[READERS];
+	for (int i = 0; i < READERS; i++)
+	{
+		readers[i] = new ClientReader(list);
+		readers[i]->start();
+	}
+	for (int i = STABLE_CLIENTS; i < STABLE_CLIENTS + CHURN_CLIENTS; i++)
+	{
+		Client* client = createClient(list, i);
+		assert(client != nullptr);
+		setAddress(&addr, i + STABLE_CLIENTS + CHURN_CLIENTS);
+		list->setClientAddress(client, &addr);
+		if (i % 4)
+		{
+			client->setSessionStatus(true);
+			list->erase(client);
+		}
+	}
+	for (int i = 0; i < READERS; i++)
+	{
+		readers[i]->stopRead();
+		assert(readers[i]->getMisses() == 0);
+		delete readers[i];
+	}
+	assert(list->getClientCount() == STABLE_CLIENTS + CHURN_CLIENTS / 4);
+	delete list;
+	printf("[ OK ]\n");
+}
+
+void TestClientList::bench(void)
+{
+	ClientList* list = new ClientList(nullptr);
+	SensorNetAddress addr;
+	struct timespec start;
+	int found = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	list->allocate(BENCH_CLIENTS);
+	for (int i = 0; i < BENCH_CLIENTS; i++)
+	{
+		assert(createClient(list, i) != nullptr);
+	}
+	double createMsec = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_LOOKUPS; i++)
+	{
+		found += (getClient(list, (i * 7919) % BENCH_CLIENTS) != nullptr);
+	}
+	double idMsec = elapsed(&start);
+	assert(found == BENCH_LOOKUPS);
+	found = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_LOOKUPS; i++)
+	{
+		setAddress(&addr, (i * 7919) % BENCH_CLIENTS);
+		found += (list->getClient(&addr) != nullptr);
+	}
+	double indexMsec = elapsed(&start);
+	assert(found == BENCH_LOOKUPS);
+
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_WALKS; i++)
+	{
+		setAddress(&addr, (i * 7919) % BENCH_CLIENTS);
+		for (Client* client = list->getClient(0); client != nullptr; client = client->getNextClient())
+		{
+			if (client->getSensorNetAddress()->isMatch(&addr))
+			{
+				found++;
+				break;
+			}
+		}
+	}
+	double walkMsec = elapsed(&start);
+	assert(found == BENCH_WALKS);
+
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_SWEEPS; i++)
+	{
+		for (Client* client = list->getClient(0); client != nullptr; client = client->getNextClient())
+		{
+			found += client->isDisconnect();
+		}
+	}
+	double sweepListMsec = elapsed(&start);
+
+	ClientHotFields* hot = list->getHotFields();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_SWEEPS; i++)
+	{
+		for (int j = 0; j < hot->size; j++)
+		{
+			found += (hot->status[j] == Cstat_Disconnected);
+		}
+	}
+	double sweepHotMsec = elapsed(&start);
+	assert(found == BENCH_CLIENTS * BENCH_SWEEPS * 2);
+	size_t memorySize = list->getMemorySize();
+	delete list;
+
+	/* clients without an address stay out of the address index */
+	list = new ClientList(nullptr);
+	list->allocate(ADDRESSLESS_CLIENTS);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < ADDRESSLESS_CLIENTS; i++)
+	{
+		assert(createAddresslessClient(list, i) != nullptr);
+	}
+	double addresslessMsec = elapsed(&start);
+	SensorNetAddress noAddr;
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_LOOKUPS; i++)
+	{
+		found += (list->getClient(&noAddr) != nullptr);
+	}
+	double missMsec = elapsed(&start);
+	assert(found == 0);
+	delete list;
+
+	printf("      %d clients  created in %.1f ms  lookup by ClientId %.3f us\n", BENCH_CLIENTS, createMsec,
+			idMsec * 1000.0 / BENCH_LOOKUPS);
+	printf("      lookup by SensorNetAddress %.3f us  by walking the list %.3f us\n",
+			indexMsec * 1000.0 / BENCH_LOOKUPS, walkMsec * 1000.0 / BENCH_WALKS);
+	printf("      sweep of the status by walking the list %.1f us  in the hot fields %.1f us\n",
+			sweepListMsec * 1000.0 / BENCH_SWEEPS, sweepHotMsec * 1000.0 / BENCH_SWEEPS);
+	printf("      %u KB for %d idle clients, %u bytes per client\n", (unsigned int) (memorySize / 1024), BENCH_CLIENTS,
+			(unsigned int) (memorySize / BENCH_CLIENTS));
+	printf("      %d clients without an address  created in %.1f ms  lookup of the zero address %.3f us\n",
+			ADDRESSLESS_CLIENTS, addresslessMsec, missMsec * 1000.0 / BENCH_LOOKUPS);
+}
@@ -0,0 +1,364 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <cassert>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include "TestEventQue.h"
+#include "TestUtil.h"
+#include "MQTTSNGWPacket.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define BENCH_PRODUCERS    4
+#define BENCH_EVENTS    10000   // per producer, all of them fit in the que
+#define JITTER_ROUNDS   10000
+
+/*
+ *  The former EventQue, Que<Event> guarded by a Mutex and a Semaphore.
+ */
+class LockedEventQue
+{
+public:
+	~LockedEventQue()
+	{
+		while (_que.size() > 0)
+		{
+			delete _que.front();
+			_que.pop();
+		}
+	}
+
+	Event* wait(void)
+	{
+		Event* ev = nullptr;
+		while (ev == nullptr)
+		{
+			if (_que.size() == 0)
+			{
+				_sem.wait();
+			}
+			_mutex.lock();
+			ev = _que.front();
+			_que.pop();
+			_mutex.unlock();
+		}
+		return ev;
+	}
+
+	void post(Event* ev)
+	{
+		_mutex.lock();
+		if (_que.post(ev))
+		{
+			_sem.post();
+		}
+		else
+		{
+			delete ev;
+		}
+		_mutex.unlock();
+	}
+
+private:
+	Que<Event> _que;
+	Mutex _mutex;
+	Semaphore _sem;
+};
+
+template<class QUE>
+class Producer: public Thread
+{
+public:
+	Producer(QUE* que, int id)
+	{
+		_que = que;
+		_id = id;
+	}
+
+	void EXECRUN()
+	{
+		Client* client = reinterpret_cast<Client*>((uintptr_t) _id);
+		for (int i = 0; i < BENCH_EVENTS; i++)
+		{
+			Event* ev = new Event();
+			ev->setClientSendEvent(client, (MQTTSNPacket*) nullptr);
+			_que->post(ev);
+		}
+	}
+
+private:
+	QUE* _que;
+	int _id;
+};
+
+template<class QUE>
+static double runBench(QUE* que)
+{
+	Producer<QUE>* producers[BENCH_PRODUCERS];
+	int received[BENCH_PRODUCERS + 1] = { 0 };
+	struct timespec start;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_PRODUCERS; i++)
+	{
+		producers[i] = new Producer<QUE>(que, i + 1);
+		producers[i]->start();
+	}
+
+	for (int i = 0; i < BENCH_PRODUCERS * BENCH_EVENTS; i++)
+	{
+		Event* ev = que->wait();
+		received[(uintptr_t) ev->getClient()]++;
+		delete ev;
+	}
+	double msec = elapsed(&start);
+
+	for (int i = 0; i < BENCH_PRODUCERS; i++)
+	{
+		producers[i]->stop();
+		delete producers[i];
+		assert(BENCH_EVENTS == received[i + 1]);
+	}
+	return msec;
+}
+
+/*
+ *  Pins the calling thread to the CPU, -1 leaves it as it is.
+ */
+static void pinTo(int cpu)
+{
+#ifndef __APPLE__
+	if (cpu >= 0)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+#endif
+}
+
+/*
+ *  Sends every Event back, the other end of the round trip between two tasks.
+ */
+class Ponger: public Thread
+{
+public:
+	Ponger(EventQue* ping, EventQue* pong, int cpu)
+	{
+		_ping = ping;
+		_pong = pong;
+		_cpu = cpu;
+	}
+
+	void EXECRUN()
+	{
+		pinTo(_cpu);
+		for (int i = 0; i < JITTER_ROUNDS; i++)
+		{
+			_pong->post(_ping->wait());
+		}
+	}
+
+private:
+	EventQue* _ping;
+	EventQue* _pong;
+	int _cpu;
+};
+
+/*
+ *  Round trips of an Event between two threads, sorted, in usecs.
+ */
+static void runJitter(int mainCpu, int pongCpu, double* usecs)
+{
+	EventQue ping;
+	EventQue pong;
+#ifndef __APPLE__
+	cpu_set_t saved;
+	pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved);
+#endif
+	Ponger* ponger = new Ponger(&ping, &pong, pongCpu);
+	ponger->start();
+	pinTo(mainCpu);
+
+	for (int i = 0; i < JITTER_ROUNDS; i++)
+	{
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		Event* ev = new Event();
+		ev->setTimeout();
+		ping.post(ev);
+		delete pong.wait();
+		usecs[i] = elapsed(&start) * 1000.0;
+	}
+
+	ponger->stop();
+	delete ponger;
+#ifndef __APPLE__
+	pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+#endif
+	std::sort(usecs, usecs + JITTER_ROUNDS);
+}
+
+TestEventQue::TestEventQue()
+{
+
+}
+
+TestEventQue::~TestEventQue()
+{
+
+}
+
+void TestEventQue::test(void)
+{
+	EventQue que;
+	uint16_t duration = 0;
+
+	/* FIFO and max size, the drops are checked by the counters */
+	que.setDropLog(false);
+	que.setMaxSize(5);
+	for (int i = 0; i < 10; i++)
+	{
+		MQTTSNPacket* packet = new MQTTSNPacket();
+		packet->setDISCONNECT(i);
+		Event* ev = new Event();
+		ev->setClientSendEvent((Client*) nullptr, packet);
+		que.post(ev);
+		assert(5 >= que.size());
+	}
+	assert(5 == que.size());
+	assert(5 == que.getDropCount(EpControl));
+
+	for (int i = 0; i < 5; i++)
+	{
+		Event* ev = que.wait();
+		assert(EtClientSend == ev->getEventType());
+		ev->getMQTTSNPacket()->getDISCONNECT(&duration);
+		assert(i == duration);
+		delete ev;
+	}
+	assert(0 == que.size());
+
+	/* QoS0 PUBLISH are dropped first, session control is accepted up to the max size */
+	MQTTSN_topicid topicId;
+	topicId.type = MQTTSN_TOPIC_TYPE_PREDEFINED;
+	topicId.data.id = 1;
+	uint8_t payload[] = "sensor data";
+	que.setMaxSize(8);
+	for (int i = 0; i < 8; i++)
+	{
+		MQTTSNPacket* packet = new MQTTSNPacket();
+		packet->setPUBLISH(0, 0, 0, 0, topicId, payload, sizeof(payload));
+		Event* ev = new Event();
+		ev->setClientRecvEvent((Client*) nullptr, packet);
+		assert(EpQoS0 == ev->getPriority());
+		que.post(ev);
+	}
+	assert(8 * EVENTQUE_QOS0_LIMIT / 100 == que.size());
+	assert(8 - 8 * EVENTQUE_QOS0_LIMIT / 100 == que.getDropCount(EpQoS0));
+	assert(que.isCongested());
+	uint32_t drops = que.getDropCount(EpControl);
+	for (int i = 0; i < 8; i++)
+	{
+		MQTTSNPacket* packet = new MQTTSNPacket();
+		packet->setPUBACK(1, i + 1, 0);
+		Event* ev = new Event();
+		ev->setClientRecvEvent((Client*) nullptr, packet);
+		assert(EpControl == ev->getPriority());
+		que.post(ev);
+	}
+	assert(8 == que.size());
+	assert(drops + 8 * EVENTQUE_QOS0_LIMIT / 100 == que.getDropCount(EpControl));
+	while (que.size() > 0)
+	{
+		delete que.wait();
+	}
+
+	/* timeout */
+	Event* ev = que.timedwait(10);
+	assert(EtTimeout == ev->getEventType());
+	delete ev;
+
+	/* wrap around the ring */
+	for (int i = 0; i < 100; i++)
+	{
+		ev = new Event();
+		ev->setStop();
+		que.post(ev);
+		ev = que.timedwait(10);
+		assert(EtStop == ev->getEventType());
+		delete ev;
+	}
+
+	/* Events are recycled by the EventPool */
+	Event* evs[EVENT_POOL_SLAB_SIZE * 2];
+	uint32_t inUse = EventPool::getInUseCount();
+	for (int i = 0; i < EVENT_POOL_SLAB_SIZE * 2; i++)
+	{
+		evs[i] = new Event();
+	}
+	assert(inUse + EVENT_POOL_SLAB_SIZE * 2 == EventPool::getInUseCount());
+	for (int i = 0; i < EVENT_POOL_SLAB_SIZE * 2; i++)
+	{
+		delete evs[i];
+	}
+	uint32_t heapAllocs = EventPool::getHeapAllocCount();
+	for (int i = 0; i < EVENT_POOL_SLAB_SIZE * 2; i++)
+	{
+		evs[i] = new Event();
+		evs[i]->setTimeout();
+	}
+	for (int i = 0; i < EVENT_POOL_SLAB_SIZE * 2; i++)
+	{
+		delete evs[i];
+	}
+	assert(heapAllocs == EventPool::getHeapAllocCount());
+	assert(inUse == EventPool::getInUseCount());
+	printf("[ OK ]\n");
+}
+
+void TestEventQue::bench(void)
+{
+	LockedEventQue* locked = new LockedEventQue();
+	double lockedMsec = runBench(locked);
+	delete locked;
+
+	EventQue* ring = new EventQue();
+	ring->setMaxSize(BENCH_PRODUCERS * BENCH_EVENTS);
+	uint32_t heapAllocs = EventPool::getHeapAllocCount();
+	double ringMsec = runBench(ring);
+	heapAllocs = EventPool::getHeapAllocCount() - heapAllocs;
+	delete ring;
+
+	printf("      %d producers x %d events  Mutex+Semaphore %.1f ms  Ring %.1f ms\n", BENCH_PRODUCERS, BENCH_EVENTS, lockedMsec,
+			ringMsec);
+	printf("      heap allocations for %d Events after warm-up  %u (Que<Event> needed 2 per Event)\n", BENCH_PRODUCERS * BENCH_EVENTS, heapAllocs);
+
+	/* the handoff between two tasks, free to migrate and pinned as <TaskName>CPUs does */
+	double* usecs = new double[JITTER_ROUNDS];
+	int pongCpu = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 1 : 0;
+	runJitter(-1, -1, usecs);
+	printf("      round trip of %d Events  unpinned      p50 %.1f us  p99 %.1f us  max %.1f us\n", JITTER_ROUNDS,
+			usecs[JITTER_ROUNDS / 2], usecs[JITTER_ROUNDS * 99 / 100], usecs[JITTER_ROUNDS - 1]);
+	runJitter(0, pongCpu, usecs);
+	printf("      round trip of %d Events  CPU 0 and %d  p50 %.1f us  p99 %.1f us  max %.1f us\n", JITTER_ROUNDS, pongCpu,
+			usecs[JITTER_ROUNDS / 2], usecs[JITTER_ROUNDS * 99 / 100], usecs[JITTER_ROUNDS - 1]);
+	delete[] usecs;
+}
@@ -0,0 +1,35 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#ifndef MQTTSNGATEWAY_SRC_TESTS_TESTEVENTQUE_H_
+#define MQTTSNGATEWAY_SRC_TESTS_TESTEVENTQUE_H_
+
+#include "MQTTSNGateway.h"
+
+namespace MQTTSNGW
+{
+
+class TestEventQue
+{
+public:
+	TestEventQue();
+	~TestEventQue();
+	void test(void);
+	void bench(void);
+};
+
+}
+
+#endif /* MQTTSNGATEWAY_SRC_TESTS_TESTEVENTQUE_H_ */
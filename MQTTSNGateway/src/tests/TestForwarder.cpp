@@ -0,0 +1,189 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <cassert>
+#include <time.h>
+#include "TestForwarder.h"
+#include "TestUtil.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define TEST_FORWARDERS    16
+#define BENCH_NODES       500   // nodes behind a mesh forwarder
+#define BENCH_ROUNDS      200
+
+TestForwarder::TestForwarder()
+{
+
+}
+
+TestForwarder::~TestForwarder()
+{
+
+}
+
+static void setAddress(SensorNetAddress* addr, int i)
+{
+	char buf[32];
+	sprintf(buf, "10.1.%d.%d:%d", (i >> 8) & 0xff, i & 0xff, 20000 + (i & 0x0f));
+	string str(buf);
+	assert(0 == addr->setAddress(&str));
+}
+
+static void setNodeId(WirelessNodeId* id, int i)
+{
+	uint8_t buf[8] = { 0x00, 0x13, 0xa2, 0x00, 0, 0, 0, 0 };
+	buf[6] = (uint8_t) (i >> 8);
+	buf[7] = (uint8_t) i;
+	id->setId(buf, sizeof(buf));
+}
+
+void TestForwarder::test(void)
+{
+	ForwarderList list;
+	SensorNetAddress addr;
+	char name[16];
+
+	for (int i = 0; i < TEST_FORWARDERS; i++)
+	{
+		MQTTSNString id = MQTTSNString_initializer;
+		sprintf(name, "Fwd%d", i);
+		id.cstring = name;
+		setAddress(&addr, i);
+		assert(list.addForwarder(&addr, &id) != nullptr);
+	}
+	for (int i = 0; i < TEST_FORWARDERS; i++)
+	{
+		setAddress(&addr, i);
+		sprintf(name, "Fwd%d", i);
+		Forwarder* fwd = list.getForwarder(&addr);
+		assert(fwd != nullptr && strcmp(fwd->getName(), name) == 0);
+	}
+	setAddress(&addr, TEST_FORWARDERS);
+	assert(list.getForwarder(&addr) == nullptr);
+
+	setAddress(&addr, 0);
+	Forwarder* fwd = list.getForwarder(&addr);
+	Client* clients = new Client[BENCH_NODES];
+	WirelessNodeId nodeId;
+
+	for (int i = 0; i < BENCH_NODES; i++)
+	{
+		setNodeId(&nodeId, i);
+		fwd->addClient(&clients[i], &nodeId);
+		assert(clients[i].getForwarder() == fwd);
+	}
+	assert(fwd->getClientCount() == BENCH_NODES);
+	for (int i = 0; i < BENCH_NODES; i++)
+	{
+		setNodeId(&nodeId, i);
+		assert(fwd->getClient(&nodeId) == &clients[i]);
+		assert(*fwd->getWirelessNodeId(&clients[i]) == nodeId);
+	}
+
+	/* erase the even clients, move the odd ones to new nodes */
+	for (int i = 0; i < BENCH_NODES; i += 2)
+	{
+		fwd->eraseClient(&clients[i]);
+	}
+	for (int i = 1; i < BENCH_NODES; i += 2)
+	{
+		setNodeId(&nodeId, BENCH_NODES + i);
+		fwd->addClient(&clients[i], &nodeId);
+	}
+	assert(fwd->getClientCount() == BENCH_NODES / 2);
+	for (int i = 0; i < BENCH_NODES; i++)
+	{
+		setNodeId(&nodeId, i);
+		assert(fwd->getClient(&nodeId) == nullptr);
+		if (i % 2)
+		{
+			setNodeId(&nodeId, BENCH_NODES + i);
+			assert(fwd->getClient(&nodeId) == &clients[i]);
+			assert(*fwd->getWirelessNodeId(&clients[i]) == nodeId);
+		}
+		else
+		{
+			assert(fwd->getWirelessNodeId(&clients[i]) == nullptr);
+		}
+	}
+	for (int i = 1; i < BENCH_NODES; i += 2)
+	{
+		fwd->eraseClient(&clients[i]);
+	}
+	assert(fwd->getClientCount() == 0);
+	delete[] clients;
+	printf("[ OK ]\n");
+}
+
+void TestForwarder::bench(void)
+{
+	Forwarder fwd;
+	Client* clients = new Client[BENCH_NODES];
+	WirelessNodeId* nodeIds = new WirelessNodeId[BENCH_NODES];
+	struct timespec start;
+	int found = 0;
+
+	for (int i = 0; i < BENCH_NODES; i++)
+	{
+		setNodeId(&nodeIds[i], i);
+		fwd.addClient(&clients[i], &nodeIds[i]);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int r = 0; r < BENCH_ROUNDS; r++)
+	{
+		for (int i = 0; i < BENCH_NODES; i++)
+		{
+			found += (fwd.getClient(&nodeIds[i]) == &clients[i]);
+			found += (fwd.getWirelessNodeId(&clients[i]) != nullptr);
+		}
+	}
+	double indexed = elapsed(&start);
+	assert(found == BENCH_NODES * BENCH_ROUNDS * 2);
+
+	/* the linear scan done by each packet before the indexes */
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int r = 0; r < BENCH_ROUNDS; r++)
+	{
+		for (int i = 0; i < BENCH_NODES; i++)
+		{
+			for (int j = 0; j < BENCH_NODES; j++)
+			{
+				if (nodeIds[j] == nodeIds[i])
+				{
+					found++;
+					break;
+				}
+			}
+		}
+	}
+	double walked = elapsed(&start);
+	assert(found == BENCH_NODES * BENCH_ROUNDS);
+
+	printf("      %d nodes behind a forwarder  uplink and downlink lookups %.3f us  walk of the list %.3f us\n", BENCH_NODES,
+			indexed * 1000.0 / (BENCH_NODES * BENCH_ROUNDS), walked * 1000.0 / (BENCH_NODES * BENCH_ROUNDS));
+
+	for (int i = 0; i < BENCH_NODES; i++)
+	{
+		fwd.eraseClient(&clients[i]);
+	}
+	delete[] nodeIds;
+	delete[] clients;
+}
@@ -0,0 +1,163 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <cassert>
+#include <stdint.h>
+#include <stdio.h>
+#include "TestKeepAliveWheel.h"
+#include "MQTTSNGWClient.h"
+#include "MQTTSNGWClientList.h"
+#include "MQTTSNGWKeepAliveWheel.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define TEST_CLIENTS  12
+#define BULK_CLIENTS  1000
+
+TestKeepAliveWheel::TestKeepAliveWheel()
+{
+
+}
+
+TestKeepAliveWheel::~TestKeepAliveWheel()
+{
+
+}
+
+void TestKeepAliveWheel::test(void)
+{
+	/* deadlines across all levels of the wheel, in seconds */
+	uint32_t secs[TEST_CLIENTS] = { 1, 5, 63, 64, 65, 100, 4095, 4096, 4097, 5000, 70000, 98303 };
+	uint32_t expired[TEST_CLIENTS];
+	Client* clients[TEST_CLIENTS];
+	KeepAliveWheel* wheel = new KeepAliveWheel();
+
+	/* start near the wrap around of the clock */
+	uint32_t now = 0xFFFFF000;
+	wheel->advance(now);
+
+	for (int i = 0; i < TEST_CLIENTS; i++)
+	{
+		clients[i] = new Client();
+		expired[i] = 0;
+		wheel->schedule(clients[i], secs[i] * 1000);
+	}
+	assert(wheel->getCount() == TEST_CLIENTS);
+
+	for (uint32_t tick = 1; tick <= 100000; tick++)
+	{
+		now += KEEPALIVE_WHEEL_TICK;
+		wheel->advance(now);
+		Client* client = nullptr;
+		while ((client = wheel->getExpiredClient()) != nullptr)
+		{
+			for (int i = 0; i < TEST_CLIENTS; i++)
+			{
+				if (clients[i] == client)
+				{
+					assert(expired[i] == 0);
+					expired[i] = tick;
+				}
+			}
+		}
+	}
+
+	/* never expires earlier, and no later than one tick */
+	for (int i = 0; i < TEST_CLIENTS; i++)
+	{
+		assert(expired[i] > secs[i]);
+		assert(expired[i] <= secs[i] + 1);
+	}
+	assert(wheel->getCount() == 0);
+
+	/* restart and cancel */
+	wheel->schedule(clients[0], 10000);
+	wheel->schedule(clients[1], 10000);
+	for (int i = 0; i < 5; i++)
+	{
+		now += KEEPALIVE_WHEEL_TICK;
+		wheel->advance(now);
+	}
+	wheel->schedule(clients[0], 10000);
+	wheel->cancel(clients[1]);
+	now += 9 * KEEPALIVE_WHEEL_TICK;
+	wheel->advance(now);
+	assert(wheel->getExpiredClient() == nullptr);
+	now += 3 * KEEPALIVE_WHEEL_TICK;
+	wheel->advance(now);
+	assert(wheel->getExpiredClient() == clients[0]);
+	assert(wheel->getExpiredClient() == nullptr);
+
+	/* clients of the same deadline expire at once */
+	Client* bulk[BULK_CLIENTS];
+	for (int i = 0; i < BULK_CLIENTS; i++)
+	{
+		bulk[i] = new Client();
+		wheel->schedule(bulk[i], 90000);
+	}
+	now += 100 * KEEPALIVE_WHEEL_TICK;
+	wheel->advance(now);
+	int cnt = 0;
+	while (wheel->getExpiredClient())
+	{
+		cnt++;
+	}
+	assert(cnt == BULK_CLIENTS);
+	assert(wheel->getCount() == 0);
+
+	/* a client on the wheel is not erased until its timer is canceled, its neighbours stay linked */
+	ClientList* list = new ClientList(nullptr);
+	list->allocate(3);
+	Client* listed[3];
+	for (int i = 0; i < 3; i++)
+	{
+		char id[16];
+		sprintf(id, "listed-%d", i);
+		MQTTSNString clientId = MQTTSNString_initializer;
+		clientId.cstring = id;
+		listed[i] = list->createClient(nullptr, &clientId, TRANSPEARENT_TYPE);
+		listed[i]->setSessionStatus(true);
+		wheel->schedule(listed[i], 10000);
+	}
+	Client* erased = listed[1];
+	list->erase(erased);
+	assert(erased == listed[1] && list->getClientCount() == 3);
+	wheel->cancel(listed[1]);
+	list->erase(erased);
+	assert(erased == nullptr && list->getClientCount() == 2);
+	now += 11 * KEEPALIVE_WHEEL_TICK;
+	wheel->advance(now);
+	cnt = 0;
+	Client* client = nullptr;
+	while ((client = wheel->getExpiredClient()) != nullptr)
+	{
+		assert(client == listed[0] || client == listed[2]);
+		cnt++;
+	}
+	assert(cnt == 2 && wheel->getCount() == 0);
+	delete list;
+
+	for (int i = 0; i < BULK_CLIENTS; i++)
+	{
+		delete bulk[i];
+	}
+	for (int i = 0; i < TEST_CLIENTS; i++)
+	{
+		delete clients[i];
+	}
+	delete wheel;
+	printf("[ OK ]\n");
+}
@@ -0,0 +1,138 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <cassert>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "TestMQTTGWPacket.h"
+#include "TestUtil.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define BENCH_CLIENTS   2000
+#define BENCH_PAYLOAD   1024
+
+TestMQTTGWPacket::TestMQTTGWPacket()
+{
+
+}
+
+TestMQTTGWPacket::~TestMQTTGWPacket()
+{
+
+}
+
+static void setPublish(MQTTGWPacket* packet, const char* topic, char* payload, int len, int qos)
+{
+	Publish pub;
+	memset(&pub, 0, sizeof(Publish));
+	pub.header.bits.qos = qos;
+	pub.topic = const_cast<char*>(topic);
+	pub.topiclen = strlen(topic);
+	pub.msgId = 1;
+	pub.payload = payload;
+	pub.payloadlen = len;
+	packet->setPUBLISH(&pub);
+}
+
+void TestMQTTGWPacket::test(void)
+{
+	char payload[] = "payload";
+	Publish pub;
+	Publish copyPub;
+
+	/* copies share the data */
+	MQTTGWPacket* packet = new MQTTGWPacket();
+	setPublish(packet, "a/b", payload, strlen(payload), 1);
+	MQTTGWPacket* copy = new MQTTGWPacket();
+	*copy = *packet;
+	packet->getPUBLISH(&pub);
+	copy->getPUBLISH(&copyPub);
+	assert(copyPub.payload == pub.payload && copyPub.msgId == 1);
+
+	/* a changed copy gets its own data */
+	copy->setMsgId(7);
+	packet->getPUBLISH(&pub);
+	copy->getPUBLISH(&copyPub);
+	assert(copyPub.payload != pub.payload && copyPub.msgId == 7 && pub.msgId == 1);
+	assert(copyPub.payloadlen == pub.payloadlen && memcmp(copyPub.payload, payload, pub.payloadlen) == 0);
+
+	/* the data outlives the packet it was copied from */
+	*copy = *packet;
+	delete packet;
+	copy->getPUBLISH(&copyPub);
+	assert(copyPub.msgId == 1 && memcmp(copyPub.payload, payload, copyPub.payloadlen) == 0);
+	*copy = *copy;
+	copy->getPUBLISH(&copyPub);
+	assert(copyPub.msgId == 1 && copyPub.topiclen == 3);
+
+	/* a packet set again doesn't change the copies */
+	MQTTGWPacket* other = new MQTTGWPacket();
+	*other = *copy;
+	setPublish(copy, "c", payload, 3, 0);
+	other->getPUBLISH(&pub);
+	assert(pub.topiclen == 3 && strncmp(pub.topic, "a/b", 3) == 0);
+	delete other;
+	delete copy;
+
+	printf("[ OK ]\n");
+}
+
+/*
+ *  Copies of a PUBLISH for the subscribers of the aggregating gateway,
+ *  sharing the data and copying it as operator= did before.
+ */
+void TestMQTTGWPacket::bench(void)
+{
+	char payload[BENCH_PAYLOAD];
+	unsigned char buf[BENCH_PAYLOAD + 64];
+	MQTTGWPacket** copies = new MQTTGWPacket*[BENCH_CLIENTS];
+	MQTTGWPacket packet;
+	struct timespec start;
+
+	memset(payload, 'x', BENCH_PAYLOAD);
+	setPublish(&packet, "site/telemetry", payload, BENCH_PAYLOAD, 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_CLIENTS; i++)
+	{
+		copies[i] = new MQTTGWPacket();
+		*copies[i] = packet;
+	}
+	for (int i = 0; i < BENCH_CLIENTS; i++)
+	{
+		delete copies[i];
+	}
+	double sharedMsec = elapsed(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_CLIENTS; i++)
+	{
+		copies[i] = new MQTTGWPacket();
+		int len = packet.getPacketData(buf);
+		copies[i]->setPacketData(buf, len);
+	}
+	for (int i = 0; i < BENCH_CLIENTS; i++)
+	{
+		delete copies[i];
+	}
+	double copiedMsec = elapsed(&start);
+	delete[] copies;
+
+	printf("      PUBLISH of %d bytes to %d clients  shared %.3f ms  copied %.3f ms\n", BENCH_PAYLOAD, BENCH_CLIENTS,
+			sharedMsec, copiedMsec);
+}
@@ -0,0 +1,117 @@
+/**************************************************************************************
+ * Copyright (c) 2016, Tomoaki Yamaguchi
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    Tomoaki Yamaguchi - initial API and implementation
+ **************************************************************************************/
+#include <cassert>
+#include <stdio.h>
+#include <time.h>
+#include "TestMessageIdTable.h"
+#include "TestUtil.h"
+#include "MQTTSNGWAggregater.h"
+#include "MQTTSNGWClient.h"
+
+using namespace std;
+using namespace MQTTSNGW;
+
+#define BENCH_CLIENTS   100
+#define BENCH_INFLIGHT  50      // QoS1/2 messages of each client waiting for their acks
+#define BENCH_ROUNDS    20
+
+TestMessageIdTable::TestMessageIdTable()
+{
+
+}
+
+TestMessageIdTable::~TestMessageIdTable()
+{
+
+}
+
+void TestMessageIdTable::test(void)
+{
+	Aggregater aggregater(nullptr);
+	Client secureClient;
+	Client cl[2];
+	uint16_t clientMsgId = 0;
+
+	aggregater.setClient(&secureClient, true);
+
+	uint16_t id1 = aggregater.addMessageIdTable(&cl[0], 1);
+	uint16_t id2 = aggregater.addMessageIdTable(&cl[1], 1);
+	assert(id1 != 0 && id2 != 0 && id1 != id2);
+	assert(aggregater.addMessageIdTable(&cl[0], 1) == 0);
+	assert(aggregater.getMsgId(&cl[0], 1) == id1 && aggregater.getMsgId(&cl[1], 1) == id2);
+	assert(aggregater.getMsgId(&cl[0], 2) == 0);
+	assert(aggregater.findClient(id2) == &cl[1]);
+
+	/* the ack removes the element */
+	assert(aggregater.convertClient(id1, &clientMsgId) == &cl[0] && clientMsgId == 1);
+	assert(aggregater.convertClient(id1, &clientMsgId) == nullptr && clientMsgId == 0);
+	assert(aggregater.getMsgId(&cl[0], 1) == 0);
+
+	/* thousands in flight, a msgId which is still waiting is not given again */
+	uint16_t last = 0;
+	for (int i = 0; i < 10000; i++)
+	{
+		last = aggregater.addMessageIdTable(&cl[i & 1], 2 + i);
+		assert(last != 0);
+	}
+	while (secureClient.getNextPacketId() != id1)
+	{
+	}
+	uint16_t id3 = aggregater.addMessageIdTable(&cl[0], 1);
+	assert(id3 == last + 1 && aggregater.findClient(id2) == &cl[1]);
+	assert(aggregater.convertClient(id3, &clientMsgId) == &cl[0] && clientMsgId == 1);
+	assert(aggregater.convertClient(id2, &clientMsgId) == &cl[1] && clientMsgId == 1);
+
+	printf("[ OK ]\n");
+}
+
+/*
+ *  PUBLISH and ack of the clients with messages in flight.
+ */
+void TestMessageIdTable::bench(void)
+{
+	Aggregater aggregater(nullptr);
+	Client secureClient;
+	Client* clients = new Client[BENCH_CLIENTS];
+	struct timespec start;
+	uint16_t clientMsgId;
+	int found = 0;
+
+	aggregater.setClient(&secureClient, true);
+	for (int i = 0; i < BENCH_CLIENTS * BENCH_INFLIGHT; i++)
+	{
+		aggregater.addMessageIdTable(&clients[i % BENCH_CLIENTS], 1 + i / BENCH_CLIENTS);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int r = 0; r < BENCH_ROUNDS; r++)
+	{
+		for (int i = 0; i < BENCH_CLIENTS * BENCH_INFLIGHT; i++)
+		{
+			Client* client = &clients[i % BENCH_CLIENTS];
+			uint16_t id = 1 + i / BENCH_CLIENTS;
+			uint16_t msgId = aggregater.getMsgId(client, id);
+			found += (aggregater.convertClient(msgId, &clientMsgId) == client && clientMsgId == id);
+			aggregater.addMessageIdTable(client, id);
+		}
+	}
+	double msec = elapsed(&start);
+	assert(found == BENCH_CLIENTS * BENCH_INFLIGHT * BENCH_ROUNDS);
+
+	printf("      %d messages in flight  PUBLISH, ack and renewal %.3f us\n", BENCH_CLIENTS * BENCH_INFLIGHT,
+			msec * 1000.0 / found);
+	delete[] clients;
+}
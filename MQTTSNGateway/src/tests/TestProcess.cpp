@@ -21,6 +21,14 @@
 #include "TestQue.h"
 #include "TestTree23.h"
 #include "TestTopicIdMap.h"
+#include "TestEventQue.h"
+#include "TestKeepAliveWheel.h"
+#include "TestClientList.h"
+#include "TestAggregateTopicTable.h"
+#include "TestMQTTGWPacket.h"
+#include "TestMessageIdTable.h"
+#include "TestForwarder.h"
+#include "TestBufferArena.h"
 #include "MQTTSNGWProcess.h"
 #include "MQTTSNGWClient.h"
 #include "MQTTSNGWPacket.h"
@@ -65,6 +73,15 @@ void TestProcess::run(void)
 	getParam("BrokerName", value);
 	assert(0 == strcmp("mqtt.eclipseprojects.io", value));
 
+	/* Test typed accessors of the config */
+	string str;
+	assert(0 == getParam("BrokerName", str));
+	assert(str == "mqtt.eclipseprojects.io");
+	assert(-3 == getParam("NoSuchParameter", value));
+	assert(7 == getIntParam("NoSuchParameter", 7));
+	assert(true == getBoolParam("NoSuchParameter", true));
+	assert(0 < getIntParam("KeepAlive", 0));
+
 	/* Test RingBuffer */
 	for ( i = 0; i < 1000; i++)
 	{
@@ -100,15 +117,71 @@ void TestProcess::run(void)
     printf("Test  Topic          ");
 	TestTopics* testTopic = new TestTopics();
 	testTopic->test();
+	testTopic->bench();
 	delete testTopic;
 
 	/* Test TopicIdMap */
     printf("Test  TopicIdMap     ");
 	TestTopicIdMap* testMap = new TestTopicIdMap();
 	testMap->test();
+	testMap->bench();
 	delete testMap;
 
 	/* Test EventQue */
+    printf("Test  EventQue       ");
+	TestEventQue* testEvQue = new TestEventQue();
+	testEvQue->test();
+	testEvQue->bench();
+	delete testEvQue;
+
+	/* Test KeepAliveWheel */
+    printf("Test  KeepAliveWheel ");
+	TestKeepAliveWheel* testWheel = new TestKeepAliveWheel();
+	testWheel->test();
+	delete testWheel;
+
+	/* Test ClientList */
+    printf("Test  ClientList     ");
+	TestClientList* testClientList = new TestClientList();
+	testClientList->test();
+	testClientList->bench();
+	delete testClientList;
+
+	/* Test MQTTGWPacket */
+    printf("Test  MQTTGWPacket   ");
+	TestMQTTGWPacket* testGWPacket = new TestMQTTGWPacket();
+	testGWPacket->test();
+	testGWPacket->bench();
+	delete testGWPacket;
+
+	/* Test MessageIdTable */
+    printf("Test  MessageIdTable ");
+	TestMessageIdTable* testMsgIdTable = new TestMessageIdTable();
+	testMsgIdTable->test();
+	testMsgIdTable->bench();
+	delete testMsgIdTable;
+
+	/* Test AggregateTopicTable */
+    printf("Test  AggregateTopic ");
+	TestAggregateTopicTable* testAggregate = new TestAggregateTopicTable();
+	testAggregate->test();
+	testAggregate->bench();
+	delete testAggregate;
+
+	/* Test Forwarder */
+    printf("Test  Forwarder      ");
+	TestForwarder* testForwarder = new TestForwarder();
+	testForwarder->test();
+	testForwarder->bench();
+	delete testForwarder;
+
+	/* Test BufferArena */
+    printf("Test  BufferArena    ");
+	TestBufferArena* testArena = new TestBufferArena();
+	testArena->test();
+	testArena->bench();
+	delete testArena;
+
 	/*
 	printf("Test  EventQue       ");
 	Client* client = new Client();
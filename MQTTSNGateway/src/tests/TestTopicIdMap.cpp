@@ -16,11 +16,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <cassert>
+#include <time.h>
 #include "TestTopicIdMap.h"
+#include "TestUtil.h"
 
 using namespace std;
 using namespace MQTTSNGW;
 
+#define BENCH_INFLIGHT  50      // inflight window of a high-rate publisher
+#define BENCH_MESSAGES  1000000
+
 TestTopicIdMap::TestTopicIdMap()
 {
 	_map = new TopicIdMap();
@@ -205,6 +210,94 @@ void TestTopicIdMap::test(void)
     {
         assert(!testGetElement(id[i], id[i], &topicId));
     }
+
+	/* a larger window, msgIds colliding in the slots */
+	TopicIdMap map(BENCH_INFLIGHT);
+	topicId.type = MQTTSN_TOPIC_TYPE_NORMAL;
+	for (int i = 0; i < BENCH_INFLIGHT * 2 + 1; i++)
+	{
+		assert(map.add(i * 128, i + 1, &topicId) != nullptr);
+	}
+	assert(map.add(0xffff, 1, &topicId) == nullptr);
+	assert(map.getCount() == BENCH_INFLIGHT * 2 + 1);
+
+	for (int i = 0; i < BENCH_INFLIGHT * 2 + 1; i += 2)
+	{
+		map.erase(i * 128);
+	}
+	map.erase(0xffff);
+	assert(map.getCount() == BENCH_INFLIGHT);
+	for (int i = 0; i < BENCH_INFLIGHT * 2 + 1; i++)
+	{
+		TopicIdMapElement* elm = map.getElement(i * 128);
+		assert((i % 2 == 0) ? elm == nullptr : elm->getTopicId() == i + 1);
+	}
+
+	/* elements probed past the end of the slots are shifted back over the wrap around */
+	MsgIdIndex<int> index;
+	index.allocate(8);
+	for (int i = 0; i < 3; i++)
+	{
+		*index.add(7 + i * 8) = i;
+	}
+	assert(index.erase(7) && !index.erase(7));
+	assert(index.find(7) == nullptr && *index.find(15) == 1 && *index.find(23) == 2);
+	int sum = 0;
+	index.forEach([&sum](uint16_t msgId, int* elm)
+	{
+		sum += msgId + *elm;
+	});
+	assert(sum == 15 + 1 + 23 + 2);
+	index.allocate(16);
+	assert(index.getCount() == 2 && *index.find(23) == 2);
+
+	/* PUBLISH waiting for REGACK, the list grows beyond the window */
+	WaitREGACKPacketList list;
+	MQTTSNPacket* packets[MAXID * 2];
+	for (int i = 0; i < MAXID * 2; i++)
+	{
+		packets[i] = new MQTTSNPacket();
+		assert(list.setPacket(packets[i], i + 1));
+	}
+	assert(list.getCount() == MAXID * 2);
+	for (int i = 0; i < MAXID * 2; i += 2)
+	{
+		assert(list.getPacket(i + 1) == packets[i]);
+		list.erase(i + 1);
+		delete packets[i];
+	}
+	assert(list.getCount() == MAXID);
+	for (int i = 0; i < MAXID * 2; i++)
+	{
+		assert(list.getPacket(i + 1) == ((i % 2 == 0) ? nullptr : packets[i]));
+	}
 	printf("[ OK ]\n");
 }
 
+void TestTopicIdMap::bench(void)
+{
+	TopicIdMap map(BENCH_INFLIGHT);
+	MQTTSN_topicid topicId;
+	struct timespec start;
+	int found = 0;
+
+	topicId.type = MQTTSN_TOPIC_TYPE_PREDEFINED;
+	topicId.data.id = 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_MESSAGES; i++)
+	{
+		uint16_t msgId = (uint16_t) (i + 1);
+		map.add(msgId, 1, &topicId);
+		if (i >= BENCH_INFLIGHT)
+		{
+			uint16_t ackId = (uint16_t) (msgId - BENCH_INFLIGHT);
+			found += (map.getElement(ackId) != nullptr);
+			map.erase(ackId);
+		}
+	}
+	double msec = elapsed(&start);
+	assert(found == BENCH_MESSAGES - BENCH_INFLIGHT);
+
+	printf("      %d messages in flight  PUBLISH and PUBACK %.3f us\n", BENCH_INFLIGHT, msec * 1000.0 / BENCH_MESSAGES);
+}
@@ -24,6 +24,7 @@ public:
 	TestTopicIdMap();
 	~TestTopicIdMap();
 	void test(void);
+	void bench(void);
 	bool testGetElement(uint16_t msgid, uint16_t id, MQTTSN_topicid* topic);
 
 private:
@@ -17,12 +17,20 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <cassert>
 #include "TestTopics.h"
+#include "TestUtil.h"
 
 using namespace std;
 using namespace MQTTSNGW;
 
+#define BENCH_FILTERS   50
+#define BENCH_TOPICS    MAX_TOPIC_PAR_CLIENT
+#define BENCH_CLIENTS   10000
+#define BENCH_SITES     8
+#define BENCH_MATCHES   100000
+
 TestTopics::TestTopics()
 {
 	_topics = new Topics();
@@ -41,6 +49,15 @@ bool testIsMatch(const char* topicFilter, const char* topicName)
 	Topic topic(filter, MQTTSN_TOPIC_TYPE_NORMAL);
 	bool isMatch = topic.isMatch(name);
 
+	/* the TopicTrie of Topics agrees with Topic::isMatch */
+	Topics topics;
+	MQTTSN_topicid topicid;
+	topics.add(topicFilter);
+	topicid.type = MQTTSN_TOPIC_TYPE_NORMAL;
+	topicid.data.long_.len = strlen(topicName);
+	topicid.data.long_.name = const_cast<char*>(topicName);
+	assert((topics.match(&topicid) != nullptr) == isMatch);
+
 	delete name;
 
 	return isMatch;
@@ -361,5 +378,204 @@ void TestTopics::test(void)
     assert(testGetPredefinedTopicById("mypretopic2", 2, 2));
     assert(!testGetPredefinedTopicById("mypretopic2", 2, 1));
 
+	/* thousands of Topics, ids stay unique after erasing and wrapping */
+	Topics many;
+	char buf[32];
+	assert(many.add("pre/topic", 7) != nullptr);
+	for (int i = 0; i < MAX_TOPIC_PAR_CLIENT - 1; i++)
+	{
+		sprintf(buf, "device/%d/value", i);
+		assert(many.add(buf) != nullptr);
+	}
+	assert(many.getCount() == MAX_TOPIC_PAR_CLIENT && many.add("device/overflow") == nullptr);
+	for (int i = 0; i < MAX_TOPIC_PAR_CLIENT - 1; i += 97)
+	{
+		MQTTSN_topicid tid;
+		sprintf(buf, "device/%d/value", i);
+		tid.type = MQTTSN_TOPIC_TYPE_NORMAL;
+		tid.data.long_.len = strlen(buf);
+		tid.data.long_.name = buf;
+		Topic* t = many.getTopicByName(&tid);
+		assert(t != nullptr && t->getTopicId() == i + 1);
+		tid.data.id = t->getTopicId();
+		assert(many.getTopicById(&tid) == t);
+	}
+	many.eraseNormal();
+	assert(many.getCount() == 1 && many.getFirstTopic()->getTopicId() == 7);
+
+	/* the memory follows the live topics, not the ids handed out in the past sessions */
+	Topics sessions;
+	size_t sessionSize = 0;
+	for (int i = 0; i < 10000; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			sprintf(buf, "session/%d", j);
+			assert(sessions.add(buf)->getTopicId() == i * 4 + j + 1);
+		}
+		if (i == 0)
+		{
+			sessionSize = sessions.getMemorySize();
+		}
+		assert(sessions.getMemorySize() == sessionSize);
+		sessions.eraseNormal();
+	}
+	MQTTSN_topicid sid;
+	sid.type = MQTTSN_TOPIC_TYPE_NORMAL;
+	sid.data.id = 40000;
+	assert(sessions.add("session/last")->getTopicId() == 40001 && sessions.getTopicById(&sid) == nullptr);
+
+	Topics wrap;
+	assert(wrap.add("wrap/a")->getTopicId() == 1);
+	while (wrap.getNextTopicId() != 0xfffd)
+	{
+	}
+	assert(wrap.add("wrap/b")->getTopicId() == 0xfffe);
+	assert(wrap.add("wrap/c")->getTopicId() == 2);
+	assert(wrap.getTopicByName(&topic[0]) == nullptr);
+
+	/* names are interned once for all Topics and released with the last one */
+	TopicNameTable* names = TopicNameTable::getInstance();
+	int nameCnt = names->getCount();
+	Topics* other = new Topics();
+	Topic* mine = wrap.add("site/1/telemetry");
+	Topic* theirs = other->add("site/1/telemetry");
+	Topic* copy = theirs->duplicate();
+	assert(mine->getTopicName() == theirs->getTopicName() && copy->getTopicName() == mine->getTopicName());
+	assert(names->getCount() == nameCnt + 1);
+	delete copy;
+	delete other;
+	assert(names->getCount() == nameCnt + 1 && *mine->getTopicName() == "site/1/telemetry");
+	wrap.eraseNormal();
+	assert(names->getCount() == nameCnt - 3);
+
 	printf("[ OK ]\n");
 }
+
+/*
+ *  Matches deep topic names against the filters of one client,
+ *  by the TopicTrie and by Topic::isMatch over the list as Topics::match did before.
+ */
+void TestTopics::bench(void)
+{
+	Topics topics;
+	char buf[64];
+	MQTTSN_topicid topicid;
+	struct timespec start;
+	int found = 0;
+
+	for (int i = 0; i < BENCH_FILTERS - 1; i++)
+	{
+		sprintf(buf, "plant/%d/line/+/cell/%d/+/temp", i, i);
+		assert(topics.add(buf) != nullptr);
+	}
+	assert(topics.add("plant/+/line/+/cell/+/+/#") != nullptr);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_MATCHES; i++)
+	{
+		int n = i % BENCH_FILTERS;
+		sprintf(buf, "plant/%d/line/%d/cell/%d/robot/%s", n, i & 7, n, (i & 1) ? "temp" : "vibration");
+		topicid.type = MQTTSN_TOPIC_TYPE_NORMAL;
+		topicid.data.long_.len = strlen(buf);
+		topicid.data.long_.name = buf;
+		found += (topics.match(&topicid) != nullptr);
+	}
+	double trieMsec = elapsed(&start);
+	assert(found == BENCH_MATCHES);
+
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_MATCHES; i++)
+	{
+		int n = i % BENCH_FILTERS;
+		sprintf(buf, "plant/%d/line/%d/cell/%d/robot/%s", n, i & 7, n, (i & 1) ? "temp" : "vibration");
+		string name(buf);
+		for (Topic* topic = topics.getFirstTopic(); topic; topic = topics.getNextTopic(topic))
+		{
+			if (topic->isMatch(&name))
+			{
+				found++;
+				break;
+			}
+		}
+	}
+	double listMsec = elapsed(&start);
+	assert(found == BENCH_MATCHES);
+
+	printf("      match %d filters of 8 levels  TopicTrie %.3f us  Topic::isMatch over the list %.3f us\n", BENCH_FILTERS,
+			trieMsec * 1000.0 / BENCH_MATCHES, listMsec * 1000.0 / BENCH_MATCHES);
+
+	/* REGISTER and PUBLISH lookups of a client with thousands of topics */
+	Topics many;
+	for (int i = 0; i < BENCH_TOPICS; i++)
+	{
+		sprintf(buf, "building/%d/room/%d/temp", i / 16, i);
+		assert(many.add(buf) != nullptr);
+	}
+
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_MATCHES; i++)
+	{
+		int n = i % BENCH_TOPICS;
+		sprintf(buf, "building/%d/room/%d/temp", n / 16, n);
+		topicid.type = MQTTSN_TOPIC_TYPE_NORMAL;
+		topicid.data.long_.len = strlen(buf);
+		topicid.data.long_.name = buf;
+		Topic* topic = many.getTopicByName(&topicid);
+		topicid.data.id = topic->getTopicId();
+		found += (many.getTopicById(&topicid) == topic);
+	}
+	double indexMsec = elapsed(&start);
+	assert(found == BENCH_MATCHES);
+
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BENCH_MATCHES / 100; i++)
+	{
+		int n = i % BENCH_TOPICS;
+		sprintf(buf, "building/%d/room/%d/temp", n / 16, n);
+		string name(buf);
+		Topic* topic = many.getFirstTopic();
+		while (topic && topic->getTopicName()->compare(name) != 0)
+		{
+			topic = many.getNextTopic(topic);
+		}
+		uint16_t id = topic->getTopicId();
+		for (topic = many.getFirstTopic(); topic && topic->getTopicId() != id; topic = many.getNextTopic(topic))
+		{
+		}
+		found += (topic != nullptr);
+	}
+	listMsec = elapsed(&start);
+	assert(found == BENCH_MATCHES / 100);
+
+	printf("      name and id lookups in %d topics  indexes %.3f us  walk of the list %.3f us\n", BENCH_TOPICS,
+			indexMsec * 1000.0 / BENCH_MATCHES, listMsec * 1000.0 / (BENCH_MATCHES / 100));
+
+	/* names of the clients which publish to the same topics */
+	TopicNameTable* names = TopicNameTable::getInstance();
+	size_t internSize = names->getMemorySize();
+	size_t copySize = 0;
+	Topics** clients = new Topics*[BENCH_CLIENTS];
+	for (int i = 0; i < BENCH_CLIENTS; i++)
+	{
+		clients[i] = new Topics();
+		for (int j = 0; j < BENCH_SITES; j++)
+		{
+			sprintf(buf, "site/%d/telemetry", j);
+			Topic* topic = clients[i]->add(buf);
+			copySize += sizeof(string) + topic->getTopicName()->capacity() + 1;
+		}
+	}
+	internSize = names->getMemorySize() - internSize;
+	for (int i = 0; i < BENCH_CLIENTS; i++)
+	{
+		delete clients[i];
+	}
+	delete[] clients;
+
+	printf("      names of %d topics of %d clients  interned %u bytes  copied per client %u bytes\n", BENCH_SITES,
+			BENCH_CLIENTS, (unsigned int) internSize, (unsigned int) copySize);
+}
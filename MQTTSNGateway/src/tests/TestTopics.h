@@ -24,6 +24,7 @@ public:
 	TestTopics();
 	~TestTopics();
 	void test(void);
+	void bench(void);
 
 private:
 	Topics* _topics;